@@ -1,31 +1,140 @@
-/* [1] arena.c - Simple memory arena allocator for temporary allocations. */
+/* [1] arena.c - Named bump allocators over static memory (see arena.h) */
 #include <stdint.h>
+#include <stdbool.h>
+#include <libdragon.h>
 #include "arena.h"
+#include "mem.h" /* [1.1] Arena bytes in the memory accounting */
 
-#define ARENA_SIZE (128 * 1024) /* [2] Total arena size in bytes (128 KB) */
-static uint8_t arena_buf[ARENA_SIZE];    /* [3] Arena buffer */
-static size_t arena_offset = 0;          /* [4] Current offset in the arena */
-static size_t mem_used = 0;              /* [5] Amount of memory used */
-
-/* [6] Reset the arena to empty (all allocations invalidated) */
-void arena_reset(void) {
-    arena_offset = 0;
-    mem_used = 0;
-}
-
-/* [7] Allocate a block of memory from the arena. Returns pointer or NULL if not enough space. */
-void *arena_alloc(size_t size) {
-    if (size == 0) return NULL;
-    const size_t align = 8; /* [7.1] Align allocations to 8 bytes */
-    size_t off = (arena_offset + (align - 1)) & ~(align - 1);
-    if (off + size > ARENA_SIZE) return NULL;
-    void *p = &arena_buf[off];
-    arena_offset = off + size;
-    mem_used = arena_offset;
+#define ARENA_NONE 0xFFFFFFFFu
+#define ARENA_MAGIC 0xA5E7A5E7u  /* [2] Guard word before a block */
+#define ARENA_TAIL 0x5Au         /* Guard bytes after a block (byte stores: no alignment needed) */
+
+/* [3] Debug builds: header right before each block; `prev` chains the blocks backwards */
+typedef struct {
+    uint32_t prev;
+    uint32_t size;
+    uint32_t magic;
+} arena_guard_t;
+
+typedef struct {
+    uint8_t *base;
+    uint32_t size;
+    uint32_t top;
+    uint32_t last;          /* Header of the last block, ARENA_NONE when empty */
+    uint32_t peak;
+    uint32_t failed;
+} arena_t;
+
+static uint8_t mem_persistent[ARENA_PERSISTENT_SIZE] __attribute__((aligned(64)));
+static uint8_t mem_frame[ARENA_FRAME_SIZE] __attribute__((aligned(64)));
+static uint8_t mem_track[2][ARENA_TRACK_SIZE] __attribute__((aligned(64)));
+
+static arena_t arenas[ARENA_COUNT] = {
+    [ARENA_PERSISTENT] = { mem_persistent, ARENA_PERSISTENT_SIZE, 0, ARENA_NONE, 0, 0 },
+    [ARENA_FRAME] = { mem_frame, ARENA_FRAME_SIZE, 0, ARENA_NONE, 0, 0 },
+    [ARENA_TRACK_A] = { mem_track[0], ARENA_TRACK_SIZE, 0, ARENA_NONE, 0, 0 },
+    [ARENA_TRACK_B] = { mem_track[1], ARENA_TRACK_SIZE, 0, ARENA_NONE, 0, 0 },
+};
+
+static arena_t *get(arena_id_t id) {
+    return (id >= 0 && id < ARENA_COUNT) ? &arenas[id] : NULL;
+}
+
+/* [4] Move the top; the memory accounting follows the sum of all arenas */
+static void set_top(arena_t *a, uint32_t top) {
+    mem_account(MEM_ARENA, (int32_t)top - (int32_t)a->top);
+    a->top = top;
+    if (top > a->peak) a->peak = top;
+}
+
+void *arena_alloc_aligned(arena_id_t id, size_t size, size_t align) {
+    arena_t *a = get(id);
+    if (!a || size == 0 || align == 0 || (align & (align - 1)) || align > 64) return NULL;
+    if (align < ARENA_ALIGN) align = ARENA_ALIGN;
+    uint32_t off = a->top;
+#if ARENA_GUARD
+    off += sizeof(arena_guard_t);
+#endif
+    off = (off + (uint32_t)(align - 1)) & ~(uint32_t)(align - 1);
+    uint32_t end = off + (uint32_t)size;
+#if ARENA_GUARD
+    end += 4;
+#endif
+    if (end > a->size || end < off) { a->failed++; return NULL; }
+    uint8_t *p = a->base + off;
+#if ARENA_GUARD
+    arena_guard_t *g = (arena_guard_t *)(p - sizeof(arena_guard_t));
+    g->prev = a->last;
+    g->size = (uint32_t)size;
+    g->magic = ARENA_MAGIC;
+    for (int i = 0; i < 4; i++) p[size + i] = ARENA_TAIL;
+    a->last = off - (uint32_t)sizeof(arena_guard_t);
+#endif
+    set_top(a, end);
     return p;
 }
 
-/* [8] Get the amount of memory used in the arena (in bytes) */
-size_t arena_get_used(void) {
-    return mem_used;
+void *arena_alloc(arena_id_t id, size_t size) {
+    return arena_alloc_aligned(id, size, ARENA_ALIGN);
+}
+
+/* [5] Debug builds: check the guards of every block above `top`, newest first */
+static void check(arena_id_t id, const arena_t *a, uint32_t top) {
+#if ARENA_GUARD
+    for (uint32_t h = a->last; h != ARENA_NONE && h >= top; ) {
+        const arena_guard_t *g = (const arena_guard_t *)(a->base + h);
+        const uint8_t *tail = a->base + h + sizeof(arena_guard_t) + g->size;
+        bool ok = g->magic == ARENA_MAGIC && tail + 4 <= a->base + a->top;
+        for (int i = 0; ok && i < 4; i++) ok = tail[i] == ARENA_TAIL;
+        assertf(ok, "Arena %s: block at offset %lu overwritten", arena_name(id), (unsigned long)h);
+        if (!ok) return;
+        h = g->prev;
+    }
+#else
+    (void)id; (void)a; (void)top;
+#endif
+}
+
+void arena_reset(arena_id_t id) {
+    arena_t *a = get(id);
+    if (!a) return;
+    check(id, a, 0);
+    a->last = ARENA_NONE;
+    set_top(a, 0);
+}
+
+arena_mark_t arena_save(arena_id_t id) {
+    arena_t *a = get(id);
+    return a ? (arena_mark_t){ a->top, a->last } : (arena_mark_t){ 0, ARENA_NONE };
+}
+
+void arena_restore(arena_id_t id, arena_mark_t mark) {
+    arena_t *a = get(id);
+    if (!a || mark.top > a->top) return;
+    check(id, a, mark.top);
+    a->last = mark.last;
+    set_top(a, mark.top);
+}
+
+void arena_frame_begin(void) { arena_reset(ARENA_FRAME); }
+
+void arena_get_stats(arena_id_t id, arena_stats_t *out) {
+    const arena_t *a = get(id);
+    if (!out) return;
+    *out = a ? (arena_stats_t){ a->size, a->top, a->peak, a->failed } : (arena_stats_t){ 0 };
+}
+
+size_t arena_get_used(arena_id_t id) {
+    const arena_t *a = get(id);
+    return a ? a->top : 0;
+}
+
+const char *arena_name(arena_id_t id) {
+    switch (id) {
+        case ARENA_PERSISTENT: return "p";
+        case ARENA_FRAME: return "f";
+        case ARENA_TRACK_A: return "a";
+        case ARENA_TRACK_B: return "b";
+        default: return "?";
+    }
 }
@@ -1,12 +1,58 @@
-/* [1] arena.h - Header for simple memory arena allocator. */
+/* [1] arena.h - Named bump allocators over static memory. Each arena has its own lifetime:
+   persistent (the whole run), frame (scratch of one loop pass, reset by arena_frame_begin())
+   and one per playlist slot (memory of the track open in it, reset when the slot closes).
+   Marks save the top of an arena and give back everything allocated after it. Debug builds
+   put a guard word before and after every block and check them on reset/restore. */
 #pragma once
 #include <stddef.h>
+#include <stdint.h>
 
-/* [2] Reset the arena to empty (all allocations invalidated) */
-void arena_reset(void);
+/* [2] Arenas */
+typedef enum {
+    ARENA_PERSISTENT = 0,   /* Buffers taken at startup, never reset */
+    ARENA_FRAME,            /* Per-frame formatting scratch */
+    ARENA_TRACK_A,          /* Playlist slot 0: seek index of the track in it */
+    ARENA_TRACK_B,          /* Playlist slot 1 */
+    ARENA_COUNT
+} arena_id_t;
 
-/* [3] Allocate a block of memory from the arena. Returns pointer or NULL if not enough space. */
-void *arena_alloc(size_t size);
+#define ARENA_PERSISTENT_SIZE (16 * 1024)  /* [3] Sizes (bytes) */
+#define ARENA_FRAME_SIZE (8 * 1024)
+#define ARENA_TRACK_SIZE (16 * 1024)       /* Each slot; a full seek index is 6 KB */
+#define ARENA_ALIGN 8                      /* Default alignment */
 
-/* [4] Get the amount of memory used in the arena (in bytes) */
-size_t arena_get_used(void);
+#ifndef ARENA_GUARD
+#ifdef NDEBUG
+#define ARENA_GUARD 0
+#else
+#define ARENA_GUARD 1                      /* Guard words around every block */
+#endif
+#endif
+
+/* [4] Allocate `size` bytes, aligned to ARENA_ALIGN or to `align` (a power of two up to 64).
+   Returns NULL when the arena is full (counted in `failed`). */
+void *arena_alloc(arena_id_t id, size_t size);
+void *arena_alloc_aligned(arena_id_t id, size_t size, size_t align);
+
+/* [5] Give back everything: the whole arena, or what was allocated after a mark */
+typedef struct {
+    uint32_t top;           /* Offset of the first free byte */
+    uint32_t last;          /* Guard header of the last block (debug builds) */
+} arena_mark_t;
+void arena_reset(arena_id_t id);
+arena_mark_t arena_save(arena_id_t id);
+void arena_restore(arena_id_t id, arena_mark_t mark);
+
+/* [6] Start of a loop pass: the frame arena is reset */
+void arena_frame_begin(void);
+
+/* [7] Counters */
+typedef struct {
+    uint32_t size;
+    uint32_t used;
+    uint32_t peak;          /* High-water mark */
+    uint32_t failed;        /* Allocations that did not fit */
+} arena_stats_t;
+void arena_get_stats(arena_id_t id, arena_stats_t *out);
+size_t arena_get_used(arena_id_t id);
+const char *arena_name(arena_id_t id); /* One letter, for the debug overlay */
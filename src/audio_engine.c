@@ -0,0 +1,279 @@
+/* [1] audio_engine.c - Keeps the mixer fed and hands per-buffer peaks to the UI. */
+#include "audio_engine.h"
+#include "utils.h"   /* fast_memset */
+#include "mem.h"     /* Audio ring and mixer memory */
+#include <stdlib.h>
+#include <libdragon.h>
+
+/* [2] Single-producer/single-consumer peak ring.
+   The producer is audio_engine_fill (main-loop pump, or the audio callback in the IRQ build),
+   the consumer is the UI loop. Each side only writes its own index, so no lock is needed. */
+static audio_peak_t peak_ring[AUDIO_PEAK_RING_SIZE];
+static volatile uint32_t peak_head = 0;  /* [3] Written by producer only */
+static volatile uint32_t peak_tail = 0;  /* [4] Written by consumer only */
+
+static volatile uint32_t buffers_mixed = 0; /* [5] Total buffers produced */
+static volatile uint32_t underruns = 0;     /* [6] Times the output ran dry */
+static volatile uint32_t peaks_dropped = 0; /* [7] Peak records lost because the ring was full */
+static int engine_num_buffers = 0;          /* [8] Buffers mixed ahead: the engine ring (polled build) or libdragon's */
+static volatile uint64_t samples_mixed = 0; /* [8.2] Output samples produced by mixer_poll, minus flushed ones (64-bit, never wraps) */
+static audio_mix_hook_t mix_hook = NULL;    /* [8.3] Optional pre-mix hook */
+static volatile uint64_t mix_ticks_total = 0; /* [8.4] Ticks spent in mixer_poll */
+static volatile uint32_t mix_ticks_max = 0;   /* [8.5] Worst single mixer_poll since the last reset */
+static volatile uint32_t mix_buffers = 0;     /* [8.6] Buffers measured */
+static volatile uint32_t min_fill_pct[AUDIO_FILL_READERS] = { 100, 100 }; /* [8.7] Lowest ring fill per reader */
+#if AUDIO_ENGINE_IRQ_MIX
+static uint32_t last_callback_ticks = 0;      /* [8.8] TICKS_READ() at the previous callback */
+static uint32_t buffer_ticks = 0;             /* [8.9] Duration of one audio buffer in ticks */
+#else
+/* [8.9.1] Polled build: the main loop mixes into this ring, the audio interrupt copies the oldest
+   buffer out when the AI asks for one. Audio mixed ahead stays here (not in the AI queue), so
+   audio_engine_flush() can drop it. */
+static short *ring[AUDIO_ENGINE_RING];
+static int ring_samples = 0;                  /* Stereo samples per buffer */
+static volatile uint32_t ring_head = 0;       /* Buffers mixed (written by the main loop only) */
+static volatile uint32_t ring_tail = 0;       /* Buffers handed to the AI (written by the interrupt only) */
+#endif
+
+/* [8.10] Record how many buffers of the ring had gone free (played out) before the producer ran.
+   All of them free means the output ran dry (the polled build counts that in the hand-off,
+   which sees it exactly). */
+static void audio_engine_note_free(int free_buffers) {
+    if (engine_num_buffers <= 0) return;
+    if (free_buffers >= engine_num_buffers) {
+#if AUDIO_ENGINE_IRQ_MIX
+        underruns++;
+#endif
+        free_buffers = engine_num_buffers;
+    }
+    uint32_t fill = (uint32_t)((engine_num_buffers - free_buffers) * 100 / engine_num_buffers);
+    for (int r = 0; r < AUDIO_FILL_READERS; r++)
+        if (fill < min_fill_pct[r]) min_fill_pct[r] = fill;
+}
+
+#if AUDIO_ENGINE_IRQ_MIX
+/* [8.11] Callback build: every callback refills the ring, so the time since the previous one is
+   the audio that played out meanwhile. Calls less than half a buffer apart belong to the same
+   interrupt (one call per free buffer) and were measured by the first call. */
+static void audio_engine_watch(void) {
+    uint32_t now = TICKS_READ();
+    uint32_t gap = now - last_callback_ticks;
+    last_callback_ticks = now;
+    if (buffer_ticks == 0 || buffers_mixed < (uint32_t)engine_num_buffers) return; /* Ring still priming */
+    if (gap < buffer_ticks / 2) return;
+    audio_engine_note_free((int)((gap + buffer_ticks / 2) / buffer_ticks));
+}
+#endif
+
+/* [9] Mix one buffer and push its peaks into the ring. Runs in the producer context. */
+static void audio_engine_fill(short *buffer, size_t numsamples) {
+#if AUDIO_ENGINE_IRQ_MIX
+    audio_engine_watch();
+#endif
+    if (mix_hook) mix_hook(samples_mixed, (int)numsamples);
+    uint32_t t0 = TICKS_READ();
+    mixer_poll(buffer, (int)numsamples);
+    uint32_t dt = TICKS_READ() - t0;
+    mix_ticks_total += dt;
+    if (dt > mix_ticks_max) mix_ticks_max = dt;
+    mix_buffers++;
+    samples_mixed += numsamples;
+
+    /* [9.1] Mixer output is always interleaved stereo */
+    int peak_l = 0, peak_r = 0;
+    for (size_t i = 0; i < numsamples * 2; i += 2) {
+        int l = abs((int)buffer[i]);
+        if (l > peak_l) peak_l = l;
+        int r = abs((int)buffer[i + 1]);
+        if (r > peak_r) peak_r = r;
+    }
+    if (peak_l > 32767) peak_l = 32767;
+    if (peak_r > 32767) peak_r = 32767;
+
+    /* [9.2] Publish the record, dropping it if the UI has not caught up */
+    uint32_t head = peak_head;
+    if (head - peak_tail < AUDIO_PEAK_RING_SIZE) {
+        audio_peak_t *p = &peak_ring[head & (AUDIO_PEAK_RING_SIZE - 1)];
+        p->peak_l = (int16_t)peak_l;
+        p->peak_r = (int16_t)peak_r;
+        p->samples = (uint32_t)numsamples;
+        MEMORY_BARRIER();
+        peak_head = head + 1;
+    } else {
+        peaks_dropped++;
+    }
+    buffers_mixed++;
+}
+
+#if !AUDIO_ENGINE_IRQ_MIX
+/* [9.3] Buffer hand-off (audio interrupt): copy the oldest mixed buffer into the one the AI asked
+   for. An empty ring after playback started is an underrun: the AI gets silence. */
+static void audio_engine_handoff(short *buffer, size_t numsamples) {
+    uint32_t tail = ring_tail;
+    if (tail == ring_head || (int)numsamples != ring_samples) {
+        fast_memset(buffer, 0, numsamples * 2 * sizeof(short));
+        if (ring_head > 0) underruns++;
+        return;
+    }
+    MEMORY_BARRIER();
+    fast_memcpy(buffer, ring[tail % AUDIO_ENGINE_RING], numsamples * 2 * sizeof(short));
+    ring_tail = tail + 1;
+}
+#endif
+
+/* [10] Initialize audio output, the mixer and the buffer callback. The polled build mixes into
+   its own ring, so libdragon only needs the two buffers the AI plays from. */
+void audio_engine_init(int frequency, int num_buffers, int mixer_channels) {
+    mem_scope_t m = mem_scope_begin(); /* The buffers are allocated inside libdragon: measured */
+#if AUDIO_ENGINE_IRQ_MIX
+    engine_num_buffers = num_buffers;
+    audio_init(frequency, num_buffers);
+#else
+    engine_num_buffers = AUDIO_ENGINE_RING;
+    audio_init(frequency, 2);
+    ring_samples = audio_get_buffer_length();
+    for (int i = 0; i < AUDIO_ENGINE_RING; i++) {
+        ring[i] = (short *)malloc((size_t)ring_samples * 2 * sizeof(short));
+        assertf(ring[i], "Audio ring allocation failed");
+    }
+#endif
+    mixer_init(mixer_channels);
+    mem_scope_end(MEM_AUDIO, m);
+#if AUDIO_ENGINE_IRQ_MIX
+    buffer_ticks = TICKS_FROM_US(audio_engine_get_buffer_us());
+    audio_set_buffer_callback(audio_engine_fill);
+#else
+    audio_set_buffer_callback(audio_engine_handoff);
+#endif
+}
+
+/* [11] Stop the callback and close audio output */
+void audio_engine_close(void) {
+    audio_set_buffer_callback(NULL);
+    mem_scope_t m = mem_scope_begin();
+    mixer_close();
+    audio_close();
+#if !AUDIO_ENGINE_IRQ_MIX
+    for (int i = 0; i < AUDIO_ENGINE_RING; i++) {
+        free(ring[i]);
+        ring[i] = NULL;
+    }
+#endif
+    mem_scope_end(MEM_AUDIO, m);
+}
+
+/* [12] Polled build: mix every free buffer of the ring. The buffers still queued before mixing
+   give the ring fill (all free = the output ran dry, counted by the hand-off). */
+void audio_engine_pump(void) {
+#if !AUDIO_ENGINE_IRQ_MIX
+    uint32_t queued = ring_head - ring_tail;
+    if (ring_head > 0) audio_engine_note_free(AUDIO_ENGINE_RING - (int)queued);
+    while (ring_head - ring_tail < AUDIO_ENGINE_RING) {
+        audio_engine_fill(ring[ring_head % AUDIO_ENGINE_RING], (size_t)ring_samples);
+        MEMORY_BARRIER();
+        ring_head++;
+    }
+#endif
+}
+
+/* [12.1] Drop the audio mixed ahead and move the output clock back to the first dropped sample */
+uint64_t audio_engine_flush(void) {
+#if AUDIO_ENGINE_IRQ_MIX
+    return 0;
+#else
+    disable_interrupts();
+    uint32_t n = ring_head - ring_tail;
+    ring_head = ring_tail;
+    enable_interrupts();
+    uint64_t dropped = (uint64_t)n * (uint64_t)ring_samples;
+    samples_mixed -= dropped;
+    return dropped;
+#endif
+}
+
+/* [13] Mixer state is shared with the callback, so main-loop changes run with interrupts off */
+void audio_engine_lock(void) {
+#if AUDIO_ENGINE_IRQ_MIX
+    disable_interrupts();
+#endif
+}
+
+void audio_engine_unlock(void) {
+#if AUDIO_ENGINE_IRQ_MIX
+    enable_interrupts();
+#endif
+}
+
+/* [14] Pop one peak record from the ring. Returns false when the ring is empty. */
+bool audio_engine_pop_peak(audio_peak_t *out) {
+    uint32_t tail = peak_tail;
+    if (tail == peak_head) return false;
+    MEMORY_BARRIER();
+    if (out) *out = peak_ring[tail & (AUDIO_PEAK_RING_SIZE - 1)];
+    MEMORY_BARRIER();
+    peak_tail = tail + 1;
+    return true;
+}
+
+/* [15] Drain the ring and return the highest peaks since the last call */
+void audio_engine_read_peaks(int *max_l, int *max_r) {
+    int l = 0, r = 0;
+    audio_peak_t p;
+    while (audio_engine_pop_peak(&p)) {
+        if (p.peak_l > l) l = p.peak_l;
+        if (p.peak_r > r) r = p.peak_r;
+    }
+    if (max_l) *max_l = l;
+    if (max_r) *max_r = r;
+}
+
+/* [15.1] Output samples mixed so far. Read with the callback blocked so both halves match. */
+uint64_t audio_engine_get_samples_mixed(void) {
+    audio_engine_lock();
+    uint64_t n = samples_mixed;
+    audio_engine_unlock();
+    return n;
+}
+
+/* [15.2] Pre-mix hook, swapped with the callback blocked */
+void audio_engine_set_mix_hook(audio_mix_hook_t hook) {
+    audio_engine_lock();
+    mix_hook = hook;
+    audio_engine_unlock();
+}
+
+/* [15.3] Mixer cost snapshot (read under lock so the 64-bit total and the count match) */
+void audio_engine_get_mix_cost(uint64_t *total_ticks, uint32_t *buffers, uint32_t *max_ticks) {
+    audio_engine_lock();
+    if (total_ticks) *total_ticks = mix_ticks_total;
+    if (buffers) *buffers = mix_buffers;
+    if (max_ticks) *max_ticks = mix_ticks_max;
+    audio_engine_unlock();
+}
+
+void audio_engine_reset_mix_max(void) {
+    mix_ticks_max = 0;
+}
+
+/* [15.4] One buffer lasts buffer_length / frequency seconds */
+uint32_t audio_engine_get_buffer_us(void) {
+    int freq = audio_get_frequency();
+    if (freq <= 0) return 0;
+    return (uint32_t)((uint64_t)audio_get_buffer_length() * 1000000ULL / (uint64_t)freq);
+}
+
+/* [15.5] Lowest ring fill since this reader's last call, then start over (under lock, the
+   callback may be lowering it) */
+uint32_t audio_engine_take_min_fill(audio_fill_reader_t reader) {
+    if (reader < 0 || reader >= AUDIO_FILL_READERS) return 100;
+    audio_engine_lock();
+    uint32_t v = min_fill_pct[reader];
+    min_fill_pct[reader] = 100;
+    audio_engine_unlock();
+    return v;
+}
+
+/* [16] Statistics getters */
+uint32_t audio_engine_get_buffers_mixed(void) { return buffers_mixed; }
+uint32_t audio_engine_get_underruns(void) { return underruns; }
+uint32_t audio_engine_get_peaks_dropped(void) { return peaks_dropped; }
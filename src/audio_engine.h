@@ -0,0 +1,90 @@
+/* [1] audio_engine.h - Audio pump for the mixer, with peak hand-off to the UI. */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/* [2] AUDIO_ENGINE_IRQ_MIX = 0 (default): mixer_poll runs in the main loop, in audio_engine_pump(),
+   into a ring of AUDIO_ENGINE_RING buffers. The main loop pumps at every place it can wait (frame
+   acquisition, menu, mode switch), and the audio interrupt only copies the oldest mixed buffer
+   to the AI. Decoding, DFS reads, heap use and rspq submission all stay in one context, so none
+   of them needs a lock, and audio mixed ahead can still be dropped (audio_engine_flush).
+   AUDIO_ENGINE_IRQ_MIX = 1: mixer_poll runs inside the audio buffer callback (interrupt level).
+   Only for experiments: the decoders then read the cartridge and allocate from the interrupt while
+   the main loop opens tracks, seeks and draws without a lock. */
+#ifndef AUDIO_ENGINE_IRQ_MIX
+#define AUDIO_ENGINE_IRQ_MIX 0
+#endif
+
+#define AUDIO_ENGINE_RING 4     /* [2.1] Buffers the polled build mixes ahead (40 ms each): slow-frame headroom */
+#define AUDIO_PEAK_RING_SIZE 16 /* [3] Peak ring entries (must be a power of two) */
+
+/* [4] Peak record produced once per mixed audio buffer */
+typedef struct {
+    int16_t peak_l;   /* Highest absolute left sample in the buffer */
+    int16_t peak_r;   /* Highest absolute right sample in the buffer */
+    uint32_t samples; /* Number of stereo samples in the buffer */
+} audio_peak_t;
+
+/* [4.1] Called from the producer right before each mixer_poll, with the output sample counter
+   at the start of the buffer. Lets other modules change channel volumes with buffer accuracy. */
+typedef void (*audio_mix_hook_t)(uint64_t samples_mixed, int numsamples);
+
+/* [5] Initialize audio output, the mixer and the buffer callback. num_buffers is libdragon's
+   ring in the IRQ build; the polled build uses AUDIO_ENGINE_RING of its own instead. */
+void audio_engine_init(int frequency, int num_buffers, int mixer_channels);
+
+/* [6] Stop the callback and close audio output */
+void audio_engine_close(void);
+
+/* [7] Fill every free audio buffer (no-op when AUDIO_ENGINE_IRQ_MIX is 1) */
+void audio_engine_pump(void);
+
+/* [8] Guard mixer/channel changes made from the main loop against the audio callback
+   (no-op in the default polled build, where both run in the same context) */
+void audio_engine_lock(void);
+void audio_engine_unlock(void);
+
+/* [8.1] Drop the audio mixed ahead that the AI has not taken yet (polled build) and move the
+   output clock back by the same amount. Returns the output samples dropped (0 in the IRQ build).
+   Every playing stream is then ahead of the clock, so the caller moves them back
+   (stream_set_paused does). Afterwards the only audio still to be heard is the buffer the AI is
+   playing and the one queued behind it. */
+uint64_t audio_engine_flush(void);
+
+/* [9] Pop one peak record from the ring. Returns false when the ring is empty. */
+bool audio_engine_pop_peak(audio_peak_t *out);
+
+/* [10] Drain the ring and return the highest peaks since the last call */
+void audio_engine_read_peaks(int *max_l, int *max_r);
+
+/* [10.1] Output samples mixed since init, minus flushed ones. Advances in whole buffers,
+   exactly in step with every playing channel, so it is the base for sample-accurate positions. */
+uint64_t audio_engine_get_samples_mixed(void);
+
+/* [10.2] Install (or remove with NULL) the pre-mix hook */
+void audio_engine_set_mix_hook(audio_mix_hook_t hook);
+
+/* [10.3] Time spent inside mixer_poll: total ticks, buffers measured and the worst buffer since
+   the last audio_engine_reset_mix_max(). Differences of two snapshots give the average cost. */
+void audio_engine_get_mix_cost(uint64_t *total_ticks, uint32_t *buffers, uint32_t *max_ticks);
+void audio_engine_reset_mix_max(void);
+
+/* [10.4] Duration of one audio buffer in microseconds (the hard deadline for a mix) */
+uint32_t audio_engine_get_buffer_us(void);
+
+/* [10.5] Lowest fill of the output ring (percent of its buffers still queued) since the last
+   call of the same reader. The polled build measures it in audio_engine_pump(); the callback
+   build from the time between callbacks (the ring is full after each one, and the output plays
+   on meanwhile). Each reader keeps its own minimum, so they do not take values from each other. */
+typedef enum {
+    AUDIO_FILL_GOVERNOR = 0, /* governor.c, once per window */
+    AUDIO_FILL_FRAME,        /* main.c, once per frame for the overlay statistics */
+    AUDIO_FILL_READERS
+} audio_fill_reader_t;
+uint32_t audio_engine_take_min_fill(audio_fill_reader_t reader);
+
+/* [11] Statistics: buffers mixed, detected underruns (the whole ring played out before it was
+   refilled, in either build), peak records dropped because the UI lagged */
+uint32_t audio_engine_get_buffers_mixed(void);
+uint32_t audio_engine_get_underruns(void);
+uint32_t audio_engine_get_peaks_dropped(void);
@@ -0,0 +1,137 @@
+/* [1] bench.c - Resolution benchmark (see bench.h) */
+#include "bench.h"
+#include "audio_engine.h" /* [2] Underrun counter */
+#include "ui.h"           /* [3] Full redraw during the run */
+#include "utils.h"        /* [3.1] int_to_dec */
+
+#define BENCH_MAX_MODES 64
+
+static bool running = false;
+static bool saved_retained = true;
+static const resolution_t *start_res = NULL;
+static int mode_index = 0;       /* Entry being measured */
+static int frame_count = 0;      /* Frames since the switch, warmup included */
+static uint32_t frame_us[BENCH_FRAMES];
+static uint64_t cpu_sum = 0;
+static uint32_t underruns0 = 0;
+static bench_result_t results[BENCH_MAX_MODES];
+static int result_count = 0;
+
+static int mode_count(void) {
+    int n = menu_get_resolution_count();
+    return n < BENCH_MAX_MODES ? n : BENCH_MAX_MODES;
+}
+
+static void begin_mode(int index) {
+    mode_index = index;
+    frame_count = 0;
+    cpu_sum = 0;
+    underruns0 = audio_engine_get_underruns();
+    results[index] = (bench_result_t){ .entry = menu_get_resolution(index), .free_ram = 0x7FFFFFFF };
+}
+
+const resolution_t *bench_start(const resolution_t *current) {
+    if (running || mode_count() == 0) return NULL;
+    running = true;
+    start_res = current;
+    result_count = 0;
+    saved_retained = ui_get_retained();
+    ui_set_retained(false);
+    begin_mode(0);
+    return results[0].entry->res;
+}
+
+static const resolution_t *finish(void) {
+    running = false;
+    ui_set_retained(saved_retained);
+    return start_res;
+}
+
+const resolution_t *bench_cancel(void) {
+    if (!running) return NULL;
+    debugf("Benchmark cancelled after %d of %d modes\n", result_count, mode_count());
+    return finish();
+}
+
+bool bench_running(void) { return running; }
+
+void bench_set_bpp(int bpp) {
+    if (running) results[mode_index].bpp = bpp;
+}
+
+int bench_progress(int *total) {
+    if (total) *total = mode_count();
+    return mode_index;
+}
+
+/* [4] Sorted copy for the percentile (insertion sort, BENCH_FRAMES values) */
+static uint32_t percentile95(void) {
+    static uint32_t sorted[BENCH_FRAMES];
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        uint32_t v = frame_us[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > v) { sorted[j] = sorted[j - 1]; j--; }
+        sorted[j] = v;
+    }
+    return sorted[(BENCH_FRAMES * 95 + 99) / 100 - 1];
+}
+
+static void print_us(char *out, uint32_t us) {
+    int pos = int_to_dec(out, (int)(us / 1000));
+    out[pos++] = '.';
+    out[pos++] = (char)('0' + (us / 100) % 10);
+    out[pos++] = (char)('0' + (us / 10) % 10);
+    out[pos] = '\0';
+}
+
+/* [5] Ranked table: fastest average first */
+static void print_table(void) {
+    int order[BENCH_MAX_MODES];
+    for (int i = 0; i < result_count; i++) {
+        int j = i;
+        while (j > 0 && results[order[j - 1]].avg_us > results[i].avg_us) { order[j] = order[j - 1]; j--; }
+        order[j] = i;
+    }
+    debugf("=== Resolution benchmark: %d modes, %d frames each (ms) ===\n", result_count, BENCH_FRAMES);
+    debugf(" #  %-36s bpp    avg    p95    max  cpu%%  freeKB  underruns\n", "mode");
+    for (int k = 0; k < result_count; k++) {
+        const bench_result_t *r = &results[order[k]];
+        char avg[16], p95[16], max[16];
+        print_us(avg, r->avg_us);
+        print_us(p95, r->p95_us);
+        print_us(max, r->max_us);
+        debugf("%2d  %-36s %3d %6s %6s %6s  %4lu  %6d  %lu\n", k + 1, r->entry->name, r->bpp, avg, p95, max,
+               (unsigned long)r->cpu_pct, r->free_ram / 1024, (unsigned long)r->underruns);
+    }
+}
+
+const resolution_t *bench_frame(uint32_t us, float cpu_percent, int free_ram) {
+    if (!running) return NULL;
+    bench_result_t *r = &results[mode_index];
+    int n = frame_count++ - BENCH_WARMUP_FRAMES;
+    if (n < 0) return NULL;
+    frame_us[n] = us;
+    cpu_sum += (uint64_t)(cpu_percent + 0.5f);
+    if (free_ram < r->free_ram) r->free_ram = free_ram;
+    if (n + 1 < BENCH_FRAMES) return NULL;
+
+    /* [6] Mode done */
+    uint64_t sum = 0;
+    uint32_t max = 0;
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        sum += frame_us[i];
+        if (frame_us[i] > max) max = frame_us[i];
+    }
+    r->avg_us = (uint32_t)(sum / BENCH_FRAMES);
+    r->p95_us = percentile95();
+    r->max_us = max;
+    r->cpu_pct = (uint32_t)(cpu_sum / BENCH_FRAMES);
+    r->underruns = audio_engine_get_underruns() - underruns0;
+    result_count = mode_index + 1;
+    if (result_count < mode_count()) {
+        begin_mode(mode_index + 1);
+        return results[mode_index].entry->res;
+    }
+    print_table();
+    return finish();
+}
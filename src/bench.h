@@ -0,0 +1,38 @@
+/* [1] bench.h - Resolution benchmark: switches through every entry of the menu resolution list
+   while the music plays, records the frame time (average, 95th percentile, worst), CPU %, free
+   RAM and audio underruns of each, and prints a table ranked by average frame time to the
+   debug log. The screen is fully redrawn every frame during the run, so each mode pays its
+   real drawing cost. */
+#pragma once
+#include <libdragon.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "menu.h"
+
+#define BENCH_WARMUP_FRAMES 15   /* [2] Frames dropped after a switch (background, first redraws) */
+#define BENCH_FRAMES 120         /* Frames measured per mode */
+
+/* [3] Result of one mode */
+typedef struct {
+    const resolution_entry_t *entry;
+    int bpp;
+    uint32_t avg_us, p95_us, max_us;
+    uint32_t cpu_pct;        /* Average CPU % of the frames */
+    int free_ram;            /* Lowest free RAM seen (bytes) */
+    uint32_t underruns;      /* Audio underruns while the mode was measured (switch included) */
+} bench_result_t;
+
+/* [4] Start with the current mode (set again at the end). Returns the first mode to switch to. */
+const resolution_t *bench_start(const resolution_t *current);
+/* [5] Stop early: returns the mode to go back to */
+const resolution_t *bench_cancel(void);
+bool bench_running(void);
+
+/* [6] Record one frame of the main loop. Returns the mode to switch to next (the following list
+   entry, or the starting mode when all are done), NULL to stay. */
+const resolution_t *bench_frame(uint32_t frame_us, float cpu_percent, int free_ram);
+/* [6.1] The mode switch was done at this depth (for the table) */
+void bench_set_bpp(int bpp);
+
+/* [7] Progress for the HUD: index of the mode being measured and the count */
+int bench_progress(int *total);
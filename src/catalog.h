@@ -0,0 +1,34 @@
+/* [1] catalog.h - On-disk layout of rom:/tracks.cat, the track catalog written at build time
+   by tools/mkcatalog.c. Shared by the host tool and the player, so it only uses <stdint.h>.
+   All numbers are big-endian, like the WAV64 header. */
+#ifndef CATALOG_H
+#define CATALOG_H
+#include <stdint.h>
+
+/* [2] File header: magic, version, entry count and entry size (for forward compatibility) */
+#define CATALOG_MAGIC "MCAT"
+#define CATALOG_VERSION 2
+#define CATALOG_FILE_NAME "tracks.cat"
+#define CATALOG_HEADER_SIZE 12  /* "MCAT", u8 version, u8 pad, u16 count, u16 entry size, u16 pad */
+
+/* [3] One entry per .wav64, sorted by name (the playlist order) */
+#define CATALOG_NAME_LEN 56     /* File name inside rom:/, NUL padded */
+#define CATALOG_HEADER_BYTES 16 /* First bytes of the file, for the debug overlay */
+#define CATALOG_OFS_NAME 0
+#define CATALOG_OFS_FORMAT 56   /* u8: 0 = PCM, 1 = VADPCM, 3 = Opus */
+#define CATALOG_OFS_CHANNELS 57 /* u8 */
+#define CATALOG_OFS_BITS 58     /* u8 */
+#define CATALOG_OFS_FREQ 60     /* u32 sample rate */
+#define CATALOG_OFS_LEN 64      /* u32 length in samples */
+#define CATALOG_OFS_LOOP_START 68 /* u32 loop start in samples (0 when not looping) */
+#define CATALOG_OFS_LOOP_END 72 /* u32 loop end in samples (0 when not looping) */
+#define CATALOG_OFS_BITRATE 76  /* u32 average bitrate in bits per second */
+#define CATALOG_OFS_FILE_SIZE 80 /* u32 file size in bytes */
+#define CATALOG_OFS_HEADER 84   /* u8[16] first header bytes */
+#define CATALOG_OFS_DATA_OFFSET 100 /* u32 byte offset of the first sample (WAV64 start_offset) */
+#define CATALOG_ENTRY_SIZE 104
+
+#define CATALOG_MAX_ENTRIES 64  /* The player's track limit (PLAYLIST_MAX_TRACKS, checked in playlist.c);
+                                   mkcatalog fails the build when rom:/ holds more */
+
+#endif /* CATALOG_H */
@@ -0,0 +1,56 @@
+/* [1] clock.c - 64-bit tick clock of the main loop (see clock.h) */
+#include "clock.h"
+#include <libdragon.h>
+
+static uint32_t vi_ticks = TICKS_PER_SECOND / 50;
+static uint64_t pass_start = 0, prev_pass_start = 0, frame_start = 0;
+
+/* [2] Tick count to uint32_t, clamped */
+static uint32_t clamp32(uint64_t ticks) {
+    return ticks > UINT32_MAX ? UINT32_MAX : (uint32_t)ticks;
+}
+
+void clock_init(void) {
+    /* NTSC and M-PAL run the VI at 60000/1001 Hz */
+    vi_ticks = (get_tv_type() == TV_TYPE_PAL) ? TICKS_PER_SECOND / 50
+                                              : (uint32_t)((uint64_t)TICKS_PER_SECOND * 1001 / 60000);
+}
+
+uint64_t clock_now(void) { return get_ticks(); }
+
+/* [3] Whole seconds and the rest apart, so ticks * 1000000 never overflows */
+uint64_t clock_to_us(uint64_t ticks) {
+    return (ticks / TICKS_PER_SECOND) * 1000000u + (ticks % TICKS_PER_SECOND) * 1000000u / TICKS_PER_SECOND;
+}
+
+uint64_t clock_from_us(uint64_t us) {
+    return (us / 1000000u) * TICKS_PER_SECOND + (us % 1000000u) * TICKS_PER_SECOND / 1000000u;
+}
+
+uint32_t clock_uptime_sec(void) { return (uint32_t)(clock_now() / TICKS_PER_SECOND); }
+
+uint32_t clock_vi_ticks(void) { return vi_ticks; }
+uint32_t clock_vi_us(void) { return (uint32_t)clock_to_us(vi_ticks); }
+
+/* [4] Main loop */
+void clock_pass_begin(void) {
+    prev_pass_start = pass_start;
+    pass_start = clock_now();
+}
+
+void clock_frame_end(void) { frame_start = pass_start; }
+
+uint32_t clock_pass_elapsed(void) { return clamp32(clock_now() - pass_start); }
+
+uint32_t clock_pass_interval(void) {
+    return prev_pass_start ? clamp32(pass_start - prev_pass_start) : vi_ticks;
+}
+
+uint32_t clock_frame_interval(void) {
+    return frame_start ? clamp32(pass_start - frame_start) : vi_ticks;
+}
+
+uint32_t clock_budget_left(void) {
+    uint32_t elapsed = clock_pass_elapsed();
+    return elapsed < vi_ticks ? vi_ticks - elapsed : 0;
+}
@@ -0,0 +1,29 @@
+/* [1] clock.h - The clock of the main loop: 64-bit CPU counter ticks since boot (get_ticks(),
+   TICKS_PER_SECOND per second). Timestamps stay exact for as long as the console runs: a 32-bit
+   tick count wraps after 91 s, and a float of milliseconds has 1 ms steps after 4.6 hours and
+   2 ms steps after 9.3. Durations are whole ticks; they become us or ms only where they are
+   shown or passed on. */
+#pragma once
+#include <stdint.h>
+
+/* [2] Time. clock_init() once at boot: it reads the TV type for the VI period. */
+void clock_init(void);
+uint64_t clock_now(void);                 /* Ticks since boot */
+uint64_t clock_to_us(uint64_t ticks);     /* Exact for any tick count (no 64-bit overflow) */
+uint64_t clock_from_us(uint64_t us);
+uint32_t clock_uptime_sec(void);
+
+/* [3] One VI period (20 ms PAL, 16.683 ms NTSC and M-PAL): the frame budget of the main loop */
+uint32_t clock_vi_ticks(void);
+uint32_t clock_vi_us(void);
+
+/* [4] Main loop. clock_pass_begin() at the top of every pass; clock_frame_end() when the pass
+   made a frame (shown or skipped), not when it only found every framebuffer busy. Durations
+   are in ticks, clamped to UINT32_MAX (91 s); before the first pass or frame they are one VI
+   period. */
+void clock_pass_begin(void);
+void clock_frame_end(void);
+uint32_t clock_pass_elapsed(void);        /* Since this pass began */
+uint32_t clock_pass_interval(void);       /* From the pass before to this one */
+uint32_t clock_frame_interval(void);      /* From the start of the last frame to this pass */
+uint32_t clock_budget_left(void);         /* Left of one VI period since this pass began, 0 when over */
@@ -1,40 +1,139 @@
 /* [1] debug.c - Diagnostics and debug info rendering for N64 display. */
 #include "debug.h"     /* [2] Own header for debug_info */
 #include "utils.h"     /* [3] Helper functions: formatting, safe string copy */
+#include "audio_engine.h" /* [3.1] Audio engine statistics */
+#include "transition.h"   /* [3.2] Transition mode and overlap mixer cost */
+#include "track_cache.h"  /* [3.3] Track cache counters */
+#include "gfx.h"          /* [3.4] Drawing layer and its CPU time per backend */
+#include "text.h"         /* [3.5] Batched text counters */
+#include "ui.h"           /* [3.8] Overlay lines are retained widgets */
+#include "video.h"        /* [3.10] Framebuffer depth, memory and fill time */
+#include "palette.h"      /* [3.11] Overlay color for the current depth */
+#include "governor.h"     /* [3.12] UI rate governor level */
+#include "mem.h"          /* [3.14] Memory per category */
+#include "arena.h"        /* [3.15] Line scratch, arena counters */
 
-/* [4] Draw diagnostic information (audio, performance, memory, uptime) on screen. */
-void debug_info(surface_t *disp, int sample_rate, float frame_ms, float cpu_percent,
-                float fps, int free_ram, int start_x, int start_y, unsigned int uptime_sec, double ram_total_mb, const wav64_t* wav,
-                const char* wav64_header_hex, uint8_t compression_level) {
+#define OVERLAY_MS_ALPHA 0.05f /* [3.6] Smoothing of the overlay cost */
+#define DEBUG_REFRESH_MS 250   /* [3.6.1] Overlay values are refreshed 4 times a second, so the
+                                  lines change rarely and quiet frames can be skipped */
+#define DEBUG_LINE_MAX 128     /* [3.6.2] Line buffer, from the frame arena */
+
+/* [3.7] Overlay benchmark: CPU ms of the debug_info() call for each text path. The lines are
+   widgets now, so this is formatting and compare only; drawing is in the "Draw:" line. */
+static float overlay_ms[GFX_TEXT_PATH_COUNT];
+
+/* [3.9] One overlay line = one widget, numbered in drawing order */
+static int debug_line = 0;
+static uint32_t debug_color = 0;
+
+static void debug_text(int x, int y, const char *s) {
+    if (debug_line < UI_ID_DEBUG_END - UI_ID_DEBUG) ui_text(UI_ID_DEBUG + debug_line++, x, y, debug_color, s);
+}
+
+/* [3.13] " avg/p95/p99/max" of a metric, each divided by `div` (two decimals); the slashes keep
+   the line inside the DEBUG_COLUMN_W column */
+static int append_stats(char *tmp, int size, int pos, const stats_t *st, float div) {
+    const uint32_t v[4] = { stats_mean(st), stats_percentile(st, 95), stats_percentile(st, 99), stats_max(st) };
+    for (int i = 0; i < 4; i++) {
+        pos = safe_append_str(tmp, size, pos, i ? "/" : " ");
+        pos += format_float_two_decimals(&tmp[pos], (float)v[i] / div);
+    }
+    return pos;
+}
+
+/* [4] Update the diagnostic information widgets (audio, performance, memory, uptime). */
+void debug_info(int sample_rate, const loop_metrics_t *metrics, int start_x, int start_y, unsigned int uptime_sec, double ram_total_mb, const wav64_t* wav,
+                const stream_t *stream, const char* wav64_header_hex, uint8_t compression_level) {
+    static uint32_t last_refresh = 0;
+    uint32_t bench_t0 = TICKS_READ();
+    if (last_refresh != 0 && TICKS_DISTANCE(last_refresh, bench_t0) < (int32_t)TICKS_FROM_MS(DEBUG_REFRESH_MS)) return;
+    last_refresh = bench_t0;
+    gfx_text_path_t text_path = gfx_get_text_path();
     int buf_len = audio_get_buffer_length();
     float buf_ms = (float)buf_len / (float)sample_rate * 1000.0f;
-    graphics_set_color(graphics_make_color(255, 255, 0, 255), 0);
-    char tmp[128];
+    debug_color = color_get(COL_DEBUG);
+    debug_line = 0;
+    char *tmp = (char *)arena_alloc(ARENA_FRAME, DEBUG_LINE_MAX);
+    if (!tmp) return;
     int line_height = 15;
     int y = start_y;
     int pos = 0;
 
-    /* [1] Total RAM (MB) */
-    pos = 0;
-    strcpy_s(tmp, sizeof(tmp), "Total RAM: ");
+    /* [1] Total RAM (MB), free heap, largest free block (KB) and fragmentation */
+    const mem_stats_t *mem = mem_get_stats();
+    strcpy_s(tmp, DEBUG_LINE_MAX, "RAM ");
     pos = tiny_strlen(tmp);
-    pos += format_float_two_decimals(&tmp[pos], ram_total_mb);
-    strcpy_s(&tmp[pos], sizeof(tmp) - pos, " MB");
-    graphics_draw_text(disp, start_x, y, tmp);
+    pos += int_to_dec(&tmp[pos], (int)(ram_total_mb + 0.5));
+    pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " MB free ");
+    pos += int_to_dec(&tmp[pos], (int)((mem->heap_total - mem->heap_used) / 1024u));
+    pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "K max ");
+    pos += int_to_dec(&tmp[pos], (int)(mem->largest_free / 1024u));
+    pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "K frag ");
+    pos += int_to_dec(&tmp[pos], (int)mem->frag_pct);
+    safe_append_str(tmp, DEBUG_LINE_MAX, pos, "%");
+    debug_text(start_x, y, tmp);
     y += line_height;
 
-    /* [2] Free RAM (bytes) */
-    pos = 0;
-    strcpy_s(tmp, sizeof(tmp), "Free RAM: ");
+    /* [2] KB per category now and at its peak ("!" after a peak over the budget), heap in no category */
+    strcpy_s(tmp, DEBUG_LINE_MAX, "KB");
     pos = tiny_strlen(tmp);
-    pos += int_to_dec(&tmp[pos], free_ram);
-    strcpy_s(&tmp[pos], sizeof(tmp) - pos, " bytes");
-    graphics_draw_text(disp, start_x, y, tmp);
+    for (int t = 0; t < MEM_TAG_COUNT; t++) {
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ");
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, mem_tag_name((mem_tag_t)t));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ");
+        pos += int_to_dec(&tmp[pos], (int)((mem->used[t] + 1023u) / 1024u));
+    }
+    debug_text(start_x, y, tmp);
+    y += line_height;
+    strcpy_s(tmp, DEBUG_LINE_MAX, "Peak");
+    pos = tiny_strlen(tmp);
+    for (int t = 0; t < MEM_TAG_COUNT; t++) {
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, t ? "/" : " ");
+        pos += int_to_dec(&tmp[pos], (int)((mem->peak[t] + 1023u) / 1024u));
+        if (mem->peak[t] > mem_tag_budget((mem_tag_t)t)) pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "!");
+    }
+    pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " other ");
+    pos += int_to_dec(&tmp[pos], (int)(mem->other / 1024u));
+    safe_append_str(tmp, DEBUG_LINE_MAX, pos, "K");
+    debug_text(start_x, y, tmp);
+    y += line_height;
+
+    /* [2.1] malloc/free calls in the last frame, steady-state frames that allocated */
+    strcpy_s(tmp, DEBUG_LINE_MAX, "Alloc/frame ");
+    pos = tiny_strlen(tmp);
+#if MEM_WRAP
+    pos += int_to_dec(&tmp[pos], (int)mem->frame_mallocs);
+    tmp[pos++] = '/';
+    pos += int_to_dec(&tmp[pos], (int)mem->frame_frees);
+    pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, ", steady ");
+    pos += int_to_dec(&tmp[pos], (int)mem->alloc_frames);
+#else
+    pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "n/a (MEM_WRAP=0)");
+#endif
+    debug_text(start_x, y, tmp);
+    y += line_height;
+
+    /* [2.2] Arenas: KB used / high-water mark, "!" after one that refused an allocation */
+    strcpy_s(tmp, DEBUG_LINE_MAX, "Arena KB");
+    pos = tiny_strlen(tmp);
+    for (int a = 0; a < ARENA_COUNT; a++) {
+        arena_stats_t as;
+        arena_get_stats((arena_id_t)a, &as);
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ");
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, arena_name((arena_id_t)a));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ");
+        pos += int_to_dec(&tmp[pos], (int)((as.used + 1023u) / 1024u));
+        tmp[pos++] = '/';
+        pos += int_to_dec(&tmp[pos], (int)((as.peak + 1023u) / 1024u));
+        if (as.failed) tmp[pos++] = '!';
+        tmp[pos] = '\0';
+    }
+    debug_text(start_x, y, tmp);
     y += line_height;
 
     /* [3] Resolution info (moved from main.c) */
     pos = 0;
-    strcpy_s(tmp, sizeof(tmp), "Resolution: ");
+    strcpy_s(tmp, DEBUG_LINE_MAX, "Resolution: ");
     pos = tiny_strlen(tmp);
     // Zakadamy, e szeroko i wysoko ekranu mona pobra przez display_get_width/height
     pos += int_to_dec(&tmp[pos], display_get_width());
@@ -42,45 +141,61 @@ void debug_info(surface_t *disp, int sample_rate, float frame_ms, float cpu_perc
     pos += int_to_dec(&tmp[pos], display_get_height());
     tmp[pos++] = 'p'; // lub 'i' jeli interlaced, tu uproszczenie
     tmp[pos] = '\0';
-    graphics_draw_text(disp, start_x, y, tmp);
+    debug_text(start_x, y, tmp);
     y += line_height;
 
     /* [4] Audio buffer: samples (ms) */
     pos = 0;
-    strcpy_s(tmp, sizeof(tmp), "Audio buffer: ");
+    strcpy_s(tmp, DEBUG_LINE_MAX, "Audio buffer: ");
     pos = tiny_strlen(tmp);
     pos += int_to_dec(&tmp[pos], buf_len);
-    strcpy_s(&tmp[pos], sizeof(tmp) - pos, " samples (");
+    strcpy_s(&tmp[pos], DEBUG_LINE_MAX - pos, " samples (");
     pos = tiny_strlen(tmp);
     pos += format_float_two_decimals(&tmp[pos], buf_ms);
-    strcpy_s(&tmp[pos], sizeof(tmp) - pos, " ms)");
-    graphics_draw_text(disp, start_x, y, tmp);
+    strcpy_s(&tmp[pos], DEBUG_LINE_MAX - pos, " ms)");
+    debug_text(start_x, y, tmp);
     y += line_height;
 
-    /* [6] Frame time */
+    /* [5] Audio buffers mixed and underruns */
     pos = 0;
-    strcpy_s(tmp, sizeof(tmp), "Frame time: ");
+    strcpy_s(tmp, DEBUG_LINE_MAX, "Audio mixed: ");
     pos = tiny_strlen(tmp);
-    pos += format_float_two_decimals(&tmp[pos], frame_ms);
-    strcpy_s(&tmp[pos], sizeof(tmp) - pos, " ms");
-    graphics_draw_text(disp, start_x, y, tmp);
+    pos += int_to_dec(&tmp[pos], (int)audio_engine_get_buffers_mixed());
+    pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " underruns: ");
+    pos += int_to_dec(&tmp[pos], (int)audio_engine_get_underruns());
+    debug_text(start_x, y, tmp);
     y += line_height;
 
-    /* [7] CPU usage */
-    pos = 0;
-    strcpy_s(tmp, sizeof(tmp), "CPU usage: ");
-    pos = tiny_strlen(tmp);
-    pos += format_float_two_decimals(&tmp[pos], cpu_percent);
-    strcpy_s(&tmp[pos], sizeof(tmp) - pos, " %");
-    graphics_draw_text(disp, start_x, y, tmp);
+    /* [6] Frame time (ms): average, p95, p99 and worst of the last frames */
+    strcpy_s(tmp, DEBUG_LINE_MAX, "Frame ms:");
+    append_stats(tmp, DEBUG_LINE_MAX, tiny_strlen(tmp), &metrics->frame_us, 1000.0f);
+    debug_text(start_x, y, tmp);
     y += line_height;
 
-    /* [8] FPS */
-    pos = 0;
-    strcpy_s(tmp, sizeof(tmp), "FPS: ");
+    /* [7] CPU usage (%) */
+    strcpy_s(tmp, DEBUG_LINE_MAX, "CPU %:");
+    append_stats(tmp, DEBUG_LINE_MAX, tiny_strlen(tmp), &metrics->cpu_pct10, 10.0f);
+    debug_text(start_x, y, tmp);
+    y += line_height;
+
+    /* [8] FPS from the average frame interval, and the p99 interval (a spike shows there) */
+    strcpy_s(tmp, DEBUG_LINE_MAX, "FPS: ");
     pos = tiny_strlen(tmp);
-    pos += format_float_two_decimals(&tmp[pos], fps);
-    graphics_draw_text(disp, start_x, y, tmp);
+    uint32_t interval = stats_mean(&metrics->interval_us);
+    pos += format_float_two_decimals(&tmp[pos], interval ? 1000000.0f / (float)interval : 0.0f);
+    pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " p99 ");
+    pos += format_float_two_decimals(&tmp[pos], (float)stats_percentile(&metrics->interval_us, 99) / 1000.0f);
+    safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ms");
+    debug_text(start_x, y, tmp);
+    y += line_height;
+
+    /* [8.1] Mixer time per audio buffer (ms) and the lowest output ring fill */
+    strcpy_s(tmp, DEBUG_LINE_MAX, "Mix ms:");
+    pos = append_stats(tmp, DEBUG_LINE_MAX, tiny_strlen(tmp), &metrics->mix_us, 1000.0f);
+    pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " fill ");
+    pos += int_to_dec(&tmp[pos], (int)stats_min(&metrics->fill_pct));
+    safe_append_str(tmp, DEBUG_LINE_MAX, pos, "%");
+    debug_text(start_x, y, tmp);
     y += line_height;
 
     /* [9] Uptime */
@@ -88,7 +203,7 @@ void debug_info(surface_t *disp, int sample_rate, float frame_ms, float cpu_perc
     unsigned int minutes = (uptime_sec % 3600) / 60;
     unsigned int seconds = uptime_sec % 60;
     pos = 0;
-    strcpy_s(tmp, sizeof(tmp), "Uptime: ");
+    strcpy_s(tmp, DEBUG_LINE_MAX, "Uptime: ");
     pos = tiny_strlen(tmp);
     pos += append_uint_zero_pad(&tmp[pos], hours, 2);
     tmp[pos++] = ':';
@@ -96,64 +211,256 @@ void debug_info(surface_t *disp, int sample_rate, float frame_ms, float cpu_perc
     tmp[pos++] = ':';
     pos += append_uint_zero_pad(&tmp[pos], seconds, 2);
     tmp[pos] = '\0';
-    graphics_draw_text(disp, start_x, y, tmp);
+    debug_text(start_x, y, tmp);
 
     /* [10] WAV64 info */
     if (wav) {
         y += line_height;
         pos = 0;
-        strcpy_s(tmp, sizeof(tmp), "WAV64 frequency: ");
+        strcpy_s(tmp, DEBUG_LINE_MAX, "WAV64 frequency: ");
         pos = tiny_strlen(tmp);
         pos += int_to_dec(&tmp[pos], (int)wav->wave.frequency);
-        strcpy_s(&tmp[pos], sizeof(tmp) - pos, " Hz");
-        graphics_draw_text(disp, start_x, y, tmp);
+        strcpy_s(&tmp[pos], DEBUG_LINE_MAX - pos, " Hz");
+        debug_text(start_x, y, tmp);
         y += line_height;
         pos = 0;
-        strcpy_s(tmp, sizeof(tmp), "WAV64 samples: ");
+        strcpy_s(tmp, DEBUG_LINE_MAX, "WAV64 samples: ");
         pos = tiny_strlen(tmp);
         pos += int_to_dec(&tmp[pos], (int)wav->wave.len);
-        graphics_draw_text(disp, start_x, y, tmp);
+        debug_text(start_x, y, tmp);
         y += line_height;
         pos = 0;
-        strcpy_s(tmp, sizeof(tmp), "WAV64 channels: ");
+        strcpy_s(tmp, DEBUG_LINE_MAX, "WAV64 channels: ");
         pos = tiny_strlen(tmp);
         pos += int_to_dec(&tmp[pos], (int)wav->wave.channels);
         if (wav->wave.channels == 1)
-            strcpy_s(&tmp[pos], sizeof(tmp) - pos, " (Mono)");
+            strcpy_s(&tmp[pos], DEBUG_LINE_MAX - pos, " (Mono)");
         else if (wav->wave.channels == 2)
-            strcpy_s(&tmp[pos], sizeof(tmp) - pos, " (Stereo)");
-        graphics_draw_text(disp, start_x, y, tmp);
+            strcpy_s(&tmp[pos], DEBUG_LINE_MAX - pos, " (Stereo)");
+        debug_text(start_x, y, tmp);
         y += line_height;
         pos = 0;
-        strcpy_s(tmp, sizeof(tmp), "WAV64 bits: ");
+        strcpy_s(tmp, DEBUG_LINE_MAX, "WAV64 bits: ");
         pos = tiny_strlen(tmp);
         pos += int_to_dec(&tmp[pos], (int)wav->wave.bits);
-        graphics_draw_text(disp, start_x, y, tmp);
+        debug_text(start_x, y, tmp);
         y += line_height;
         // Bitrate
-        int bitrate_bps = wav64_get_bitrate((wav64_t*)wav);
+        int bitrate_bps = stream ? (int)stream->bitrate : 0; /* From the catalog (or the header at open) */
         int bitrate_kbps = (bitrate_bps > 0) ? (bitrate_bps / 1000) : ((wav->wave.frequency * wav->wave.channels * wav->wave.bits) / 1000);
         pos = 0;
-        strcpy_s(tmp, sizeof(tmp), "WAV64 bitrate: ");
+        strcpy_s(tmp, DEBUG_LINE_MAX, "WAV64 bitrate: ");
         pos = tiny_strlen(tmp);
         pos += int_to_dec(&tmp[pos], bitrate_kbps);
-        strcpy_s(&tmp[pos], sizeof(tmp) - pos, " kbps");
-        graphics_draw_text(disp, start_x, y, tmp);
+        strcpy_s(&tmp[pos], DEBUG_LINE_MAX - pos, " kbps");
+        debug_text(start_x, y, tmp);
         y += line_height;
         // Compression (przeniesione z main.c, teraz przez argument compression_level)
         pos = 0;
-        strcpy_s(tmp, sizeof(tmp), "WAV64 compression: ");
+        strcpy_s(tmp, DEBUG_LINE_MAX, "WAV64 compression: ");
         pos = tiny_strlen(tmp);
         if (compression_level == 0)
-            strcpy_s(&tmp[pos], sizeof(tmp) - pos, "PCM (0)");
+            strcpy_s(&tmp[pos], DEBUG_LINE_MAX - pos, "PCM (0)");
         else if (compression_level == 1)
-            strcpy_s(&tmp[pos], sizeof(tmp) - pos, "VADPCM (1)");
+            strcpy_s(&tmp[pos], DEBUG_LINE_MAX - pos, "VADPCM (1)");
         else if (compression_level == 3)
-            strcpy_s(&tmp[pos], sizeof(tmp) - pos, "Opus (3)");
+            strcpy_s(&tmp[pos], DEBUG_LINE_MAX - pos, "Opus (3)");
         else
             int_to_dec(&tmp[pos], (int)compression_level);
-        graphics_draw_text(disp, start_x, y, tmp);
+        debug_text(start_x, y, tmp);
     }
+    /* [10.1] Seek index memory, build progress and last/max seek latency */
+    if (stream) {
+        y += line_height;
+        pos = 0;
+        strcpy_s(tmp, DEBUG_LINE_MAX, "Seek idx: ");
+        pos = tiny_strlen(tmp);
+        pos += int_to_dec(&tmp[pos], stream_index_bytes(stream));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " B ");
+        pos += int_to_dec(&tmp[pos], stream_index_percent(stream));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "% seek ");
+        pos += int_to_dec(&tmp[pos], (int)(stream->last_seek_us / 1000));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "/");
+        pos += int_to_dec(&tmp[pos], (int)(stream->max_seek_us / 1000));
+        safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ms");
+        debug_text(start_x, y, tmp);
+    }
+    /* [10.2] Transition settings and mixer cost per buffer: one track vs. the last overlap */
+    {
+        transition_stats_t ts;
+        transition_get_stats(&ts);
+        y += line_height;
+        strcpy_s(tmp, DEBUG_LINE_MAX, "Trans: ");
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, -1, transition_mode_name(transition_get_mode()));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ");
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, transition_curve_name(transition_get_curve()));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ");
+        pos += int_to_dec(&tmp[pos], (int)transition_get_length_ms());
+        safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ms");
+        debug_text(start_x, y, tmp);
+        y += line_height;
+        strcpy_s(tmp, DEBUG_LINE_MAX, "Mix us: ");
+        pos = tiny_strlen(tmp);
+        pos += int_to_dec(&tmp[pos], (int)ts.base_mix_us);
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " xfade ");
+        pos += int_to_dec(&tmp[pos], (int)ts.overlap_mix_us);
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " pk ");
+        pos += int_to_dec(&tmp[pos], (int)ts.overlap_peak_us);
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "/");
+        pos += int_to_dec(&tmp[pos], (int)ts.buffer_us);
+        debug_text(start_x, y, tmp);
+    }
+    /* [10.3] Track cache: tracks and KB used of the budget, hit/miss/evict counters */
+    {
+        track_cache_stats_t cs;
+        track_cache_get_stats(&cs);
+        y += line_height;
+        strcpy_s(tmp, DEBUG_LINE_MAX, "Cache: ");
+        pos = tiny_strlen(tmp);
+        pos += int_to_dec(&tmp[pos], (int)cs.entries);
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " trk ");
+        pos += int_to_dec(&tmp[pos], (int)(cs.used / 1024));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "/");
+        pos += int_to_dec(&tmp[pos], (int)(cs.budget / 1024));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " KB h ");
+        pos += int_to_dec(&tmp[pos], (int)cs.hits);
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " m ");
+        pos += int_to_dec(&tmp[pos], (int)cs.misses);
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " e ");
+        pos += int_to_dec(&tmp[pos], (int)cs.evictions);
+        debug_text(start_x, y, tmp);
+    }
+    /* [10.4] Drawing backend and CPU ms per frame of both (the inactive one keeps its last value) */
+    {
+        gfx_backend_t b = gfx_get_backend();
+        gfx_backend_t other = (b == GFX_BACKEND_RDPQ) ? GFX_BACKEND_SOFTWARE : GFX_BACKEND_RDPQ;
+        y += line_height;
+        strcpy_s(tmp, DEBUG_LINE_MAX, "Draw: ");
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, -1, gfx_backend_name(b));
+        tmp[pos++] = ' ';
+        pos += format_float_two_decimals(&tmp[pos], gfx_get_cpu_ms(b));
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ms (");
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, gfx_backend_name(other));
+        tmp[pos++] = ' ';
+        pos += format_float_two_decimals(&tmp[pos], gfx_get_cpu_ms(other));
+        safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ms)");
+        debug_text(start_x, y, tmp);
+    }
+    /* [10.5] Overlay cost per text path (last frames) and the batch counters */
+    {
+        y += line_height;
+        strcpy_s(tmp, DEBUG_LINE_MAX, "Overlay ms:");
+        pos = tiny_strlen(tmp);
+        for (int p = 0; p < GFX_TEXT_PATH_COUNT; p++) {
+            tmp[pos++] = ' ';
+            if (p == (int)text_path) tmp[pos++] = '*';
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, gfx_text_path_name((gfx_text_path_t)p));
+            tmp[pos++] = ' ';
+            pos += format_float_two_decimals(&tmp[pos], overlay_ms[p]);
+        }
+        debug_text(start_x, y, tmp);
+        if (text_path == GFX_TEXT_BATCHED) {
+            text_stats_t ts;
+            text_get_stats(&ts);
+            y += line_height;
+            strcpy_s(tmp, DEBUG_LINE_MAX, "Text: ");
+            pos = tiny_strlen(tmp);
+            pos += int_to_dec(&tmp[pos], (int)ts.runs);
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " runs ");
+            pos += int_to_dec(&tmp[pos], (int)ts.reused);
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " cached ");
+            pos += int_to_dec(&tmp[pos], (int)ts.glyphs);
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " glyphs ");
+            pos += int_to_dec(&tmp[pos], (int)ts.flushes);
+            safe_append_str(tmp, DEBUG_LINE_MAX, pos, " pass");
+            debug_text(start_x, y, tmp);
+        }
+    }
+    /* [10.6] Retained screen: widgets drawn / visible in the last rendered frame, rectangles
+       restored from the background, and the share of frames skipped because nothing changed */
+    {
+        ui_stats_t us;
+        ui_get_stats(&us);
+        y += line_height;
+        strcpy_s(tmp, DEBUG_LINE_MAX, "UI: ");
+        pos = tiny_strlen(tmp);
+        if (!ui_get_retained()) {
+            safe_append_str(tmp, DEBUG_LINE_MAX, pos, "full redraw");
+        } else {
+            pos += int_to_dec(&tmp[pos], (int)us.drawn);
+            tmp[pos++] = '/';
+            pos += int_to_dec(&tmp[pos], (int)us.widgets);
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, us.full ? " full, skip " : " drawn, skip ");
+            pos += int_to_dec(&tmp[pos], (int)us.skip_pct);
+            safe_append_str(tmp, DEBUG_LINE_MAX, pos, "%");
+        }
+        debug_text(start_x, y, tmp);
+    }
+    /* [10.7] Framebuffer per depth: memory at this resolution (buffers + UI background) and one
+       full-screen fill on the RDP / CPU in us (measured at the last switch to that depth) */
+    {
+        y += line_height;
+        strcpy_s(tmp, DEBUG_LINE_MAX, "FB:");
+        pos = tiny_strlen(tmp);
+        for (int bpp = 16; bpp <= 32; bpp += 16) {
+            video_depth_stats_t vs;
+            video_get_depth_stats(bpp, &vs);
+            tmp[pos++] = ' ';
+            if (bpp == video_get_bpp()) tmp[pos++] = '*';
+            pos += int_to_dec(&tmp[pos], bpp);
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "b ");
+            pos += int_to_dec(&tmp[pos], (int)(vs.fb_bytes / 1024));
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "K ");
+            if (vs.fill_rdp_us) {
+                pos += int_to_dec(&tmp[pos], (int)vs.fill_rdp_us);
+                tmp[pos++] = '/';
+                pos += int_to_dec(&tmp[pos], (int)vs.fill_cpu_us);
+                pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "us");
+            } else {
+                pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "-");
+            }
+        }
+        debug_text(start_x, y, tmp);
+    }
+    /* [10.8] Mode switches: last and longest duration (ms) and audio underruns during them */
+    {
+        video_switch_stats_t ss;
+        video_get_switch_stats(&ss);
+        if (ss.count) {
+            y += line_height;
+            strcpy_s(tmp, DEBUG_LINE_MAX, "Switch: ");
+            pos = tiny_strlen(tmp);
+            pos += int_to_dec(&tmp[pos], (int)ss.count);
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "x last ");
+            pos += format_float_two_decimals(&tmp[pos], (float)ss.last_us / 1000.0f);
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " max ");
+            pos += format_float_two_decimals(&tmp[pos], (float)ss.max_us / 1000.0f);
+            pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, " ms, underruns ");
+            pos += int_to_dec(&tmp[pos], (int)ss.underruns);
+            debug_text(start_x, y, tmp);
+        }
+    }
+    /* [10.9] Framebuffers and how often getting one would have blocked (last frames, total) */
+    {
+        video_acquire_stats_t as;
+        video_get_acquire_stats(&as);
+        y += line_height;
+        strcpy_s(tmp, DEBUG_LINE_MAX, "FB x");
+        pos = tiny_strlen(tmp);
+        pos += int_to_dec(&tmp[pos], (int)display_get_num_buffers());
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, ": blocked ");
+        pos += int_to_dec(&tmp[pos], (int)as.blocked_pct);
+        pos = safe_append_str(tmp, DEBUG_LINE_MAX, pos, "% (");
+        pos += int_to_dec(&tmp[pos], (int)as.blocked);
+        tmp[pos++] = '/';
+        pos += int_to_dec(&tmp[pos], (int)as.frames);
+        safe_append_str(tmp, DEBUG_LINE_MAX, pos, ")");
+        debug_text(start_x, y, tmp);
+    }
+    /* [10.10] UI rate governor: level, audio headroom and drawn frame CPU time of the last window */
+    y += line_height;
+    governor_describe(tmp, DEBUG_LINE_MAX);
+    debug_text(start_x, y, tmp);
     /* [11] WAV64 header hex (split into two lines) */
     if (wav64_header_hex && wav64_header_hex[0]) {
         y += line_height;
@@ -168,13 +475,18 @@ void debug_info(surface_t *disp, int sample_rate, float frame_ms, float cpu_perc
         idx = 0;
         for (i = split_pos; i < hex_len && idx < (int)sizeof(hex_line2) - 1; i++) hex_line2[idx++] = wav64_header_hex[i];
         hex_line2[idx] = '\0';
-        strcpy_s(tmp, sizeof(tmp), "WAV64 header: ");
-        safe_append_str(tmp, sizeof(tmp), -1, hex_line1);
-        graphics_draw_text(disp, start_x, y, tmp);
+        strcpy_s(tmp, DEBUG_LINE_MAX, "WAV64 header: ");
+        safe_append_str(tmp, DEBUG_LINE_MAX, -1, hex_line1);
+        debug_text(start_x, y, tmp);
         y += line_height;
         // Wyznacz offset do danych (po "WAV64 header: ")
         int label_len = tiny_strlen("WAV64 header: ");
         int x_offset = start_x + label_len * 8; // 8 px na znak
-        graphics_draw_text(disp, x_offset, y, hex_line2);
+        debug_text(x_offset, y, hex_line2);
     }
+    /* [12] Lines not produced this time (shorter overlay) disappear */
+    ui_hide_range(UI_ID_DEBUG + debug_line, UI_ID_DEBUG_END);
+    float ms = (float)TICKS_TO_US(TICKS_READ() - bench_t0) / 1000.0f;
+    float *avg = &overlay_ms[text_path];
+    *avg = (*avg <= 0.0f) ? ms : (1.0f - OVERLAY_MS_ALPHA) * *avg + OVERLAY_MS_ALPHA * ms;
 }
\ No newline at end of file
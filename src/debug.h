@@ -2,10 +2,22 @@
 #define DEBUG_H
 #include <libdragon.h>
 #include "wav64.h"
+#include "stream.h"
+#include "stats.h"
 
-/* [1] Draw diagnostic information (audio, performance, memory, uptime) on screen. */
-void debug_info(surface_t *disp, int sample_rate, float frame_ms, float cpu_percent,
-                float fps, int free_ram, int start_x, int start_y, unsigned int uptime_sec, double ram_total_mb, const wav64_t* wav,
-                const char* wav64_header_hex, uint8_t compression_level);
+/* [0.1] Windowed loop metrics kept by main.c */
+typedef struct {
+    stats_t frame_us;      /* CPU time of a loop pass that drew or skipped a frame */
+    stats_t interval_us;   /* Time between frames (FPS) */
+    stats_t cpu_pct10;     /* CPU %, in tenths */
+    stats_t mix_us;        /* Mixer time per audio buffer */
+    stats_t fill_pct;      /* Audio output ring fill at the pump */
+} loop_metrics_t;
+
+#define DEBUG_COLUMN_W 328 /* [0] Width of the overlay column (41 characters) */
+
+/* [1] Update the diagnostic information widgets (audio, performance, memory, uptime). */
+void debug_info(int sample_rate, const loop_metrics_t *metrics, int start_x, int start_y, unsigned int uptime_sec, double ram_total_mb, const wav64_t* wav,
+                const stream_t *stream, const char* wav64_header_hex, uint8_t compression_level);
 
 #endif /* DEBUG_H */
\ No newline at end of file
@@ -0,0 +1,121 @@
+/* [1] evlog.c - Deferred binary event log (see evlog.h) */
+#include "evlog.h"
+#include <libdragon.h>
+#include <stdio.h>
+#include "clock.h" /* [2] Timestamps and the flush budget */
+
+/* [3] One record. The N64 is big-endian, so records are written out as they are. */
+typedef struct {
+    uint64_t time_us;
+    uint16_t id;
+    uint8_t argc;
+    uint8_t skipped;
+    uint32_t args[EVLOG_MAX_ARGS];
+    uint32_t reserved;
+} evlog_record_t;
+_Static_assert(sizeof(evlog_record_t) == EVLOG_RECORD_SIZE, "evlog record layout");
+
+static evlog_record_t ring[EVLOG_RING];
+static uint32_t head = 0, count = 0;  /* Oldest record, records waiting */
+static uint32_t dropped = 0;          /* Since the last DROPPED record */
+static FILE *file = NULL;
+static bool unsynced = false;         /* Records written to `file` but not fflush()ed yet */
+
+void evlog_init(void) {
+    file = fopen(EVLOG_FILE, "wb");
+    if (!file) return; /* No SD card: ISViewer lines */
+    static const uint8_t header[EVLOG_HEADER_SIZE] = { 'M', 'L', 'O', 'G', EVLOG_VERSION, EVLOG_RECORD_SIZE, 0, 0 };
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+/* [4] Store a record: a copy of at most 32 bytes */
+static void put(int id, const uint32_t *args, int argc, uint32_t skipped) {
+    evlog_record_t *r = &ring[(head + count) % EVLOG_RING];
+    r->time_us = clock_to_us(clock_now());
+    r->id = (uint16_t)id;
+    r->argc = (uint8_t)argc;
+    r->skipped = (uint8_t)(skipped > 255 ? 255 : skipped);
+    for (int i = 0; i < EVLOG_MAX_ARGS; i++) r->args[i] = i < argc ? args[i] : 0;
+    r->reserved = 0;
+    count++;
+}
+
+/* [4.1] The last slot is kept for the DROPPED record, so it goes in at its place in time */
+static void put_dropped(void) {
+    put(EV_DROPPED, &dropped, 1, 0);
+    dropped = 0;
+}
+
+void evlog_write(int id, const uint32_t *args, int argc, uint32_t skipped) {
+    if (count >= EVLOG_RING - 1) { dropped++; return; }
+    if (argc > EVLOG_MAX_ARGS) argc = EVLOG_MAX_ARGS;
+    if (dropped) put_dropped();
+    put(id, args, argc, skipped);
+}
+
+/* [5] Rate limit: due once `min_ms` have passed since the last record of the site */
+bool evlog_site_due(evlog_site_t *site, uint32_t min_ms) {
+    uint64_t now = clock_now();
+    if (site->last && now - site->last < clock_from_us((uint64_t)min_ms * 1000u)) {
+        site->skipped++;
+        return false;
+    }
+    site->last = now;
+    return true;
+}
+
+uint32_t evlog_site_take(evlog_site_t *site) {
+    uint32_t n = site->skipped;
+    site->skipped = 0;
+    return n;
+}
+
+/* [6] Sinks */
+static void write_isviewer(const evlog_record_t *r) {
+    static const char hex[] = "0123456789abcdef";
+    char line[sizeof(EVLOG_LINE_TAG) + EVLOG_RECORD_SIZE * 2];
+    const uint8_t *b = (const uint8_t *)r;
+    int pos = (int)sizeof(EVLOG_LINE_TAG) - 1;
+    for (int i = 0; i < pos; i++) line[i] = EVLOG_LINE_TAG[i];
+    for (int i = 0; i < EVLOG_RECORD_SIZE; i++) {
+        line[pos++] = hex[b[i] >> 4];
+        line[pos++] = hex[b[i] & 15];
+    }
+    line[pos] = '\0';
+    debugf("%s\n", line);
+}
+
+static void write_records(const evlog_record_t *r, uint32_t n) {
+    if (file) {
+        fwrite(r, sizeof(*r), n, file);
+        unsynced = true;
+        return;
+    }
+    for (uint32_t i = 0; i < n; i++) write_isviewer(&r[i]);
+}
+
+/* [7] Batches run up to the end of the ring, so each is one contiguous write */
+void evlog_flush(uint32_t budget_ticks) {
+    if (budget_ticks == 0 || (count == 0 && !unsynced)) return;
+    uint64_t t0 = clock_now();
+    while (count > 0 && clock_now() - t0 < budget_ticks) {
+        uint32_t n = count;
+        if (n > EVLOG_FLUSH_BATCH) n = EVLOG_FLUSH_BATCH;
+        if (n > EVLOG_RING - head) n = EVLOG_RING - head;
+        write_records(&ring[head], n);
+        head = (head + n) % EVLOG_RING;
+        count -= n;
+    }
+    if (dropped) put_dropped(); /* Written by the next flush */
+    /* [7.1] fflush() is an SD write of its own: only once the ring is empty and the budget
+       still has time left, otherwise a later frame does it */
+    if (unsynced && count == 0 && clock_now() - t0 < budget_ticks) {
+        fflush(file);
+        unsynced = false;
+    }
+}
+
+uint32_t evlog_pending(void) { return count; }
@@ -0,0 +1,53 @@
+/* [1] evlog.h - Deferred binary event log. A log call stores a fixed 32-byte record (time, event
+   id, up to four u32 arguments) in a RAM ring and returns: no formatting, no I/O. The ring is
+   written out in the idle time left at the end of a frame, to sd:/ when an SD card is mounted
+   and as hex lines on the ISViewer otherwise; tools/evlogdump turns either into text or CSV.
+   Events and their text are in evlog_format.h. Main loop only (not from interrupts). */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "evlog_format.h"
+
+#ifndef EVLOG_MIN_LEVEL
+#define EVLOG_MIN_LEVEL EVLOG_INFO  /* [2] Build flag: lower levels are compiled out */
+#endif
+#define EVLOG_RING 256              /* Records kept until the next flush (8 KB) */
+#define EVLOG_FLUSH_BATCH 16        /* Records per write */
+#define EVLOG_FILE "sd:/mca64.evl"
+
+/* [3] Level of each event, as constants the compiler can drop a call on */
+#define EVLOG_LVL_(name, level, text) EVLOG_LVL_##name = level,
+enum { EVLOG_EVENTS(EVLOG_LVL_) EVLOG_LVL_END_ };
+#undef EVLOG_LVL_
+
+/* [4] Rate limit state of one call site */
+typedef struct {
+    uint64_t last;      /* Ticks of the last record written */
+    uint32_t skipped;   /* Calls dropped since then */
+} evlog_site_t;
+
+/* [5] Open the sink (after debug_init(), which mounts the SD card) */
+void evlog_init(void);
+
+/* [6] Log an event: EVLOG(SLOW_FRAME, us, budget). EVLOG_EVERY(ms, ...) writes at most one
+   record per `ms` from that call site; the next record says how many were skipped. */
+#define EVLOG_ARGV_(...) ((const uint32_t[]){ 0, __VA_ARGS__ } + 1)
+#define EVLOG_ARGC_(...) ((int)(sizeof((const uint32_t[]){ 0, __VA_ARGS__ }) / sizeof(uint32_t)) - 1)
+#define EVLOG(name, ...) do { \
+        if (EVLOG_LVL_##name >= EVLOG_MIN_LEVEL) \
+            evlog_write(EV_##name, EVLOG_ARGV_(__VA_ARGS__), EVLOG_ARGC_(__VA_ARGS__), 0); \
+    } while (0)
+#define EVLOG_EVERY(ms, name, ...) do { \
+        static evlog_site_t evlog_site_; \
+        if (EVLOG_LVL_##name >= EVLOG_MIN_LEVEL && evlog_site_due(&evlog_site_, (ms))) \
+            evlog_write(EV_##name, EVLOG_ARGV_(__VA_ARGS__), EVLOG_ARGC_(__VA_ARGS__), evlog_site_take(&evlog_site_)); \
+    } while (0)
+
+void evlog_write(int id, const uint32_t *args, int argc, uint32_t skipped);
+bool evlog_site_due(evlog_site_t *site, uint32_t min_ms);
+uint32_t evlog_site_take(evlog_site_t *site);
+
+/* [7] Write out records until `budget_ticks` are used (0: nothing). A full ring drops new
+   records and counts them; the count is written as a DROPPED record. */
+void evlog_flush(uint32_t budget_ticks);
+uint32_t evlog_pending(void);
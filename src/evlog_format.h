@@ -0,0 +1,57 @@
+/* [1] evlog_format.h - Binary event log records and the event table, shared by the player
+   (src/evlog.c) and the host decoder (tools/evlogdump.c), so it only uses <stdint.h>.
+   All numbers are big-endian, like the catalog. */
+#ifndef EVLOG_FORMAT_H
+#define EVLOG_FORMAT_H
+#pragma once
+#include <stdint.h>
+
+/* [2] Levels. Events below EVLOG_MIN_LEVEL (build flag) are compiled out. */
+#define EVLOG_DEBUG 0
+#define EVLOG_INFO 1
+#define EVLOG_WARN 2
+#define EVLOG_ERROR 3
+
+/* [3] Events: name, level, text. Arguments are u32 and the text takes them in order
+   (%u, %d, %x only). New events go at the end: the id is the position in the table. */
+#define EVLOG_EVENTS(X) \
+    X(DROPPED,     EVLOG_ERROR, "log ring full: %u records dropped") \
+    X(BOOT,        EVLOG_INFO,  "boot: %u KB RAM, TV type %u") \
+    X(SPRITE,      EVLOG_DEBUG, "logo sprite %ux%u, %ux%u slices") \
+    X(SPRITE_FMT,  EVLOG_DEBUG, "logo sprite format %u, fits TMEM %u") \
+    X(PLAYLIST,    EVLOG_INFO,  "playlist: %u tracks in %u us (catalog %u)") \
+    X(LOOP_TEST,   EVLOG_INFO,  "loop boundary self-test: %u (1 = bit-exact)") \
+    X(POOL_FAIL,   EVLOG_ERROR, "video pool: no memory for %u bytes") \
+    X(MODE,        EVLOG_INFO,  "mode %ux%u, render %ux%u") \
+    X(MODE_SWITCH, EVLOG_INFO,  "mode switch: %u bpp in %u us, %u underruns") \
+    X(SLOW_FRAME,  EVLOG_WARN,  "slow frame: %u us (VI period %u us)") \
+    X(UNDERRUN,    EVLOG_WARN,  "audio underruns: %u total") \
+    X(GOV_LEVEL,   EVLOG_INFO,  "UI rate level %u -> %u") \
+    X(TRACK,       EVLOG_INFO,  "track %u of %u") \
+    X(FRAME_ALLOC, EVLOG_WARN,  "playback frame allocated: %u malloc, %u free") \
+    X(MEM_BUDGET,  EVLOG_WARN,  "memory category %u over budget: %u KB of %u KB") \
+    X(OPUS_LAYOUT, EVLOG_WARN,  "opus reader at offset %u after packet 0, expected %u: no seek index")
+
+#define EVLOG_ID_(name, level, text) EV_##name,
+enum { EVLOG_EVENTS(EVLOG_ID_) EV_COUNT };
+#undef EVLOG_ID_
+
+/* [4] One record, fixed size: time (u64 us since boot, so it never wraps), event id, argument
+   count, events the site skipped before this one (rate limit, 255 = 255 or more), four u32
+   arguments (unused ones 0), then 4 reserved bytes (0) */
+#define EVLOG_MAX_ARGS 4
+#define EVLOG_OFS_TIME 0
+#define EVLOG_OFS_ID 8
+#define EVLOG_OFS_ARGC 10
+#define EVLOG_OFS_SKIPPED 11
+#define EVLOG_OFS_ARGS 12
+#define EVLOG_RECORD_SIZE 32
+
+/* [5] Sinks. File: "MLOG", u8 version, u8 record size, u16 pad, then records. ISViewer (no SD
+   card): one text line per record, EVLOG_LINE_TAG and the record as 64 hex digits. */
+#define EVLOG_MAGIC "MLOG"
+#define EVLOG_VERSION 2  /* 1: 24-byte records with a 32-bit time */
+#define EVLOG_HEADER_SIZE 8
+#define EVLOG_LINE_TAG "EVL "
+
+#endif /* EVLOG_FORMAT_H */
@@ -0,0 +1,265 @@
+/* [1] gfx.c - Drawing layer with an RDP (rdpq) backend and the CPU (graphics_*) fallback.
+   Every call adds its own CPU time to the frame total, so the two backends can be compared
+   on the same screen. */
+#include "gfx.h"
+#include "text.h" /* [1.1] Batched glyph-atlas text */
+#include "utils.h" /* [1.2] fast_memcpy */
+#include "prof.h"  /* [1.3] Text flush zone */
+#include "mem.h"   /* [1.4] RDP queue and font memory */
+
+#define GFX_FONT_ID 1    /* [2] rdpq text font slot (builtin 8x8 debug font) */
+#define GFX_FONT_ASCENT 8 /* graphics_draw_text takes the top of the glyph, rdpq_text the baseline */
+
+/* [3] RDP mode currently set, so runs of fills do not switch modes again */
+typedef enum { RDP_MODE_NONE = 0, RDP_MODE_FILL, RDP_MODE_STANDARD, RDP_MODE_BLIT } rdp_mode_t;
+
+static gfx_backend_t backend = GFX_BACKEND_RDPQ;
+static gfx_backend_t next_backend = GFX_BACKEND_RDPQ;
+static surface_t *target = NULL;
+static bool attached = false;
+static bool rgba32 = true;          /* Target surface is 32 bpp (packed colors are RGBA8888) */
+static rdp_mode_t rdp_mode = RDP_MODE_NONE;
+static rdpq_font_t *font = NULL;
+static uint32_t text_color = 0xFFFFFFFF;
+static bool text_style_dirty = true;
+static bool batching = true, next_batching = true;
+
+/* [4] CPU time bookkeeping */
+static uint32_t frame_ticks = 0;
+static float cpu_ms[GFX_BACKEND_COUNT];
+
+/* [5] Packed graphics_make_color() value -> color_t for the RDP */
+static color_t gfx_unpack(uint32_t c) {
+    return rgba32 ? color_from_packed32(c) : color_from_packed16((uint16_t)c);
+}
+
+static void rdp_fill_mode(uint32_t color) {
+    if (rdp_mode != RDP_MODE_FILL) {
+        rdpq_set_mode_fill(gfx_unpack(color));
+        rdp_mode = RDP_MODE_FILL;
+    } else {
+        rdpq_set_fill_color(gfx_unpack(color));
+    }
+}
+
+/* [6] Init: the RDP is always brought up, so the backend can be switched at any time */
+void gfx_init(gfx_backend_t b) {
+    mem_scope_t m = mem_scope_begin();
+    rdpq_init();
+    font = rdpq_font_load_builtin(FONT_BUILTIN_DEBUG_MONO);
+    rdpq_text_register_font(GFX_FONT_ID, font);
+    mem_scope_end(MEM_UI, m);
+    gfx_set_backend(b);
+    backend = next_backend;
+    if (!text_init()) next_batching = batching = false;
+}
+
+void gfx_set_backend(gfx_backend_t b) {
+    if (b >= 0 && b < GFX_BACKEND_COUNT) next_backend = b;
+}
+
+gfx_backend_t gfx_get_backend(void) { return next_backend; }
+
+void gfx_set_text_batching(bool on) { next_batching = on && text_ready(); }
+bool gfx_get_text_batching(void) { return next_batching; }
+
+gfx_text_path_t gfx_get_text_path(void) {
+    if (backend == GFX_BACKEND_SOFTWARE) return GFX_TEXT_CPU;
+    return batching ? GFX_TEXT_BATCHED : GFX_TEXT_RDPQ;
+}
+
+const char *gfx_text_path_name(gfx_text_path_t p) {
+    switch (p) {
+        case GFX_TEXT_BATCHED: return "batch";
+        case GFX_TEXT_RDPQ: return "rdpq";
+        case GFX_TEXT_CPU: return "cpu";
+        default: return "?";
+    }
+}
+
+const char *gfx_backend_name(gfx_backend_t b) {
+    switch (b) {
+        case GFX_BACKEND_RDPQ: return "RDP";
+        case GFX_BACKEND_SOFTWARE: return "CPU";
+        default: return "?";
+    }
+}
+
+/* [7] Start a frame on `disp` */
+void gfx_begin(surface_t *disp) {
+    uint32_t t0 = TICKS_READ();
+    frame_ticks = 0;
+    backend = next_backend;
+    batching = next_batching;
+    text_frame_begin();
+    target = disp;
+    rgba32 = disp && surface_get_format(disp) == FMT_RGBA32;
+    rdp_mode = RDP_MODE_NONE;
+    text_style_dirty = true;
+    if (backend == GFX_BACKEND_RDPQ && disp) {
+        rdpq_attach(disp, NULL);
+        attached = true;
+    }
+    frame_ticks += TICKS_READ() - t0;
+}
+
+/* [7.1] Draw the text queued so far (batched path) */
+void gfx_flush(void) {
+    if (!attached || !batching) return;
+    uint32_t t0 = TICKS_READ();
+    PROF_BEGIN(PROF_TEXT);
+    text_flush();
+    PROF_END(PROF_TEXT);
+    rdp_mode = RDP_MODE_NONE;
+    frame_ticks += TICKS_READ() - t0;
+}
+
+/* [8] Show the frame. With the RDP the CPU does not wait: the frame is shown when the RDP is done. */
+void gfx_end(void) {
+    gfx_flush();
+    uint32_t t0 = TICKS_READ();
+    if (attached) {
+        rdpq_detach_show();
+        attached = false;
+    } else if (target) {
+        display_show(target);
+    }
+    target = NULL;
+    frame_ticks += TICKS_READ() - t0;
+    float ms = (float)TICKS_TO_US(frame_ticks) / 1000.0f;
+    float *avg = &cpu_ms[backend];
+    *avg = (*avg <= 0.0f) ? ms : (1.0f - GFX_CPU_MS_ALPHA) * *avg + GFX_CPU_MS_ALPHA * ms;
+}
+
+/* [8.1] Offscreen surface done: no show, no CPU time sample (not a frame) */
+void gfx_finish(void) {
+    gfx_flush();
+    if (attached) {
+        rdpq_detach_wait();
+        attached = false;
+    }
+    target = NULL;
+}
+
+/* [9] Whole screen */
+void gfx_clear(uint32_t color) {
+    if (!target) return;
+    uint32_t t0 = TICKS_READ();
+    if (attached) {
+        rdp_fill_mode(color);
+        rdpq_fill_rectangle(0, 0, target->width, target->height);
+    } else {
+        graphics_fill_screen(target, color);
+    }
+    frame_ticks += TICKS_READ() - t0;
+}
+
+/* [10] Filled rectangle */
+void gfx_fill_rect(int x, int y, int w, int h, uint32_t color) {
+    if (!target || w <= 0 || h <= 0) return;
+    uint32_t t0 = TICKS_READ();
+    if (attached) {
+        rdp_fill_mode(color);
+        rdpq_fill_rectangle(x, y, x + w, y + h);
+    } else {
+        graphics_draw_box(target, x, y, w, h, color);
+    }
+    frame_ticks += TICKS_READ() - t0;
+}
+
+/* [11] Outline: four 1 pixel wide fills on both backends (a box is cheaper than a line) */
+void gfx_frame_rect(int x, int y, int w, int h, uint32_t color) {
+    if (!target || w <= 0 || h <= 0) return;
+    uint32_t t0 = TICKS_READ();
+    if (attached) {
+        rdp_fill_mode(color);
+        rdpq_fill_rectangle(x, y, x + w, y + 1);
+        rdpq_fill_rectangle(x, y + h - 1, x + w, y + h);
+        rdpq_fill_rectangle(x, y, x + 1, y + h);
+        rdpq_fill_rectangle(x + w - 1, y, x + w, y + h);
+    } else {
+        graphics_draw_box(target, x, y, w, 1, color);
+        graphics_draw_box(target, x, y + h - 1, w, 1, color);
+        graphics_draw_box(target, x, y, 1, h, color);
+        graphics_draw_box(target, x + w - 1, y, 1, h, color);
+    }
+    frame_ticks += TICKS_READ() - t0;
+}
+
+/* [12] Sprite. The RDP uses the standard mode with alpha compare, which takes any texture
+   format (copy mode cannot read 32 bit textures). */
+void gfx_sprite(int x, int y, sprite_t *spr) {
+    if (!target || !spr) return;
+    uint32_t t0 = TICKS_READ();
+    if (attached) {
+        if (rdp_mode != RDP_MODE_STANDARD) {
+            rdpq_set_mode_standard();
+            rdpq_mode_alphacompare(1);
+            rdp_mode = RDP_MODE_STANDARD;
+        }
+        rdpq_sprite_blit(spr, (float)x, (float)y, NULL);
+    } else {
+        graphics_draw_sprite(target, x, y, spr);
+    }
+    frame_ticks += TICKS_READ() - t0;
+}
+
+/* [12.1] Rectangle copy. The RDP uses copy mode for 16 bpp (4 pixels per clock) and the
+   standard mode for 32 bpp, which copy mode cannot read; the CPU copies rows. */
+void gfx_blit(const surface_t *src, int x, int y, int w, int h) {
+    if (!target || !src || !src->buffer) return;
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > src->width) w = src->width - x;
+    if (y + h > src->height) h = src->height - y;
+    if (x + w > target->width) w = target->width - x;
+    if (y + h > target->height) h = target->height - y;
+    if (w <= 0 || h <= 0) return;
+    uint32_t t0 = TICKS_READ();
+    if (attached) {
+        if (rdp_mode != RDP_MODE_BLIT) {
+            if (rgba32) rdpq_set_mode_standard(); else rdpq_set_mode_copy(false);
+            rdp_mode = RDP_MODE_BLIT;
+        }
+        rdpq_tex_blit(src, (float)x, (float)y, &(rdpq_blitparms_t){ .s0 = x, .t0 = y, .width = w, .height = h });
+    } else {
+        int bpp = rgba32 ? 4 : 2;
+        const uint8_t *s = (const uint8_t *)src->buffer + y * src->stride + x * bpp;
+        uint8_t *d = (uint8_t *)target->buffer + y * target->stride + x * bpp;
+        for (int row = 0; row < h; row++) {
+            fast_memcpy(d, s, (size_t)(w * bpp));
+            s += src->stride;
+            d += target->stride;
+        }
+    }
+    frame_ticks += TICKS_READ() - t0;
+}
+
+/* [13] Text, 8x8 glyphs, transparent background. Batched text is only queued here. */
+void gfx_set_text_color(uint32_t color) {
+    if (color != text_color) text_style_dirty = true;
+    text_color = color;
+    graphics_set_color(color, 0);
+}
+
+void gfx_text(int x, int y, const char *text) {
+    if (!target || !text) return;
+    uint32_t t0 = TICKS_READ();
+    if (attached && batching) {
+        text_queue(x, y, text, gfx_unpack(text_color));
+    } else if (attached) {
+        if (text_style_dirty) {
+            rdpq_font_style(font, 0, &(rdpq_fontstyle_t){ .color = gfx_unpack(text_color) });
+            text_style_dirty = false;
+        }
+        rdpq_text_print(NULL, GFX_FONT_ID, (float)x, (float)(y + GFX_FONT_ASCENT), text);
+        rdp_mode = RDP_MODE_NONE; /* rdpq_text sets its own mode */
+    } else {
+        graphics_draw_text(target, x, y, text);
+    }
+    frame_ticks += TICKS_READ() - t0;
+}
+
+float gfx_get_cpu_ms(gfx_backend_t b) {
+    return (b >= 0 && b < GFX_BACKEND_COUNT) ? cpu_ms[b] : 0.0f;
+}
@@ -0,0 +1,64 @@
+/* [1] gfx.h - Small drawing layer used by the HUD, menu, VU meters and debug overlay.
+   Two backends: the RDP (rdpq) draws fills, frames, the logo and text while the CPU goes on,
+   and the original CPU (graphics_*) path stays as a fallback. Colors are the packed values
+   returned by graphics_make_color(), so callers do not change. */
+#pragma once
+#include <libdragon.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* [2] Backends */
+typedef enum {
+    GFX_BACKEND_RDPQ = 0,     /* RDP draws, the CPU only queues commands */
+    GFX_BACKEND_SOFTWARE,     /* CPU writes every pixel (graphics_*) */
+    GFX_BACKEND_COUNT
+} gfx_backend_t;
+
+/* [2.1] How text reaches the screen */
+typedef enum {
+    GFX_TEXT_BATCHED = 0,     /* RDP: glyph atlas, all strings of a layer in one pass (text.c) */
+    GFX_TEXT_RDPQ,            /* RDP: rdpq_text_print() per string */
+    GFX_TEXT_CPU,             /* CPU: graphics_draw_text() glyph by glyph */
+    GFX_TEXT_PATH_COUNT
+} gfx_text_path_t;
+
+#define GFX_CPU_MS_ALPHA 0.05f /* [3] Smoothing factor for the per-backend CPU time */
+
+/* [4] Call once after display_init() */
+void gfx_init(gfx_backend_t backend);
+
+/* [5] Backend selection. A change takes effect at the next gfx_begin(). */
+void gfx_set_backend(gfx_backend_t backend);
+gfx_backend_t gfx_get_backend(void);
+const char *gfx_backend_name(gfx_backend_t backend);
+
+/* [5.1] Batched atlas text on the RDP backend (on by default; off = rdpq_text per string).
+   Takes effect at the next gfx_begin(), like the backend. */
+void gfx_set_text_batching(bool on);
+bool gfx_get_text_batching(void);
+gfx_text_path_t gfx_get_text_path(void); /* Path used by the current frame */
+const char *gfx_text_path_name(gfx_text_path_t path);
+
+/* [6] Frame: gfx_begin() after display_get(), gfx_end() shows the frame (instead of display_show).
+   Batched text is drawn over the shapes of its layer; gfx_flush() closes a layer, so a box drawn
+   after it covers the text before it (HUD message box, menu). gfx_end() flushes too. */
+void gfx_begin(surface_t *disp);
+void gfx_flush(void);
+void gfx_end(void);
+/* [6.1] Finish drawing into an offscreen surface started with gfx_begin(): nothing is shown,
+   the RDP is waited for so the surface can be read back at once */
+void gfx_finish(void);
+
+/* [7] Drawing. The frame is a 1 pixel outline of the rectangle. */
+void gfx_clear(uint32_t color);
+void gfx_fill_rect(int x, int y, int w, int h, uint32_t color);
+void gfx_frame_rect(int x, int y, int w, int h, uint32_t color);
+void gfx_sprite(int x, int y, sprite_t *spr);
+/* [7.1] Copy a rectangle of `src` (same size and format as the target) to the same place */
+void gfx_blit(const surface_t *src, int x, int y, int w, int h);
+void gfx_set_text_color(uint32_t color);
+void gfx_text(int x, int y, const char *text);
+
+/* [8] Smoothed CPU time per frame spent in the drawing calls of a backend (last value it had
+   while it was active, 0 if never used) */
+float gfx_get_cpu_ms(gfx_backend_t backend);
@@ -0,0 +1,119 @@
+/* [1] governor.c - Adaptive UI rate (see governor.h) */
+#include "governor.h"
+#include <libdragon.h>
+#include "audio_engine.h" /* [2] Ring fill, mix cost, underruns */
+#include "utils.h"        /* [3] Formatting */
+#include "evlog.h"        /* [3.1] Level changes */
+
+static const uint8_t level_hz[GOV_LEVEL_COUNT] = { 60, 30, 20, 15, 15 };
+
+static gov_level_t level = GOV_LEVEL_60;
+static bool held = false;
+static uint32_t window_start = 0;      /* Ticks */
+static uint32_t last_frame = 0;        /* Ticks of the last drawn frame */
+static bool drawn_once = false;
+static float draw_ms_sum = 0.0f;
+static uint32_t draw_count = 0;
+static uint32_t quiet_windows = 0;
+static uint64_t mix_ticks0 = 0;
+static uint32_t mix_bufs0 = 0;
+static uint32_t underruns0 = 0;
+static uint32_t last_headroom = 100;   /* For the overlay */
+static float last_draw_ms = 0.0f;
+
+/* [4] Audio headroom of the window: the lower of the ring fill and the time left in an audio
+   buffer after mixing it (average of the window) */
+static uint32_t audio_headroom(void) {
+    uint64_t t;
+    uint32_t b;
+    audio_engine_get_mix_cost(&t, &b, NULL);
+    uint32_t headroom = audio_engine_take_min_fill(AUDIO_FILL_GOVERNOR);
+    uint32_t buf_us = audio_engine_get_buffer_us();
+    if (b > mix_bufs0 && buf_us) {
+        uint32_t mix_us = (uint32_t)TICKS_TO_US((uint32_t)((t - mix_ticks0) / (b - mix_bufs0)));
+        uint32_t left = (mix_us >= buf_us) ? 0 : 100 - mix_us * 100 / buf_us;
+        if (left < headroom) headroom = left;
+    }
+    mix_ticks0 = t;
+    mix_bufs0 = b;
+    return headroom;
+}
+
+/* [5] End of a window: one step down under pressure, one step up after a quiet stretch */
+static void evaluate(void) {
+    uint32_t headroom = audio_headroom();
+    uint32_t underruns = audio_engine_get_underruns();
+    bool new_underruns = underruns != underruns0;
+    underruns0 = underruns;
+    float draw_ms = draw_count ? draw_ms_sum / (float)draw_count : 0.0f;
+    draw_ms_sum = 0.0f;
+    draw_count = 0;
+    last_headroom = headroom;
+    last_draw_ms = draw_ms;
+    if (held) { level = GOV_LEVEL_60; quiet_windows = 0; return; }
+    gov_level_t before = level;
+
+    if (new_underruns || headroom < GOV_AUDIO_LOW_PCT || draw_ms > GOV_FRAME_HIGH_MS) {
+        if (level + 1 < GOV_LEVEL_COUNT) level = (gov_level_t)(level + 1);
+        quiet_windows = 0;
+    } else if (headroom >= GOV_AUDIO_OK_PCT && draw_ms < GOV_FRAME_OK_MS) {
+        if (++quiet_windows >= GOV_RECOVER_WINDOWS && level > GOV_LEVEL_60) {
+            level = (gov_level_t)(level - 1);
+            quiet_windows = 0;
+        }
+    } else {
+        quiet_windows = 0;
+    }
+    if (level != before) EVLOG(GOV_LEVEL, (uint32_t)before, (uint32_t)level);
+}
+
+void governor_update(float pass_ms, bool drew) {
+    uint32_t now = TICKS_READ();
+    if (window_start == 0) {
+        window_start = now;
+        underruns0 = audio_engine_get_underruns();
+        audio_engine_get_mix_cost(&mix_ticks0, &mix_bufs0, NULL);
+    }
+    if (drew) {
+        draw_ms_sum += pass_ms;
+        draw_count++;
+    }
+    if (TICKS_DISTANCE(window_start, now) >= (int32_t)TICKS_FROM_MS(GOV_WINDOW_MS)) {
+        evaluate();
+        window_start = now;
+    }
+}
+
+/* [6] Rate limit: a frame period minus a quarter, so a frame that comes a little early at
+   60 Hz pacing is not pushed to the next one */
+bool governor_frame_due(void) {
+    if (held || level == GOV_LEVEL_60 || !drawn_once) return true;
+    uint32_t period_us = 1000000u / level_hz[level];
+    return TICKS_DISTANCE(last_frame, TICKS_READ()) >= (int32_t)TICKS_FROM_US(period_us - period_us / 4);
+}
+
+void governor_frame_drawn(void) {
+    last_frame = TICKS_READ();
+    drawn_once = true;
+}
+
+bool governor_show_debug(void) { return level < GOV_LEVEL_MINIMAL; }
+bool governor_show_vu(void) { return level < GOV_LEVEL_MINIMAL; }
+
+void governor_hold(bool hold) {
+    held = hold;
+    if (hold) level = GOV_LEVEL_60;
+}
+
+gov_level_t governor_level(void) { return level; }
+
+void governor_describe(char *out, int size) {
+    int pos = safe_append_str(out, size, 0, "Gov: ");
+    pos += int_to_dec(&out[pos], level_hz[level]);
+    pos = safe_append_str(out, size, pos, level == GOV_LEVEL_MINIMAL ? " Hz min" : " Hz");
+    pos = safe_append_str(out, size, pos, " audio ");
+    pos += int_to_dec(&out[pos], (int)last_headroom);
+    pos = safe_append_str(out, size, pos, "% draw ");
+    pos += format_float_two_decimals(&out[pos], last_draw_ms);
+    safe_append_str(out, size, pos, " ms");
+}
@@ -0,0 +1,43 @@
+/* [1] governor.h - Adaptive UI rate. Every half second it looks at the audio headroom (output
+   ring fill and the share of each audio buffer spent mixing) and at the CPU time of the drawn
+   frames. Under pressure it steps the UI down (60 -> 30 -> 20 -> 15 Hz, then no debug overlay
+   and no VU meters); when the load has stayed low for a while it steps back up, one level at
+   a time. The audio always has priority over the screen. */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GOV_WINDOW_MS 500          /* [2] Evaluation period */
+#define GOV_RECOVER_WINDOWS 4      /* Quiet windows in a row before a step back up */
+#define GOV_AUDIO_LOW_PCT 25       /* Audio headroom below this: step down */
+#define GOV_AUDIO_OK_PCT 50        /* ... above this: may step up */
+#define GOV_FRAME_HIGH_MS 14.0f    /* Average drawn frame CPU time above this: step down */
+#define GOV_FRAME_OK_MS 8.0f       /* ... below this: may step up */
+
+/* [3] Levels */
+typedef enum {
+    GOV_LEVEL_60 = 0,     /* Every frame */
+    GOV_LEVEL_30,
+    GOV_LEVEL_20,
+    GOV_LEVEL_15,
+    GOV_LEVEL_MINIMAL,    /* 15 Hz, debug overlay and VU meters off */
+    GOV_LEVEL_COUNT
+} gov_level_t;
+
+/* [4] One main loop pass: its CPU time and whether it drew a frame */
+void governor_update(float pass_ms, bool drew);
+
+/* [5] May the UI draw a frame now (the rate of the current level)? */
+bool governor_frame_due(void);
+void governor_frame_drawn(void);
+
+/* [6] Expensive widgets */
+bool governor_show_debug(void);
+bool governor_show_vu(void);
+
+/* [7] Hold at full rate (benchmark) */
+void governor_hold(bool hold);
+
+gov_level_t governor_level(void);
+/* [8] One line for the overlay, e.g. "Gov: 30 Hz audio 62% draw 9.10 ms" */
+void governor_describe(char *out, int size);
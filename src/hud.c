@@ -1,6 +1,8 @@
 /* [1] hud.c - HUD and message display for mca64Player. All comments in English, suitable for C beginners. */
 #include "hud.h"
 #include "utils.h"   /* [2] tiny_strlen, int_to_dec, append_uint_zero_pad */
+#include "ui.h"      /* [2.1] Retained screen: the message box is a widget */
+#include "palette.h" /* [2.2] Text color for the current depth */
 #include <stdint.h>
 #include <libdragon.h>
 
@@ -26,12 +28,27 @@ void show_message(const char *text) {
     hud_message_timer = HUD_MESSAGE_TIMER_DEFAULT;
 }
 
-/* [8] Draw the message box on the screen and decrease the timer. Call once per frame. */
-void hud_draw_message(display_context_t disp, uint32_t frame_color, uint32_t bg_color) {
-    if (!disp) return;
-    if (hud_message_timer <= 0) return;
-    if (hud_message[0] == '\0') {
+/* [7.1] Show a seek message with the time the seek took, e.g. "Forward +5s (3 ms)". */
+void show_seek_message(const char *label, uint32_t seek_us) {
+    char buf[HUD_MESSAGE_BUF];
+    strcpy_s(buf, sizeof(buf), label);
+    int pos = safe_append_str(buf, sizeof(buf), -1, " (");
+    if (seek_us < 1000) {
+        pos += int_to_dec(&buf[pos], (int)seek_us);
+        safe_append_str(buf, sizeof(buf), pos, " us)");
+    } else {
+        pos += int_to_dec(&buf[pos], (int)(seek_us / 1000));
+        safe_append_str(buf, sizeof(buf), pos, " ms)");
+    }
+    show_message(buf);
+}
+
+/* [8] Update the message box widget and decrease the timer. Call once per frame.
+   The box stays on screen without being redrawn until the text changes or the timer ends. */
+void hud_draw_message(uint32_t frame_color, uint32_t bg_color) {
+    if (hud_message_timer <= 0 || hud_message[0] == '\0') {
         hud_message_timer = 0;
+        ui_hide(UI_ID_HUD);
         return;
     }
     int cur_w = (int)display_get_width();
@@ -40,17 +57,8 @@ void hud_draw_message(display_context_t disp, uint32_t frame_color, uint32_t bg_
     const int h = 40;
     const int x = (cur_w - w) / 2;
     const int y = (cur_h - h) / 2;
-    graphics_draw_box(disp, x, y, w, h, bg_color);
-    graphics_draw_line(disp, x - 2, y - 2, x + w + 1, y - 2, frame_color);
-    graphics_draw_line(disp, x - 2, y + h + 1, x + w + 1, y + h + 1, frame_color);
-    graphics_draw_line(disp, x - 2, y - 2, x - 2, y + h + 1, frame_color);
-    graphics_draw_line(disp, x + w + 1, y - 2, x + w + 1, y + h + 1, frame_color);
-    uint32_t text_color = graphics_make_color(0, 0, 0, 255);
-    graphics_set_color(text_color, 0);
-    int txt_w = tiny_strlen(hud_message) * 8;
-    int txt_x = x + (w - txt_w) / 2;
-    int txt_y = y + (h / 2) - 6;
-    graphics_draw_text(disp, txt_x, txt_y, hud_message);
+    uint32_t text_color = color_get(COL_BLACK);
+    ui_box_text(UI_ID_HUD, x - 2, y - 2, w + 4, h + 4, frame_color, bg_color, text_color, hud_message);
     hud_message_timer--;
 }
 
@@ -5,9 +5,10 @@
 
 /* [1] Show a message (copies to internal buffer and sets timer) */
 void show_message(const char *text);
+void show_seek_message(const char *label, uint32_t seek_us);
 
-/* [2] Draw the message box and decrease timer - call once per frame */
-void hud_draw_message(display_context_t disp, uint32_t frame_color, uint32_t bg_color);
+/* [2] Update the message box widget and decrease timer - call once per frame */
+void hud_draw_message(uint32_t frame_color, uint32_t bg_color);
 
 /* [3] Helper formatters / last button updater / analog formatters */
 void update_last_button_pressed(char *buf, size_t size, joypad_inputs_t inputs);
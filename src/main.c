@@ -4,55 +4,118 @@
 #include <stdbool.h>    /* [4] Boolean type support */
 #include <stdlib.h>     /* [5] abs, malloc/free if needed */
 #include <math.h>       /* [6] powf, fabsf for math operations */
-#include <malloc.h>     /* [7] mallinfo() for memory usage */
 #include <system.h>     /* [8] System-specific functions (libdragon) */
 #include <libdragon.h>  /* [9] N64 SDK library */
 #include "menu.h"      /* [10] Menu system header */
 #include "utils.h"     /* [11] Utility functions header */
 #include "debug.h"     /* [12] Debug info rendering header */
-#include "arena.h"     /* [13] Simple memory arena header */
-#include "cpu_usage.h" /* [14] CPU usage averaging header */
+#include "arena.h"     /* [13] Named memory arenas (persistent, frame, per track) */
+#include "stats.h"     /* [14] Windowed frame/CPU/audio statistics */
+#include "clock.h"     /* [14.1] 64-bit tick clock of the loop */
+#include "evlog.h"     /* [14.2] Deferred binary event log */
+#include "mem.h"       /* [14.3] Memory per category, allocations per frame */
 #include "vu.h"        /* [15] VU meter logic header */
 #include "hud.h"       /* [16] HUD/message display header */
+#include "audio_engine.h" /* [16.1] Callback-driven audio pump */
+#include "stream.h"    /* [16.2] Seekable WAV64 stream with seek index */
+#include "playlist.h"  /* [16.3] Playlist of every .wav64 in rom:/ */
+#include "transition.h" /* [16.4] Crossfade/gapless transitions on two channels */
+#include "track_cache.h" /* [16.5] LRU cache of track data in RAM */
+#include "gfx.h"       /* [16.6] Drawing layer: RDP backend with the CPU fallback */
+#include "ui.h"        /* [16.7] Retained screen: widgets redrawn only when they change */
+#include "video.h"     /* [16.8] Display mode with a selectable color depth */
+#include "palette.h"   /* [16.9] UI colors for 16 and 32 bpp */
+#include "bench.h"     /* [16.10] Benchmark of every menu resolution */
+#include "governor.h"  /* [16.11] UI rate stepped down when audio headroom or frame time runs short */
+#include "prof.h"      /* [16.12] Frame profiler zones and bar */
 #include <debug.h>
 /* [17] Application-wide constants */
 #define SCREEN_W 640     /* Default screen width */
 #define SCREEN_H 288     /* Default screen height */
 #define ANALOG_DEADZONE 8 /* Deadzone for analog stick */
-#define FRAME_MS_ALPHA 0.02f /* Smoothing factor for frame time */
 #define VU_HALF_LIFE_MS 800.0f /* VU meter smoothing half-life */
-#define FRAME_MS_DISPLAY_THRESHOLD 0.15f /* Frame time smoothing threshold */
 #define VU_MIN_DELTA 2.0f /* Minimum VU meter update delta */
+#define PRELOAD_MIN_RAM (8 * 1024 * 1024)       /* Preload tracks only with the Expansion Pak */
+#define PRELOAD_BUDGET_BYTES (4 * 1024 * 1024)  /* RAM for the current track (longer tracks: this prefix) */
+#define TRACK_CACHE_BUDGET_BYTES (5 * 1024 * 1024) /* RAM for recently played tracks, current one included */
+#define STATS_WINDOW 120 /* Frames the debug overlay statistics cover (2 s at 60 fps) */
+#define MEM_STEADY_FRAMES 120 /* Quiet frames (no track change, menu, mode switch) before the loop must not allocate */
+
+/* [17.1] Main screen widget ids (VU meters take two ids: meter and label) */
+enum {
+    W_BUTTON = UI_ID_MAIN, W_ANALOG, W_FILE, W_TIME, W_PROGRESS, W_TRACK, W_SOURCE,
+    W_VU_L, W_VU_L_LABEL, W_VU_R, W_VU_R_LABEL
+};
 
 /* [18] Global state variables */
-static uint32_t last_frame_ticks = 0;   /* Last frame tick count */
-static uint32_t fps = 0;                /* Raw FPS value */
-static float volume = 1.0f;             /* Current audio volume (0.0 - 1.0) */
-static float last_frame_start_ms = 0.0f;/* Last frame start time (ms) */
-static float last_cpu_ms_display = 0.0f;/* Smoothed frame time (ms) */
-static float smoothed_frame_ms = 0.0f;  /* Exponential moving average of frame time */
-static float smoothed_fps = 0.0f;       /* Exponential moving average of FPS */
+static float volume = TRANSITION_DEFAULT_VOLUME; /* Current audio volume (0.0 - 1.0) */
+static loop_metrics_t metrics;          /* Frame, CPU and audio statistics of the last STATS_WINDOW frames */
+static uint64_t last_mix_ticks = 0;     /* Mixer totals at the last frame (per-frame deltas) */
+static uint32_t last_mix_buffers = 0;
+static uint32_t last_underruns = 0;     /* Audio underruns already logged */
+static uint32_t quiet_frames = 0;       /* Frames since the last track change, menu or mode switch */
 static const resolution_t *current_resolution = NULL; /* Current selected resolution */
+static sprite_t *screen_logo = NULL;    /* Static screen content (drawn once into the UI background) */
+
+/* [18.1] Static part of the main screen: background color, logo and the centered title */
+static void draw_static_screen(void) {
+    const char *title = "mca64Player";
+    gfx_clear(color_get(COL_BG));
+    gfx_sprite(100, 100, screen_logo);
+    gfx_set_text_color(color_get(COL_WHITE));
+    gfx_text(((int)display_get_width() - tiny_strlen(title) * 8) / 2, 4, title);
+}
+
+/* [18.2] Switch the display mode (menu selection or benchmark step). Returns the depth used. */
+static int set_resolution(const resolution_t *res, video_depth_t depth) {
+    current_resolution = res;
+    quiet_frames = 0; /* The switch allocates (framebuffers) */
+    int bpp = video_switch(res, depth); /* Timed, audio fed between the steps */
+    ui_reset(); /* New buffers and size: redraw the background (same pool memory) */
+    video_measure_fill(color_get_rgba(COL_BG));
+    return bpp;
+}
 
 /* [19] Main program entry point */
 int main(void) {
 
     debug_init(DEBUG_FEATURE_ALL); // logi w Ares
+    evlog_init(); /* [19.1] Event log: sd:/ when the card is mounted, ISViewer lines otherwise */
+    EVLOG(BOOT, (uint32_t)get_memory_size() / 1024u, (uint32_t)get_tv_type());
     int x = 640;
     debugf("Warto zmiennej x = %d\n", x);
 
     /* [20] --- Initialization section --- */
     const int SOUND_CH = 0; /* Audio channel index */
     static const resolution_t PAL = {SCREEN_W, SCREEN_H, false}; /* Default PAL resolution */
-    display_init(PAL, DEPTH_32_BPP, 2, GAMMA_NONE, ANTIALIAS_OFF); /* Initialize display */
+    video_init(&PAL, VIDEO_DEPTH_AUTO); /* Initialize display (16 bpp when 32 bpp would take too much RAM) */
+    /* [20.0] Surface pool for the largest menu mode at the depth Auto gives it, before other
+       large allocations; every mode switch reuses it */
+    {
+        uint32_t pool = 0;
+        for (int i = 0; i < menu_get_resolution_count(); i++) {
+            const resolution_t *r = menu_get_resolution(i)->res;
+            uint32_t bytes = (uint32_t)r->width * r->height * (uint32_t)(video_pick_bpp(r, VIDEO_DEPTH_AUTO) / 8);
+            if (bytes > pool) pool = bytes;
+        }
+        if (!video_pool_init(pool)) EVLOG(POOL_FAIL, pool);
+    }
     joypad_init(); /* Initialize joypad input */
+    gfx_init(GFX_BACKEND_RDPQ); /* [20.1] UI is drawn by the RDP; Z + B switches to the CPU path */
+    video_measure_fill(color_get_rgba(COL_BG)); /* [20.2] Fill time of this depth for the debug overlay */
     current_resolution = &PAL; /* Set current resolution pointer */
+    /* [20.3] Statistics windows; bucket widths set the percentile step (0.5 ms, 1.6 %, 0.1 ms, 2 %) */
+    stats_init(&metrics.frame_us, STATS_WINDOW, 500);
+    stats_init(&metrics.interval_us, STATS_WINDOW, 500);
+    stats_init(&metrics.cpu_pct10, STATS_WINDOW, 16);
+    stats_init(&metrics.mix_us, STATS_WINDOW, 100);
+    stats_init(&metrics.fill_pct, STATS_WINDOW, 2);
 
     /* [21] Initialize file system (DFS) and handle error if it fails */
     if (dfs_init(DFS_DEFAULT_LOCATION) != DFS_ESUCCESS) {
         surface_t *disp = display_get();
-        uint32_t black = graphics_make_color(0, 0, 0, 255);
-        uint32_t red = graphics_make_color(255, 0, 0, 255);
+        uint32_t black = color_get(COL_BLACK);
+        uint32_t red = color_get(COL_ERROR);
         graphics_fill_screen(disp, black);
         graphics_set_color(red, 0);
         graphics_draw_text(disp, 10, 10, "Error: cannot initialize DFS");
@@ -60,99 +123,108 @@ int main(void) {
         return 1; /* Exit with error */
     }
 
-    /* [22] Read WAV64 file header and extract compression info */
-    // compression_level is read from the WAV64 file header (header_buf[5])
-    uint8_t compression_level = 0;
-    char header_hex_string[64]; header_hex_string[0] = '\0';
-    int dfs_bytes_read = -1;
-    char header_buf[16];
-    int file_size = 0;
-    FILE *f = asset_fopen("rom:/sound.wav64", &file_size);
-    if (f) {
-        dfs_bytes_read = (int)fread(header_buf, 1, (size_t)sizeof(header_buf), f);
-        if (dfs_bytes_read >= 6) compression_level = (uint8_t)header_buf[5];
-        int ptr = 0;
-        for (int i = 0; i < dfs_bytes_read && (ptr + 3) < (int)sizeof(header_hex_string); i++) {
-            u8_to_hex_sp(&header_hex_string[ptr], (uint8_t)header_buf[i]);
-            ptr += 3;
-        }
-        if (ptr < (int)sizeof(header_hex_string)) header_hex_string[ptr] = '\0';
-        fclose(f);
-    } else {
-        strcpy_s(header_hex_string, (int)sizeof(header_hex_string), "Read error");
-    }
-
-    /* [23] Initialize timer and frame tick counter */
+    /* [22] Initialize timer (the playlist times its loading) and the loop clock */
     timer_init();
-    last_frame_ticks = timer_ticks();
+    clock_init();
+
+    /* [22.1] Expansion Pak: play the current track from RAM (a prefix when it is longer than the budget)
+       and keep recently played tracks there, least recently used evicted first */
+    if (get_memory_size() >= PRELOAD_MIN_RAM) {
+        track_cache_init(TRACK_CACHE_BUDGET_BYTES);
+        playlist_set_preload(PRELOAD_BUDGET_BYTES, true);
+    }
 
-    /* [24] Set up audio compression type */
-    if (compression_level != 0 && compression_level != 1 && compression_level != 3) compression_level = 0;
-    wav64_init_compression(compression_level);
+    /* [23] Load the track list (one read of rom:/tracks.cat, or a rom:/ scan) and open the first track */
+    if (playlist_init() == 0) {
+        surface_t *disp = display_get();
+        graphics_fill_screen(disp, color_get(COL_BLACK));
+        graphics_set_color(color_get(COL_ERROR), 0);
+        graphics_draw_text(disp, 10, 10, "Error: no .wav64 files in rom:/");
+        display_show(disp);
+        return 1;
+    }
+    playlist_track_t *track = playlist_current();
+    uint8_t compression_level = 0;       /* Refreshed from track->format on every track change */
+    char header_hex_string[64]; header_hex_string[0] = '\0';
+    const char *filename = "";
+    EVLOG(PLAYLIST, (uint32_t)playlist_count(), playlist_load_us(), playlist_from_catalog() ? 1u : 0u);
 
-    /* [25] Open WAV64 file and initialize audio/mixer */
-    const char *filename = "rom:/sound.wav64";
-    wav64_t sound;
-    fast_memset(&sound, 0, sizeof(sound));
-    wav64_open(&sound, filename);
-    audio_init((int)sound.wave.frequency, 4);
-    mixer_init(32);
-    wav64_set_loop(&sound, true);
+    /* [25] Initialize audio/mixer at the first track's rate */
+    audio_engine_init((int)track->wav.wave.frequency, 4, 32); /* audio_init + mixer_init */
+    transition_init(SOUND_CH); /* [25.1] Tracks alternate between SOUND_CH and SOUND_CH + 1 */
+    stream_set_loop(&track->stream, true);
 
     /* [26] Playback state variables */
-    uint32_t current_sample_pos = 0;
+    uint64_t current_sample_pos = 0; /* 64-bit: exact for tracks of any length */
     bool is_playing = false;
-    int sound_channel = SOUND_CH;
+    int sound_channel = transition_channel(); /* Channel of the current track */
     current_sample_pos = 0;
-    wav64_play(&sound, sound_channel);
-    mixer_ch_set_pos(sound_channel, (float)current_sample_pos);
+    stream_play(&track->stream, sound_channel);
+    transition_set_volume(volume);
     is_playing = true;
-    mixer_ch_set_vol(sound_channel, volume, volume);
-
-    /* [27] Audio file parameters (cache for display) */
-    uint32_t sample_rate = (uint32_t)(sound.wave.frequency + 0.5f);
-    uint8_t channels = sound.wave.channels;
-    uint32_t total_samples = (uint32_t)sound.wave.len;
-    uint32_t total_seconds = (sample_rate && total_samples) ? (uint32_t)(total_samples / sample_rate) : 0;
-    uint32_t total_minutes = total_seconds / 60;
-    uint32_t total_secs_rem = total_seconds % 60;
-
-    /* [28] Allocate temporary buffers from arena for UI and state */
-    char *last_button_pressed = (char *)arena_alloc(32);
+
+    /* [27] Audio file parameters (cache for display), refreshed whenever the track changes */
+    uint32_t sample_rate = 0;
+    uint8_t channels = 0;
+    uint64_t total_samples = 0;
+    uint32_t total_seconds = 0, total_minutes = 0, total_secs_rem = 0;
+    bool track_changed = true;
+
+    /* [28] Buffers for UI and state, for the whole run */
+    char *last_button_pressed = (char *)arena_alloc(ARENA_PERSISTENT, 32);
     if (last_button_pressed) strcpy_s(last_button_pressed, 32, "None");
-    char *analog_pos = (char *)arena_alloc(32);
+    char *analog_pos = (char *)arena_alloc(ARENA_PERSISTENT, 32);
     if (analog_pos) strcpy_s(analog_pos, 32, "X=0 Y=0");
-    uint32_t bg_color = graphics_make_color(0, 0, 64, 255);
-    uint32_t white = graphics_make_color(255, 255, 255, 255);
-    uint32_t green = graphics_make_color(0, 255, 0, 255);
-    uint32_t box_frame_color = graphics_make_color(0, 200, 0, 255);
-    uint32_t box_bg_color = graphics_make_color(0, 200, 0, 255);
+    /* [25.1] Colors for the current depth (read again every frame, the depth changes with the mode) */
+    uint32_t white = 0, green = 0, box_frame_color = 0, box_bg_color = 0;
     bool loop_enabled = true;
-    char *linebuf = (char *)arena_alloc(256);
-    char *tmpbuf = (char *)arena_alloc(64);
+    bool ab_combo_used = false;   /* Z was used as a modifier, do not toggle loop on release */
+    bool ab_has_a = false;        /* A point set, waiting for B */
+    uint64_t ab_point_a = 0;      /* A point in samples */
+    char *linebuf = (char *)arena_alloc(ARENA_PERSISTENT, 256);
+    char *tmpbuf = (char *)arena_alloc(ARENA_PERSISTENT, 64);
     /* [28.1] Load logo sprite (must be converted to .sprite and placed in romfs/logo.sprite) */
+    mem_scope_t logo_mem = mem_scope_begin();
     sprite_t* logo = sprite_load("rom:/logo.sprite");
+    mem_scope_end(MEM_ASSETS, logo_mem);
     if (logo) {
         menu_set_logo_sprite(logo);
+        EVLOG(SPRITE, logo->width, logo->height, logo->hslices, logo->vslices);
+        EVLOG(SPRITE_FMT, (uint32_t)sprite_get_format(logo), sprite_fits_tmem(logo) ? 1u : 0u);
     }
+    screen_logo = logo;
+    ui_set_static(draw_static_screen); /* [28.2] Logo and title go into the UI background */
     /* [29] Variables for VU meter (audio peak levels) */
     int max_amp = 0, max_amp_l = 0, max_amp_r = 0;
     double ram_total = get_memory_size() / (1024.0 * 1024.0);
     /* [30] --- Main application loop --- */
     while (1) {
-        struct mallinfo mi = mallinfo();
-        double used_malloc = (double)mi.uordblks;
-        double used_arena = (double)arena_get_used();
-        double used_total_mb = (used_malloc + used_arena) / (1024.0 * 1024.0);
-        double ram_free = ram_total - used_total_mb;
-        if (ram_free < 0.0) ram_free = 0.0;
-
-        /* [31] Start of frame: measure time */
-        float frame_start_ms = get_ticks_ms();
-        float frame_interval_ms = (last_frame_start_ms > 0.0f) ? (frame_start_ms - last_frame_start_ms) : (1000.0f / 60.0f);
+        /* [30.0] Packed colors for the current framebuffer depth */
+        white = color_get(COL_WHITE);
+        green = color_get(COL_GREEN);
+        box_frame_color = color_get(COL_FRAME);
+        box_bg_color = color_get(COL_BOX_BG);
+        /* [30.1] New track: refresh the cached file parameters */
+        if (track_changed) {
+            EVLOG(TRACK, (uint32_t)playlist_index() + 1u, (uint32_t)playlist_count());
+            filename = playlist_path(track->index);
+            compression_level = track->format;
+            bytes_to_hex_sp(header_hex_string, (int)sizeof(header_hex_string), track->header, track->header_len);
+            sample_rate = (uint32_t)(track->wav.wave.frequency + 0.5f);
+            channels = track->wav.wave.channels;
+            total_samples = (uint64_t)track->stream.len;
+            total_seconds = (sample_rate && total_samples) ? (uint32_t)(total_samples / sample_rate) : 0;
+            total_minutes = total_seconds / 60;
+            total_secs_rem = total_seconds % 60;
+            track_changed = false;
+        }
+        /* [31] Start of pass: timestamp for the frame time and intervals */
+        clock_pass_begin();
+        arena_frame_begin(); /* [31.1] Formatting scratch of the last pass is given back */
         max_amp = max_amp_l = max_amp_r = 0;
 
         /* [32] Poll joypad and update last button/analog state */
+        PROF_BEGIN(PROF_INPUT);
         joypad_poll();
         joypad_inputs_t inputs = joypad_get_inputs(JOYPAD_PORT_1);
         update_last_button_pressed(last_button_pressed, 32, inputs);
@@ -162,126 +234,154 @@ int main(void) {
         if (abs(ay) <= ANALOG_DEADZONE) ay = 0;
         format_analog(analog_pos, ax, ay);
 
-        /* [33] Get pressed and held buttons */
+        /* [33] Get pressed, held and released buttons */
         joypad_buttons_t pressed = joypad_get_buttons_pressed(JOYPAD_PORT_1);
         joypad_buttons_t held = joypad_get_buttons_held(JOYPAD_PORT_1);
-
-        /* [34] Audio mixing and peak analysis */
-        while (audio_can_write()) {
-            short *outbuf = audio_write_begin();
-            int buf_len = audio_get_buffer_length();
-            mixer_poll(outbuf, buf_len);
-            if (channels == 2) {
-                for (int i = 0; i + 1 < buf_len; i += 2) {
-                    int l = abs((int)outbuf[i]);
-                    if (l > max_amp_l) max_amp_l = l;
-                    int r = abs((int)outbuf[i + 1]);
-                    if (r > max_amp_r) max_amp_r = r;
-                }
-            } else {
-                for (int i = 0; i < buf_len; i++) {
-                    int v = abs((int)outbuf[i]);
-                    if (v > max_amp) max_amp = v;
-                }
-            }
-            audio_write_end();
+        joypad_buttons_t released = joypad_get_buttons_released(JOYPAD_PORT_1);
+        PROF_END(PROF_INPUT);
+
+        /* [34] Mix every free audio buffer (audio_engine.c), then collect the peaks produced
+           since the previous frame. */
+        PROF_BEGIN(PROF_AUDIO);
+        audio_engine_pump();
+        audio_engine_read_peaks(&max_amp_l, &max_amp_r);
+        max_amp = (max_amp_l > max_amp_r) ? max_amp_l : max_amp_r;
+        PROF_END(PROF_AUDIO);
+        PROF_BEGIN(PROF_STREAM);
+        stream_index_step(&track->stream); /* [34.1] Extend the seek index a little every frame */
+        stream_loop_step(&track->stream);  /* [34.1.1] Stage the next A-B loop wrap ahead of the mix */
+        playlist_prefetch_step();          /* [34.2] Keep the next track opened and primed */
+        playlist_preload_step();           /* [34.3] Copy the current track into RAM (Expansion Pak) */
+        audio_engine_pump();               /* [34.4] Top the ring up again after the file work above */
+
+        /* [35] Track transitions. Loops (whole track or A-B) wrap inside the stream itself, so with
+           looping off the transition engine moves on to the next track (cut, crossfade or gapless
+           splice, started ahead of the end as needed) and stops the old one after the overlap. */
+        if (transition_update()) {
+            transition_stats_t ts;
+            transition_get_stats(&ts);
+            track = playlist_current();
+            sound_channel = transition_channel();
+            stream_set_loop(&track->stream, loop_enabled);
+            current_sample_pos = 0;
+            ab_has_a = false;
+            track_changed = true;
+            show_seek_message(transition_mode_name(transition_get_mode()), ts.last_start_us);
         }
-
-        /* [35] Auto-restart or end of playback */
-        if (!mixer_ch_playing(sound_channel)) {
-            if (loop_enabled) {
-                wav64_play(&sound, sound_channel);
-                mixer_ch_set_pos(sound_channel, 0.0f);
-                mixer_ch_set_vol(sound_channel, volume, volume);
-                is_playing = true;
-                current_sample_pos = 0;
-                show_message("Restart (loop)");
-            } else {
-                if (is_playing) {
-                    is_playing = false;
-                    current_sample_pos = total_samples;
-                    show_message("End");
-                }
-            }
+        /* [35.1] Last track ran out: stop */
+        if (is_playing && track->stream.ended && !transition_active() && playlist_index() + 1 >= playlist_count()) {
+            stream_stop(&track->stream, sound_channel);
+            is_playing = false;
+            current_sample_pos = total_samples;
+            show_message("End");
         }
+        PROF_END(PROF_STREAM);
 
-        /* [36] Calculate current playback position for display */
-        uint32_t current_sample_pos_display = current_sample_pos;
-        if (is_playing && mixer_ch_playing(sound_channel)) {
-            float pos_f = mixer_ch_get_pos(sound_channel);
-            if (pos_f < 0.0f) pos_f = 0.0f;
-            uint64_t pos_u = (uint64_t)(pos_f + 0.5f);
-            if (pos_u > (uint64_t)total_samples) pos_u = (uint64_t)total_samples;
-            current_sample_pos_display = (uint32_t)pos_u;
-        }
-        uint32_t elapsed_sec = (sample_rate) ? (current_sample_pos_display / sample_rate) : 0;
+        /* [36] Calculate current playback position for display (64-bit, from mixed samples, no float) */
+        uint64_t current_sample_pos_display = is_playing ? stream_get_position(&track->stream) : current_sample_pos;
+        if (current_sample_pos_display > total_samples) current_sample_pos_display = total_samples;
+        uint32_t elapsed_sec = (sample_rate) ? (uint32_t)(current_sample_pos_display / sample_rate) : 0;
         uint32_t play_min = elapsed_sec / 60U;
         uint32_t play_sec = elapsed_sec % 60U;
 
-        /* [37] --- UI Drawing section --- */
-        surface_t *disp = display_get();
-        graphics_fill_screen(disp, bg_color);
-        graphics_set_color(white, 0);
-        const char *title = "mca64Player";
-        int title_x = ((int)display_get_width() - tiny_strlen(title) * 8) / 2;
-        graphics_draw_sprite(disp, 100, 100, logo);
-        debugf("=== Sprite metadata ===");
-        debugf(" w=%u h=%u hslices=%u vslices=%u", logo->width, logo->height, logo->hslices, logo->vslices);
-        debugf(" format=%d fits_tmem=%d pal=%p", (int)sprite_get_format(logo), sprite_fits_tmem(logo) ? 1 : 0, sprite_get_palette(logo));
-        graphics_draw_text(disp, title_x, 4, title);
-        graphics_draw_text(disp, 10, 4, last_button_pressed);
-        graphics_draw_text(disp, 10, 16, analog_pos);
-
-        /* [38] Draw file name */
-        strcpy_s(linebuf, 128, "File: ");
-        int off = tiny_strlen(linebuf);
-        int remaining = (int)128 - off;
-        strcpy_s(&linebuf[off], remaining, filename);
-        graphics_draw_text(disp, 10, 28, linebuf);
-
-        /* [39] Draw playback time (current/total) */
-        format_time_line(linebuf, (unsigned)play_min, (unsigned)play_sec,
-                         (unsigned)total_minutes, (unsigned)total_secs_rem);
-        graphics_draw_text(disp, 10, 46, linebuf);
-
-        /* [40] Draw progress bar */
+        /* [37] --- UI section: widgets keep their value, the screen is drawn at [52] --- */
+        PROF_BEGIN(PROF_WIDGETS);
+        ui_text(W_BUTTON, 10, 4, white, last_button_pressed);
+        ui_text(W_ANALOG, 10, 16, white, analog_pos);
+
+        /* [38] File name (formatted only when the track changes) */
+        if (ui_changed(W_FILE, (uint32_t)track->index)) {
+            strcpy_s(linebuf, 128, "File: ");
+            int off = tiny_strlen(linebuf);
+            int remaining = (int)128 - off;
+            strcpy_s(&linebuf[off], remaining, filename);
+            ui_text(W_FILE, 10, 28, white, linebuf);
+        }
+
+        /* [39] Playback time (current/total), formatted only when a second has passed */
+        if (ui_changed(W_TIME, (elapsed_sec << 16) ^ total_seconds)) {
+            format_time_line(linebuf, (unsigned)play_min, (unsigned)play_sec,
+                             (unsigned)total_minutes, (unsigned)total_secs_rem);
+            ui_text(W_TIME, 10, 46, white, linebuf);
+        }
+
+        /* [40] Progress bar (redrawn only when the filled width changes by a pixel) */
         int bar_x = 10, bar_y = 58, bar_w = 300, bar_h = 8;
-        graphics_draw_box(disp, bar_x, bar_y, bar_w, bar_h, white);
-        if (total_seconds > 0) {
-            int pw = (int)(((uint64_t)elapsed_sec * (uint64_t)bar_w) / (uint64_t)total_seconds);
-            if (pw > bar_w) pw = bar_w;
-            graphics_draw_box(disp, bar_x, bar_y, pw, bar_h, green);
+        ui_hbar(W_PROGRESS, bar_x, bar_y, bar_w, bar_h, elapsed_sec, total_seconds, white, green);
+
+        /* [40.1] Track number and the next track, straight from the catalog (no file is opened) */
+        if (playlist_count() <= 1) {
+            ui_hide(W_TRACK);
+        } else if (ui_changed(W_TRACK, (uint32_t)playlist_index())) {
+            strcpy_s(linebuf, 128, "Track ");
+            int lp = tiny_strlen(linebuf);
+            lp += int_to_dec(&linebuf[lp], playlist_index() + 1);
+            linebuf[lp++] = '/';
+            lp += int_to_dec(&linebuf[lp], playlist_count());
+            lp = safe_append_str(linebuf, 128, lp, "  Next: ");
+            const playlist_entry_t *next = playlist_entry((playlist_index() + 1) % playlist_count());
+            lp = safe_append_str(linebuf, 128, lp, next->path + 5); /* Skip "rom:/" */
+            if (next->has_info && next->info.freq) {
+                uint32_t next_sec = next->info.len / next->info.freq;
+                lp = safe_append_str(linebuf, 128, lp, " (");
+                lp += int_to_dec(&linebuf[lp], (int)(next_sec / 60));
+                linebuf[lp++] = ':';
+                lp += append_uint_zero_pad(&linebuf[lp], next_sec % 60, 2);
+                safe_append_str(linebuf, 128, lp, ")");
+            } else linebuf[lp] = '\0';
+            ui_text(W_TRACK, 10, 70, white, linebuf);
+        }
+
+        /* [40.2] Sample source: RAM preload (with its size) or cartridge streaming */
+        {
+            const stream_t *st = &track->stream;
+            strcpy_s(linebuf, 128, "Source: ");
+            int lp = tiny_strlen(linebuf);
+            if (st->preload) {
+                bool full = st->preload_size >= stream_data_bytes(st);
+                lp = safe_append_str(linebuf, 128, lp, full ? "RAM " : "RAM prefix ");
+                lp += int_to_dec(&linebuf[lp], (int)(st->preload_bytes / 1024));
+                if (!stream_preload_done(st)) {
+                    linebuf[lp++] = '/';
+                    lp += int_to_dec(&linebuf[lp], (int)(st->preload_size / 1024));
+                }
+                safe_append_str(linebuf, 128, lp, " KB");
+            } else if (playlist_preload_budget() == 0) {
+                safe_append_str(linebuf, 128, lp, "ROM stream (4 MB RAM)");
+            } else {
+                safe_append_str(linebuf, 128, lp, track->format == 3 ? "ROM stream (Opus)" : "ROM stream (no fit)");
+            }
+            ui_text(W_SOURCE, 10, 82, white, linebuf);
         }
 
         /* [45] Draw VU meters (audio levels) */
-        vu_update(frame_interval_ms, max_amp_l, max_amp_r);
+        vu_update((uint32_t)clock_to_us(clock_pass_interval()), max_amp_l, max_amp_r);
         int vu_base_x = 12;
         int vu_base_y = 110;
         int vu_width = 8;
         int vu_height = 40;
         int draw_vu_l = vu_get_left();
         int draw_vu_r = vu_get_right();
-        if (channels == 2) {
-            draw_vu_meter(disp, vu_base_x - 0, vu_base_y, vu_width, vu_height, draw_vu_l, 32768, white, green, "L");
-            draw_vu_meter(disp, vu_base_x + vu_width + 10, vu_base_y, vu_width, vu_height, draw_vu_r, 32768, white, green, "R");
+        if (!governor_show_vu()) {
+            ui_hide_range(W_VU_L, W_VU_R_LABEL + 1); /* Governor: lowest level */
+        } else if (channels == 2) {
+            draw_vu_meter(W_VU_L, vu_base_x - 0, vu_base_y, vu_width, vu_height, draw_vu_l, 32768, white, green, "L");
+            draw_vu_meter(W_VU_R, vu_base_x + vu_width + 10, vu_base_y, vu_width, vu_height, draw_vu_r, 32768, white, green, "R");
         } else {
             int mono_v = (draw_vu_l > draw_vu_r) ? draw_vu_l : draw_vu_r;
             if (mono_v == 0) mono_v = max_amp;
-            draw_vu_meter(disp, vu_base_x + 8, vu_base_y, vu_width, vu_height, mono_v, 32768, white, green, "Mono");
+            draw_vu_meter(W_VU_L, vu_base_x + 8, vu_base_y, vu_width, vu_height, mono_v, 32768, white, green, "Mono");
+            ui_hide_range(W_VU_R, W_VU_R_LABEL + 1);
         }
+        PROF_END(PROF_WIDGETS);
 
-        /* [46] Update FPS and CPU usage meters */
-        uint32_t now_ticks = timer_ticks();
-        uint32_t diff_ticks = now_ticks - last_frame_ticks;
-        if (last_frame_ticks != 0 && diff_ticks > 0) {
-            fps = TICKS_PER_SECOND / diff_ticks;
+        /* [48] Z + START: profiler bar on/off */
+        if (held.z && pressed.start) {
+            ab_combo_used = true;
+            prof_set_enabled(!prof_get_enabled());
+            show_message(prof_get_enabled() ? "Profiler: ON" : "Profiler: OFF");
+            pressed.start = 0;
         }
-        last_frame_ticks = now_ticks;
-
-        if (smoothed_fps <= 0.0f) smoothed_fps = (float)fps;
-        else smoothed_fps = (1.0f - FRAME_MS_ALPHA) * smoothed_fps + FRAME_MS_ALPHA * (float)fps;
-
-
 
         /* [49] Handle menu opening (START button) */
         if (pressed.start && !menu_is_open()) {
@@ -292,12 +392,12 @@ int main(void) {
         /* [50] Handle menu navigation and selection */
         if (menu_is_open()) {
             const resolution_t *sel = NULL;
+            surface_t *disp = ui_frame_begin(true); /* Whole screen under the menu, every frame */
             menu_status_t st = menu_update(disp, pressed, held, &sel);
-            display_show(disp);
+            gfx_end();
+            audio_engine_pump(); /* Keep the audio fed on the menu path too */
             if (st == MENU_STATUS_SELECTED && sel) {
-                current_resolution = sel;
-                display_close();
-                display_init(*sel, DEPTH_32_BPP, 2, GAMMA_NONE, ANTIALIAS_OFF);
+                int bpp = set_resolution(sel, menu_get_depth());
                 menu_close();
                 char buf[64];
                 strcpy_s(buf, 64, "Selected: ");
@@ -307,147 +407,325 @@ int main(void) {
                 pos += int_to_dec(&buf[pos], (int)sel->height);
                 pos = safe_append_str(buf, 64, pos, " ");
                 pos = safe_append_str(buf, 64, pos, sel->interlaced ? "i" : "p");
+                pos = safe_append_str(buf, 64, pos, " ");
+                pos += int_to_dec(&buf[pos], bpp);
+                pos = safe_append_str(buf, 64, pos, " bpp");
                 show_message(buf);
             } else if (st == MENU_STATUS_CANCEL) {
                 show_message("Cancelled");
                 menu_close();
             }
+            if (!menu_is_open()) ui_invalidate(); /* The menu box is in every buffer */
             continue;
         }
 
         /* [51] Handle playback controls (A, B, L, R, C, D, Z buttons) */
+        /* [51.0] A-B repeat: Z + C-LEFT sets A, Z + C-RIGHT sets B and starts the loop, Z + C-DOWN clears */
+        /* [51.0.1] Transitions: Z + C-UP cycles the mode, Z + D-UP the crossfade curve,
+           Z + D-LEFT / D-RIGHT shorten / lengthen the crossfade */
+        if (held.z && (pressed.c_up || pressed.d_up || pressed.d_left || pressed.d_right)) {
+            ab_combo_used = true;
+            if (pressed.c_up) {
+                transition_set_mode((transition_mode_t)((transition_get_mode() + 1) % TRANSITION_MODE_COUNT));
+                strcpy_s(tmpbuf, 64, "Transition: ");
+                safe_append_str(tmpbuf, 64, -1, transition_mode_name(transition_get_mode()));
+            } else if (pressed.d_up) {
+                transition_set_curve((transition_curve_t)((transition_get_curve() + 1) % TRANSITION_CURVE_COUNT));
+                strcpy_s(tmpbuf, 64, "Curve: ");
+                safe_append_str(tmpbuf, 64, -1, transition_curve_name(transition_get_curve()));
+            } else {
+                uint32_t ms = transition_get_length_ms();
+                transition_set_length_ms(pressed.d_right ? ms + 500 : (ms > 500 ? ms - 500 : 0));
+                strcpy_s(tmpbuf, 64, "Crossfade: ");
+                int len = tiny_strlen(tmpbuf);
+                len += int_to_dec(&tmpbuf[len], (int)transition_get_length_ms());
+                safe_append_str(tmpbuf, 64, len, " ms");
+            }
+            show_message(tmpbuf);
+            pressed.c_up = pressed.d_up = pressed.d_left = pressed.d_right = 0;
+        }
+        /* [51.0.2] Z + B: switch the UI drawing between the RDP and the CPU (compare CPU ms in the overlay) */
+        if (held.z && pressed.b) {
+            ab_combo_used = true;
+            gfx_set_backend(gfx_get_backend() == GFX_BACKEND_RDPQ ? GFX_BACKEND_SOFTWARE : GFX_BACKEND_RDPQ);
+            strcpy_s(tmpbuf, 64, "Drawing: ");
+            safe_append_str(tmpbuf, 64, -1, gfx_backend_name(gfx_get_backend()));
+            show_message(tmpbuf);
+            pressed.b = 0;
+        }
+        /* [51.0.3] Z + A: batched atlas text on / off (the overlay shows the cost of each text path) */
+        /* [51.0.4] Z + L: retained screen on / off (off = full redraw every frame) */
+        if (held.z && pressed.l) {
+            ab_combo_used = true;
+            ui_set_retained(!ui_get_retained());
+            show_message(ui_get_retained() ? "Screen: retained" : "Screen: full redraw");
+            pressed.l = 0;
+        }
+        /* [51.0.5] Z + R: benchmark every menu resolution (Z + R again stops it); table in the debug log */
+        if (held.z && pressed.r) {
+            ab_combo_used = true;
+            const resolution_t *next = bench_running() ? bench_cancel() : bench_start(current_resolution);
+            if (next) set_resolution(next, menu_get_depth());
+            if (bench_running()) bench_set_bpp(video_get_bpp());
+            show_message(bench_running() ? "Benchmark started" : "Benchmark stopped");
+            pressed.r = 0;
+        }
+        /* [51.0.6] Z + D-DOWN: double / triple buffering (the mode is opened again) */
+        if (held.z && pressed.d_down) {
+            ab_combo_used = true;
+            video_set_buffers(video_get_buffers() == 2 ? 3 : 2);
+            set_resolution(current_resolution, menu_get_depth());
+            show_message(video_get_buffers() == 3 ? "Triple buffering" : "Double buffering");
+            pressed.d_down = 0;
+        }
+        if (held.z && pressed.a) {
+            ab_combo_used = true;
+            gfx_set_text_batching(!gfx_get_text_batching());
+            show_message(gfx_get_text_batching() ? "Text: batched atlas" : "Text: rdpq per string");
+            pressed.a = 0;
+        }
+        if (held.z && (pressed.c_left || pressed.c_right || pressed.c_down)) {
+            ab_combo_used = true;
+            if (pressed.c_left) {
+                ab_point_a = current_sample_pos_display;
+                ab_has_a = true;
+                show_message("A point set");
+            } else if (pressed.c_right) {
+                if (ab_has_a && stream_set_loop_points(&track->stream, ab_point_a, current_sample_pos_display)) {
+                    loop_enabled = true;
+                    stream_set_loop(&track->stream, true);
+                    show_message("A-B loop ON");
+                } else show_message("Set A first (B after A)");
+            } else {
+                stream_clear_loop_points(&track->stream);
+                ab_has_a = false;
+                show_message("A-B loop cleared");
+            }
+            pressed.c_left = pressed.c_right = pressed.c_down = 0;
+        }
         if (pressed.a) {
-            if (is_playing && mixer_ch_playing(sound_channel)) {
-                float pos_f = mixer_ch_get_pos(sound_channel);
-                if (pos_f < 0.0f) pos_f = 0.0f;
-                uint64_t pos_u = (uint64_t)(pos_f + 0.5f);
-                if (pos_u > (uint64_t)total_samples) pos_u = (uint64_t)total_samples;
-                current_sample_pos = (uint32_t)pos_u;
-                mixer_ch_stop(sound_channel);
-                is_playing = false;
-                show_message("Pause");
+            if (is_playing && track->stream.running) {
+                /* [51.1] Pause/resume in place: the queued output is dropped and the track (both
+                   tracks during a transition) resumes at the exact sample that was cut off. */
+                bool pause = !transition_is_paused();
+                transition_set_paused(pause);
+                show_message(pause ? "Pause" : "Resumed");
             } else {
-                if (compression_level != 0 && current_sample_pos != 0) {
-                    current_sample_pos = 0;
-                    show_message("Unavailable - start from beginning");
-                }
-                wav64_play(&sound, sound_channel);
-                mixer_ch_set_pos(sound_channel, (float)current_sample_pos);
-                mixer_ch_set_vol(sound_channel, volume, volume);
+                /* [51.2] Stopped or ended: start again from the stored position */
+                if (current_sample_pos >= total_samples) current_sample_pos = 0;
+                transition_set_paused(false);
+                stream_play(&track->stream, sound_channel);
+                transition_set_volume(volume);
+                if (current_sample_pos != 0) current_sample_pos = stream_seek(&track->stream, sound_channel, current_sample_pos);
                 is_playing = true;
                 show_message("Resumed");
             }
         }
         if (pressed.b) {
-            if (mixer_ch_playing(sound_channel)) mixer_ch_stop(sound_channel);
+            transition_finish(); /* Stop a track that is still fading out */
+            stream_stop(&track->stream, sound_channel);
+            transition_set_paused(false); /* Nothing is playing any more: only clears the flag */
             current_sample_pos = 0;
             is_playing = false;
             show_message("Stop");
         }
+        /* [51.4] D-Up / D-Down: previous / next track. The next one is already primed, so the switch
+           is a channel stop + play (or the start of a crossfade); going back opens the file first. */
+        if (pressed.d_up || pressed.d_down) {
+            track = transition_switch(pressed.d_down ? +1 : -1);
+            sound_channel = transition_channel();
+            stream_set_loop(&track->stream, loop_enabled);
+            current_sample_pos = 0;
+            current_sample_pos_display = 0;
+            is_playing = true;
+            ab_has_a = false;
+            track_changed = true;
+            transition_stats_t ts;
+            transition_get_stats(&ts);
+            show_seek_message(pressed.d_down ? "Next track" : "Previous track", ts.last_start_us);
+        }
         if (pressed.l || pressed.d_left) {
-            if (compression_level == 0) {
-                int64_t delta_samples = (int64_t)5 * (int64_t)sample_rate;
-                int64_t newpos = (int64_t)current_sample_pos_display - delta_samples;
-                if (newpos < 0) newpos = 0;
-                current_sample_pos = (uint32_t)newpos;
-                if (is_playing && mixer_ch_playing(sound_channel)) mixer_ch_set_pos(sound_channel, (float)current_sample_pos);
-                show_message("Rewind -5s");
-            } else show_message("Unavailable for this format");
+            int64_t newpos = (int64_t)current_sample_pos_display - (int64_t)5 * (int64_t)sample_rate;
+            if (newpos < 0) newpos = 0;
+            current_sample_pos = (uint64_t)newpos;
+            if (is_playing && track->stream.running) {
+                current_sample_pos = stream_seek(&track->stream, sound_channel, current_sample_pos);
+                show_seek_message("Rewind -5s", track->stream.last_seek_us);
+            } else show_message("Rewind -5s");
         }
         if (pressed.r || pressed.d_right) {
-            if (compression_level == 0) {
-                uint64_t delta_samples = (uint64_t)5 * (uint64_t)sample_rate;
-                uint64_t newpos = (uint64_t)current_sample_pos_display + delta_samples;
-                if (newpos > (uint64_t)total_samples) newpos = (uint64_t)total_samples;
-                current_sample_pos = (uint32_t)newpos;
-                if (is_playing && mixer_ch_playing(sound_channel)) mixer_ch_set_pos(sound_channel, (float)current_sample_pos);
-                show_message("Forward +5s");
-            } else show_message("Unavailable for this format");
+            int64_t newpos = (int64_t)current_sample_pos_display + (int64_t)5 * (int64_t)sample_rate;
+            if (newpos > (int64_t)total_samples) newpos = (int64_t)total_samples;
+            current_sample_pos = (uint64_t)newpos;
+            if (is_playing && track->stream.running) {
+                current_sample_pos = stream_seek(&track->stream, sound_channel, current_sample_pos);
+                show_seek_message("Forward +5s", track->stream.last_seek_us);
+            } else show_message("Forward +5s");
         }
         if (pressed.c_left) {
-            if (compression_level == 0) {
-                int64_t delta_samples = (int64_t)30 * (int64_t)sample_rate;
-                int64_t newpos = (int64_t)current_sample_pos_display - delta_samples;
-                if (newpos < 0) newpos = 0;
-                current_sample_pos = (uint32_t)newpos;
-                if (is_playing && mixer_ch_playing(sound_channel)) mixer_ch_set_pos(sound_channel, (float)current_sample_pos);
-                show_message("Rewind -30s");
-            } else show_message("Unavailable for this format");
+            int64_t newpos = (int64_t)current_sample_pos_display - (int64_t)30 * (int64_t)sample_rate;
+            if (newpos < 0) newpos = 0;
+            current_sample_pos = (uint64_t)newpos;
+            if (is_playing && track->stream.running) {
+                current_sample_pos = stream_seek(&track->stream, sound_channel, current_sample_pos);
+                show_seek_message("Rewind -30s", track->stream.last_seek_us);
+            } else show_message("Rewind -30s");
         }
         if (pressed.c_right) {
-            if (compression_level == 0) {
-                uint64_t delta_samples = (uint64_t)30 * (uint64_t)sample_rate;
-                uint64_t newpos = (uint64_t)current_sample_pos_display + delta_samples;
-                if (newpos > (uint64_t)total_samples) newpos = (uint64_t)total_samples;
-                current_sample_pos = (uint32_t)newpos;
-                if (is_playing && mixer_ch_playing(sound_channel)) mixer_ch_set_pos(sound_channel, (float)current_sample_pos);
-                show_message("Forward +30s");
-            } else show_message("Unavailable for this format");
-        }
-        if (pressed.d_up || pressed.c_up) {
+            int64_t newpos = (int64_t)current_sample_pos_display + (int64_t)30 * (int64_t)sample_rate;
+            if (newpos > (int64_t)total_samples) newpos = (int64_t)total_samples;
+            current_sample_pos = (uint64_t)newpos;
+            if (is_playing && track->stream.running) {
+                current_sample_pos = stream_seek(&track->stream, sound_channel, current_sample_pos);
+                show_seek_message("Forward +30s", track->stream.last_seek_us);
+            } else show_message("Forward +30s");
+        }
+        if (pressed.c_up) {
             volume += 0.1f;
             if (volume > 1.0f) volume = 1.0f;
-            mixer_ch_set_vol(sound_channel, volume, volume);
+            transition_set_volume(volume);
             strcpy_s(tmpbuf, 64, "Volume: ");
             int len = tiny_strlen(tmpbuf);
             format_float_one_decimal(&tmpbuf[len], volume);
             show_message(tmpbuf);
         }
-        if (pressed.d_down || pressed.c_down) {
+        if (pressed.c_down) {
             volume -= 0.1f;
             if (volume < 0.0f) volume = 0.0f;
-            mixer_ch_set_vol(sound_channel, volume, volume);
+            transition_set_volume(volume);
             strcpy_s(tmpbuf, 64, "Volume: ");
             int len = tiny_strlen(tmpbuf);
             format_float_one_decimal(&tmpbuf[len], volume);
             show_message(tmpbuf);
         }
-        if (pressed.z) {
-            loop_enabled = !loop_enabled;
-            wav64_set_loop(&sound, loop_enabled);
-            if (loop_enabled) show_message("Loop: ON"); else show_message("Loop: OFF");
-        }
-
-        /* [52] Draw HUD message and debug info */
-        hud_draw_message(disp, box_frame_color, box_bg_color);
-        unsigned int uptime_sec = (unsigned int)(last_frame_start_ms / 1000.0f);
-        debug_info(disp,
-           (int)sample_rate,
-           last_cpu_ms_display,
-           cpu_usage_get_avg(),
-           smoothed_fps,
-           (int)(ram_free * 1024.0 * 1024.0),
-           312, 12,
+        if (released.z) {
+            /* [51.3] Z alone toggles looping; Z held with a C button edits the A-B points instead */
+            if (!ab_combo_used) {
+                loop_enabled = !loop_enabled;
+                stream_set_loop(&track->stream, loop_enabled);
+                if (loop_enabled) show_message("Loop: ON"); else show_message("Loop: OFF");
+            }
+            ab_combo_used = false;
+        }
+
+        /* [52] Update the HUD message and debug info widgets, then draw what changed */
+        PROF_BEGIN(PROF_HUD);
+        hud_draw_message(box_frame_color, box_bg_color);
+        PROF_END(PROF_HUD);
+        unsigned int uptime_sec = clock_uptime_sec();
+        int debug_x = (int)display_get_width() - DEBUG_COLUMN_W; /* Right column, moves with the render width */
+        if (debug_x < 0) debug_x = 0;
+        PROF_BEGIN(PROF_DEBUG);
+        if (!governor_show_debug()) {
+            /* [52.0] Governor at its lowest level: only its own line stays */
+            governor_describe(tmpbuf, 64);
+            ui_text(UI_ID_DEBUG, debug_x, 12, color_get(COL_DEBUG), tmpbuf);
+            ui_hide_range(UI_ID_DEBUG + 1, UI_ID_DEBUG_END);
+        } else debug_info((int)sample_rate,
+           &metrics,
+           debug_x, 12,
            uptime_sec,
            ram_total,
-           &sound,
+           &track->wav,
+           &track->stream,
            header_hex_string,
            compression_level);
-
-        display_show(disp);
-
-        /* [53] End of frame: measure and update CPU/frame stats */
-        float frame_end_ms = get_ticks_ms();
-        float measured_ms = frame_end_ms - frame_start_ms;
-        if (last_frame_start_ms > 0.0f) frame_interval_ms = frame_start_ms - last_frame_start_ms;
-        if (frame_interval_ms <= 0.0f) frame_interval_ms = (measured_ms > 0.0f) ? measured_ms : (1000.0f / 60.0f);
-        float cpu_percent = (frame_interval_ms > 0.0f) ? ((measured_ms / frame_interval_ms) * 100.0f) : 0.0f;
-        if (cpu_percent > 100.0f) cpu_percent = 100.0f;
-        if (cpu_percent < 0.0f) cpu_percent = 0.0f;
-        cpu_usage_add_sample(cpu_percent);
-        if (smoothed_frame_ms <= 0.0f) smoothed_frame_ms = measured_ms;
-        else {
-            float new_smoothed = (1.0f - FRAME_MS_ALPHA) * smoothed_frame_ms + FRAME_MS_ALPHA * measured_ms;
-            if (fabsf(new_smoothed - smoothed_frame_ms) > FRAME_MS_DISPLAY_THRESHOLD) smoothed_frame_ms = new_smoothed;
-        }
-        last_cpu_ms_display = smoothed_frame_ms;
-        last_frame_start_ms = frame_start_ms;
-        wait_ms(1); /* Short yield to avoid busy loop */
+        PROF_END(PROF_DEBUG);
+        prof_draw(10, (int)display_get_height() - 24, 300); /* [52.0.1] 300 px = one VI frame */
+
+        /* [52.1] Show the frame (the RDP finishes it without the CPU waiting). Nothing changed:
+           no frame at all, the display keeps showing the last one. */
+        /* The governor may hold the frame back (lower UI rate): the changes wait like a skip. */
+        governor_hold(bench_running());
+        surface_t *disp = NULL;
+        bool busy = false;
+        if (governor_frame_due()) {
+            PROF_BEGIN(PROF_DRAW);
+            disp = ui_frame_begin(false);
+            busy = ui_frame_busy();
+            PROF_END(PROF_DRAW);
+        }
+        if (disp) {
+            PROF_BEGIN(PROF_SHOW);
+            gfx_end();
+            PROF_END(PROF_SHOW);
+            governor_frame_drawn();
+        }
+        /* [52.2] No free framebuffer (all queued): instead of blocking, go round again. The next
+           pass polls input, collects audio peaks and meters, and tries again. */
+        if (busy) continue;
+        prof_frame_end();
+
+        /* [46] Frame interval for the FPS (frames shown or skipped, not the passes that found no buffer) */
+        uint32_t frame_interval_us = (uint32_t)clock_to_us(clock_frame_interval());
+        stats_add(&metrics.interval_us, frame_interval_us);
+
+        /* [53] End of frame: measure and update CPU/frame stats (whole ticks, no float timestamps) */
+        uint32_t measured_ticks = clock_pass_elapsed();
+        uint32_t measured_us = (uint32_t)clock_to_us(measured_ticks);
+        uint32_t interval_ticks = clock_frame_interval();
+        if (interval_ticks < measured_ticks) interval_ticks = measured_ticks;
+        float cpu_percent = interval_ticks ? (float)((uint64_t)measured_ticks * 1000u / interval_ticks) / 10.0f : 0.0f;
+        stats_add(&metrics.frame_us, measured_us);
+        if (measured_ticks > clock_vi_ticks()) EVLOG_EVERY(1000, SLOW_FRAME, measured_us, clock_vi_us());
+        stats_add(&metrics.cpu_pct10, (uint32_t)(cpu_percent * 10.0f));
+        governor_update((float)measured_us / 1000.0f, disp != NULL);
+        /* [53.0] Audio: mixer time per buffer mixed since the last frame, lowest output ring fill since then */
+        {
+            uint64_t mix_ticks;
+            uint32_t mix_buffers;
+            audio_engine_get_mix_cost(&mix_ticks, &mix_buffers, NULL);
+            if (mix_buffers > last_mix_buffers && mix_ticks >= last_mix_ticks) {
+                uint64_t ticks = (mix_ticks - last_mix_ticks) / (mix_buffers - last_mix_buffers);
+                stats_add(&metrics.mix_us, (uint32_t)TICKS_TO_US((uint32_t)ticks));
+            }
+            last_mix_ticks = mix_ticks;
+            last_mix_buffers = mix_buffers;
+            stats_add(&metrics.fill_pct, audio_engine_take_min_fill(AUDIO_FILL_FRAME));
+            uint32_t underruns = audio_engine_get_underruns();
+            if (underruns != last_underruns) {
+                EVLOG_EVERY(1000, UNDERRUN, underruns);
+                last_underruns = underruns;
+            }
+        }
+        clock_frame_end();
+        /* [53.0.1] Zero-allocation check: once playback has been quiet for a while, a frame that
+           calls malloc or free is counted and logged */
+        if (!is_playing || track_changed || menu_is_open() || bench_running() || transition_active()) quiet_frames = 0;
+        else if (quiet_frames < MEM_STEADY_FRAMES) quiet_frames++;
+        mem_frame_end(quiet_frames >= MEM_STEADY_FRAMES);
+        /* [53.1] Benchmark: record this frame, go to the next mode when this one is done */
+        if (bench_running()) {
+            const mem_stats_t *ms = mem_get_stats();
+            const resolution_t *next = bench_frame(frame_interval_us, cpu_percent, (int)(ms->heap_total - ms->heap_used));
+            if (next) {
+                int bpp = set_resolution(next, menu_get_depth());
+                if (bench_running()) {
+                    int total = 0;
+                    int k = bench_progress(&total);
+                    bench_set_bpp(bpp);
+                    strcpy_s(tmpbuf, 64, "Bench ");
+                    int pos = tiny_strlen(tmpbuf);
+                    pos += int_to_dec(&tmpbuf[pos], k + 1);
+                    tmpbuf[pos++] = '/';
+                    pos += int_to_dec(&tmpbuf[pos], total);
+                    tmpbuf[pos] = '\0';
+                    show_message(tmpbuf);
+                } else {
+                    show_message("Benchmark done (debug log)");
+                }
+            }
+        }
+        evlog_flush(clock_budget_left()); /* [53.2] Idle time left in this VI period: write out the event log */
+        if (!disp) { /* Skipped frame: keep the loop paced at one VI period */
+            uint32_t left = clock_budget_left();
+            if (left) wait_ticks(left);
+        }
     }
 
     /* [54] Cleanup (not normally reached) */
     if (mixer_ch_playing(sound_channel)) mixer_ch_stop(sound_channel);
-    wav64_close(&sound);
-    audio_close();
+    audio_engine_close();
+    playlist_close();
     return 0;
 }
@@ -0,0 +1,140 @@
+/* [1] mem.c - Memory accounting (see mem.h) */
+#include "mem.h"
+#include <libdragon.h>
+#include <malloc.h>
+#include "evlog.h" /* [2] Steady-state allocations and budget overruns */
+#include "arena.h" /* [2.1] Arena sizes, checked against MEM_BUDGET_ARENA */
+
+static mem_stats_t stats;
+static uint32_t heap_accounted = 0; /* Heap bytes ever accounted (all but MEM_ARENA), for nested scopes */
+static bool dirty = true;          /* The heap summary needs mallinfo() again */
+static volatile uint32_t mallocs = 0, frees = 0;
+static uint32_t mallocs0 = 0, frees0 = 0;
+static bool frame_unsteady = false; /* mem_frame_unsteady() was called in this frame */
+
+static const uint32_t budget[MEM_TAG_COUNT] = {
+    [MEM_FRAMEBUFFER] = MEM_BUDGET_FRAMEBUFFER,
+    [MEM_AUDIO] = MEM_BUDGET_AUDIO,
+    [MEM_ASSETS] = MEM_BUDGET_ASSETS,
+    [MEM_UI] = MEM_BUDGET_UI,
+    [MEM_ARENA] = MEM_BUDGET_ARENA,
+};
+_Static_assert(ARENA_PERSISTENT_SIZE + ARENA_FRAME_SIZE + 2 * ARENA_TRACK_SIZE <= MEM_BUDGET_ARENA, "arena budget");
+
+/* [2.2] Scopes end here too, so every way memory is accounted passes the budget check */
+void mem_account(mem_tag_t tag, int32_t bytes) {
+    if (tag < 0 || tag >= MEM_TAG_COUNT || bytes == 0) return;
+    if (bytes < 0 && (uint32_t)-bytes > stats.used[tag]) bytes = -(int32_t)stats.used[tag];
+    bool was_over = stats.used[tag] > budget[tag];
+    stats.used[tag] += (uint32_t)bytes;
+    if (stats.used[tag] > stats.peak[tag]) stats.peak[tag] = stats.used[tag];
+    if (tag != MEM_ARENA) heap_accounted += (uint32_t)bytes; /* Arena bytes are static, not heap */
+    dirty = true;
+    if (!was_over && stats.used[tag] > budget[tag]) {
+        EVLOG(MEM_BUDGET, (uint32_t)tag, (stats.used[tag] + 1023u) / 1024u, budget[tag] / 1024u);
+#if MEM_STRICT
+        assertf(0, "Memory category %s over budget: %lu of %lu bytes", mem_tag_name(tag),
+                (unsigned long)stats.used[tag], (unsigned long)budget[tag]);
+#endif
+    }
+}
+
+/* [3] Scopes: mallinfo() only here and in the summary, never per frame. Only heap bytes
+   accounted inside the scope are taken off the heap change: an arena_reset() or arena
+   allocation inside it does not move the heap. */
+mem_scope_t mem_scope_begin(void) {
+    struct mallinfo mi = mallinfo();
+    return (mem_scope_t){ (uint32_t)mi.uordblks, heap_accounted };
+}
+
+void mem_scope_end(mem_tag_t tag, mem_scope_t scope) {
+    struct mallinfo mi = mallinfo();
+    int32_t delta = (int32_t)((uint32_t)mi.uordblks - scope.heap_used);
+    delta -= (int32_t)(heap_accounted - scope.heap_accounted);
+    mem_account(tag, delta);
+}
+
+/* [4] Heap summary. The largest block a new allocation can get is the top chunk (keepcost)
+   plus the heap above the current break; free chunks below the top are holes. */
+static void refresh(void) {
+    heap_stats_t hs;
+    sys_get_heap_stats(&hs);
+    struct mallinfo mi = mallinfo();
+    stats.heap_total = (uint32_t)hs.total;
+    stats.heap_used = (uint32_t)mi.uordblks;
+    uint32_t unclaimed = hs.total > mi.arena ? (uint32_t)(hs.total - mi.arena) : 0;
+    uint32_t top = (uint32_t)mi.keepcost;
+    uint32_t holes = (uint32_t)mi.fordblks > top ? (uint32_t)mi.fordblks - top : 0;
+    uint32_t free_total = holes + top + unclaimed;
+    stats.largest_free = top + unclaimed;
+    stats.frag_pct = free_total ? (uint32_t)((uint64_t)holes * 100u / free_total) : 0;
+    uint32_t tagged = 0;
+    for (int t = 0; t < MEM_TAG_COUNT; t++)
+        if (t != MEM_ARENA) tagged += stats.used[t];
+    stats.other = stats.heap_used > tagged ? stats.heap_used - tagged : 0;
+    dirty = false;
+}
+
+/* [5] Frame counters */
+void mem_frame_end(bool steady) {
+    uint32_t m = mallocs, f = frees;
+    stats.frame_mallocs = m - mallocs0;
+    stats.frame_frees = f - frees0;
+    mallocs0 = m;
+    frees0 = f;
+    if (frame_unsteady) steady = false;
+    frame_unsteady = false;
+    if (steady && (stats.frame_mallocs || stats.frame_frees)) {
+        stats.alloc_frames++;
+        EVLOG_EVERY(1000, FRAME_ALLOC, stats.frame_mallocs, stats.frame_frees);
+#if MEM_STRICT
+        assertf(0, "Playback loop allocated: %lu malloc, %lu free",
+                (unsigned long)stats.frame_mallocs, (unsigned long)stats.frame_frees);
+#endif
+    }
+}
+
+void mem_frame_unsteady(void) {
+    frame_unsteady = true;
+}
+
+const mem_stats_t *mem_get_stats(void) {
+    if (dirty) refresh();
+    return &stats;
+}
+
+const char *mem_tag_name(mem_tag_t tag) {
+    switch (tag) {
+        case MEM_FRAMEBUFFER: return "fb";
+        case MEM_AUDIO: return "au";
+        case MEM_ASSETS: return "as";
+        case MEM_UI: return "ui";
+        case MEM_ARENA: return "ar";
+        default: return "?";
+    }
+}
+
+uint32_t mem_tag_budget(mem_tag_t tag) {
+    return (tag >= 0 && tag < MEM_TAG_COUNT) ? budget[tag] : 0;
+}
+
+#if MEM_WRAP
+/* [6] Linker wrappers (-Wl,--wrap=malloc ...): every call of the program is counted. Only a
+   counter and the dirty flag, so the cost is two stores per call. */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+void *__real_memalign(size_t align, size_t size);
+void __real_free(void *p);
+
+void *__wrap_malloc(size_t size) { mallocs++; dirty = true; return __real_malloc(size); }
+void *__wrap_calloc(size_t n, size_t size) { mallocs++; dirty = true; return __real_calloc(n, size); }
+void *__wrap_realloc(void *p, size_t size) { mallocs++; dirty = true; return __real_realloc(p, size); }
+void *__wrap_memalign(size_t align, size_t size) { mallocs++; dirty = true; return __real_memalign(align, size); }
+void __wrap_free(void *p) {
+    if (!p) return;
+    frees++;
+    dirty = true;
+    __real_free(p);
+}
+#endif
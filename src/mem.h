@@ -0,0 +1,72 @@
+/* [1] mem.h - Memory accounting. Heap bytes per category with high-water marks are updated where
+   memory is allocated or freed, never polled per frame. Memory that a library call allocates
+   on its own (display_init, audio_init, wav64_open, sprite_load, ...) is measured as the heap
+   change across the call (a scope). The heap summary (free, largest free block,
+   fragmentation) is computed again only after something changed. With MEM_WRAP (Makefile,
+   default on) every malloc/free of the program, libdragon included, is counted, so a frame
+   of the playback loop that allocates is caught. */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef MEM_WRAP
+#define MEM_WRAP 0          /* [2] Set with the linker --wrap flags by the Makefile */
+#endif
+#ifndef MEM_STRICT
+#define MEM_STRICT 0        /* 1: a steady-state frame that allocates stops with an assert */
+#endif
+
+/* [3] Categories. The arena is a static block, not heap: it is shown but not in `other`. */
+typedef enum {
+    MEM_FRAMEBUFFER = 0,    /* Display buffers */
+    MEM_AUDIO,              /* Audio ring, mixer, open streams (decoders, index, file buffers) */
+    MEM_ASSETS,             /* Logo sprite, track RAM cache, catalog */
+    MEM_UI,                 /* Surface pool, glyph atlas, fonts */
+    MEM_ARENA,              /* arena_alloc() */
+    MEM_TAG_COUNT
+} mem_tag_t;
+
+/* [3.1] Budget of each category in bytes: the most the player should ever need. A category
+   that goes past it is logged once per crossing (MEM_BUDGET event); MEM_STRICT asserts. */
+#define MEM_BUDGET_FRAMEBUFFER (640 * 576 * 4 * 3 + 64 * 1024) /* Largest mode, 32 bpp, 3 buffers */
+#define MEM_BUDGET_AUDIO (512 * 1024)          /* Two track slots, each with two Opus handles */
+#define MEM_BUDGET_ASSETS (5 * 1024 * 1024 + 256 * 1024) /* Track cache (5 MB), logo, catalog */
+#define MEM_BUDGET_UI (640 * 576 * 4 + 192 * 1024) /* Surface pool (largest mode), atlas, fonts */
+#define MEM_BUDGET_ARENA (56 * 1024)           /* Persistent, frame and two track arenas */
+
+typedef struct {
+    uint32_t used[MEM_TAG_COUNT];
+    uint32_t peak[MEM_TAG_COUNT];   /* High-water marks */
+    uint32_t heap_total;            /* Heap size (RAM minus code, data and stack) */
+    uint32_t heap_used;
+    uint32_t other;                 /* Heap bytes in no category */
+    uint32_t largest_free;          /* Top free chunk plus the heap not claimed yet */
+    uint32_t frag_pct;              /* Free bytes in holes below the top, % of all free bytes */
+    uint32_t frame_mallocs;         /* Calls in the last frame (MEM_WRAP only) */
+    uint32_t frame_frees;
+    uint32_t alloc_frames;          /* Steady-state frames that allocated */
+} mem_stats_t;
+
+/* [4] A known size allocated (bytes > 0) or freed (bytes < 0) */
+void mem_account(mem_tag_t tag, int32_t bytes);
+
+/* [5] Scope: heap change across library calls. Heap sizes accounted inside it (also by inner
+   scopes) are not counted twice; MEM_ARENA changes inside it do not touch the heap and are ignored. */
+typedef struct {
+    uint32_t heap_used;
+    uint32_t heap_accounted;
+} mem_scope_t;
+mem_scope_t mem_scope_begin(void);
+void mem_scope_end(mem_tag_t tag, mem_scope_t scope);
+
+/* [6] End of a frame: malloc/free calls of the frame. `steady` = the loop should not allocate
+   now (playing, no track change, menu or mode switch); a frame that does is counted and logged. */
+void mem_frame_end(bool steady);
+
+/* [6.1] The current frame runs one-off work the user asked for (opening the second Opus handle for
+   an A-B loop): its allocations are expected, so mem_frame_end() does not count it as steady. */
+void mem_frame_unsteady(void);
+
+const mem_stats_t *mem_get_stats(void); /* Heap summary brought up to date when it changed */
+const char *mem_tag_name(mem_tag_t tag); /* Two letters, for the debug overlay */
+uint32_t mem_tag_budget(mem_tag_t tag);  /* MEM_BUDGET_* of the category */
@@ -1,6 +1,12 @@
 #include "menu.h"
+#include "gfx.h"
+#include "palette.h"
+#include "utils.h"
+#include "arena.h"
 #include <libdragon.h>
 
+#define MENU_LINE_MAX 64 /* Longest menu line, in the frame arena */
+
 /* [2] Constant list of available resolutions. */
 static const resolution_entry_t resolution_list[] = {
     { "PAL 640x288p",     &PAL_640x288p },
@@ -63,6 +69,7 @@ static int menu_scroll = 0;
 static int repeat_up_counter = 0;
 static int repeat_down_counter = 0;
 static sprite_t* menu_logo = NULL;
+static video_depth_t menu_depth = VIDEO_DEPTH_AUTO; /* [3.1] Color depth option, kept between openings */
 
 /* [4] Menu control functions. */
 void menu_open(void) {
@@ -95,6 +102,22 @@ void menu_set_logo_sprite(sprite_t* logo) {
     menu_logo = logo;
 }
 
+void menu_set_depth(video_depth_t d) {
+    if (d >= 0 && d < VIDEO_DEPTH_COUNT) menu_depth = d;
+}
+
+video_depth_t menu_get_depth(void) {
+    return menu_depth;
+}
+
+int menu_get_resolution_count(void) {
+    return resolution_count;
+}
+
+const resolution_entry_t *menu_get_resolution(int index) {
+    return (index >= 0 && index < resolution_count) ? &resolution_list[index] : NULL;
+}
+
 /* [5] Main menu update and drawing function. */
 menu_status_t menu_update(surface_t *disp, joypad_buttons_t pressed,
                           joypad_buttons_t held, const resolution_t **out_selected) {
@@ -118,7 +141,7 @@ menu_status_t menu_update(surface_t *disp, joypad_buttons_t pressed,
     int title_h = MENU_TITLE_H;
     int hint_h = MENU_HINT_H;
     int line_h = MENU_LINE_H;
-    int avail_h = box_h - pad_y*2 - title_h - hint_h;
+    int avail_h = box_h - pad_y*2 - title_h - line_h*2 - hint_h; /* depth and render lines */
     if (avail_h < line_h) avail_h = line_h;
     int visible_lines = avail_h / line_h;
     if (pressed.d_up) {
@@ -141,6 +164,12 @@ menu_status_t menu_update(surface_t *disp, joypad_buttons_t pressed,
             }
         } else repeat_down_counter = 0;
     }
+    /* [5.1] D-LEFT/RIGHT: color depth (Auto / 16 / 32 bpp) */
+    if (pressed.d_left) menu_depth = (video_depth_t)((menu_depth + VIDEO_DEPTH_COUNT - 1) % VIDEO_DEPTH_COUNT);
+    if (pressed.d_right) menu_depth = (video_depth_t)((menu_depth + 1) % VIDEO_DEPTH_COUNT);
+    /* [5.1.1] C-LEFT/RIGHT: internal render size (Full / Field / Low), scaled up by the VI */
+    if (pressed.c_left) video_set_scale((video_scale_t)((video_get_scale() + VIDEO_SCALE_COUNT - 1) % VIDEO_SCALE_COUNT));
+    if (pressed.c_right) video_set_scale((video_scale_t)((video_get_scale() + 1) % VIDEO_SCALE_COUNT));
     if (menu_selected < 0) menu_selected = resolution_count - 1;
     if (menu_selected >= resolution_count) menu_selected = 0;
     if (menu_selected < menu_scroll) menu_scroll = menu_selected;
@@ -155,47 +184,73 @@ menu_status_t menu_update(surface_t *disp, joypad_buttons_t pressed,
         if (out_selected) *out_selected = NULL;
         return MENU_STATUS_CANCEL;
     }
-    uint32_t col_frame = graphics_make_color(0,200,0,255);
-    uint32_t col_box_bg = graphics_make_color(24,24,24,200);
-    uint32_t col_text = graphics_make_color(255,255,255,255);
-    uint32_t col_text_dim = graphics_make_color(180,180,180,255);
-    uint32_t col_highlight = graphics_make_color(200,200,0,255);
-    graphics_draw_box(disp, box_x, box_y, box_w, box_h, col_box_bg);
-    graphics_draw_line(disp, box_x - 2, box_y - 2, box_x + box_w + 1, box_y - 2, col_frame);
-    graphics_draw_line(disp, box_x - 2, box_y + box_h + 1, box_x + box_w + 1, box_y + box_h + 1, col_frame);
-    graphics_draw_line(disp, box_x - 2, box_y - 2, box_x - 2, box_y + box_h + 1, col_frame);
-    graphics_draw_line(disp, box_x + box_w + 1, box_y - 2, box_x + box_w + 1, box_y + box_h + 1, col_frame);
+    uint32_t col_frame = color_get(COL_FRAME);
+    uint32_t col_box_bg = color_get(COL_MENU_BG);
+    uint32_t col_text = color_get(COL_MENU_TEXT);
+    uint32_t col_text_dim = color_get(COL_MENU_DIM);
+    uint32_t col_highlight = color_get(COL_MENU_HIGHLIGHT);
+    gfx_flush(); /* The menu box covers the main screen text */
+    gfx_fill_rect(box_x, box_y, box_w, box_h, col_box_bg);
+    gfx_frame_rect(box_x - 2, box_y - 2, box_w + 4, box_h + 4, col_frame);
     // Draw logo sprite in menu if available, before any text
     if (menu_logo) {
         int logo_x = box_x + box_w - menu_logo->width - 8;
         int logo_y = box_y + 8;
-        graphics_draw_sprite(disp, logo_x, logo_y, menu_logo);
+        gfx_sprite(logo_x, logo_y, menu_logo);
+    }
+    gfx_set_text_color(col_text);
+    gfx_text(box_x + pad_x, box_y + pad_y, "Select resolution:");
+    /* [5.2] Depth option with the depth it gives for the highlighted resolution and its
+       framebuffer memory, e.g. "Depth: Auto (16 bpp, 1244K)" */
+    {
+        const resolution_t *r = resolution_list[menu_selected].res;
+        int bpp = video_pick_bpp(r, menu_depth);
+        char *line = (char *)arena_alloc(ARENA_FRAME, MENU_LINE_MAX); /* Scratch of this frame */
+        if (line) {
+            int pos = safe_append_str(line, MENU_LINE_MAX, 0, "Depth: ");
+            pos = safe_append_str(line, MENU_LINE_MAX, pos, video_depth_name(menu_depth));
+            pos = safe_append_str(line, MENU_LINE_MAX, pos, " (");
+            pos += int_to_dec(line + pos, bpp);
+            pos = safe_append_str(line, MENU_LINE_MAX, pos, " bpp, ");
+            pos += int_to_dec(line + pos, (int)(video_fb_bytes(r, bpp) / 1024));
+            safe_append_str(line, MENU_LINE_MAX, pos, "K)");
+            gfx_text(box_x + pad_x, box_y + pad_y + title_h, line);
+            /* [5.3] Render size the highlighted mode gets, e.g. "Render: Field 640x288" */
+            resolution_t rr = video_render_res(r);
+            pos = safe_append_str(line, MENU_LINE_MAX, 0, "Render: ");
+            pos = safe_append_str(line, MENU_LINE_MAX, pos, video_scale_name(video_get_scale()));
+            line[pos++] = ' ';
+            pos += int_to_dec(line + pos, (int)rr.width);
+            line[pos++] = 'x';
+            pos += int_to_dec(line + pos, (int)rr.height);
+            gfx_text(box_x + pad_x, box_y + pad_y + title_h + line_h, line);
+        }
     }
-    graphics_set_color(col_text, 0);
-    graphics_draw_text(disp, box_x + pad_x, box_y + pad_y, "Select resolution:");
-    int y = box_y + pad_y + title_h;
+    int y = box_y + pad_y + title_h + line_h * 2;
     for (int i = 0; i < visible_lines; ++i) {
         int idx = menu_scroll + i;
         if (idx >= resolution_count) break;
         if (idx == menu_selected) {
-            graphics_draw_box(disp, box_x + pad_x - 2, y - 2,
-                              box_w - pad_x*2 + 4, line_h + 2, col_highlight);
-            graphics_set_color(col_box_bg, 0);
+            gfx_fill_rect(box_x + pad_x - 2, y - 2,
+                          box_w - pad_x*2 + 4, line_h + 2, col_highlight);
+            gfx_set_text_color(col_box_bg);
         } else {
-            graphics_set_color(col_text, 0);
+            gfx_set_text_color(col_text);
         }
-        char tmp[128];
+        char *tmp = (char *)arena_alloc(ARENA_FRAME, MENU_LINE_MAX);
+        if (!tmp) break;
         const char *name = resolution_list[idx].name;
         int max_chars = (box_w - pad_x * 2) / 8;
+        if (max_chars > MENU_LINE_MAX) max_chars = MENU_LINE_MAX;
         int j;
         for (j = 0; j < max_chars - 1 && name[j]; ++j) tmp[j] = name[j];
         tmp[j] = '\0';
-        graphics_draw_text(disp, box_x + pad_x, y, tmp);
+        gfx_text(box_x + pad_x, y, tmp);
         y += line_h;
     }
-    graphics_set_color(col_text_dim, 0);
-    graphics_draw_text(disp, box_x + pad_x, box_y + box_h - hint_h + 2,
-                       "A = OK  ENTER/B = Cancel  D-UP/DOWN");
+    gfx_set_text_color(col_text_dim);
+    gfx_text(box_x + pad_x, box_y + box_h - hint_h + 2,
+             "A = OK  B = Cancel  D-L/R Depth  C-L/R Size");
     if (out_selected) *out_selected = NULL;
     return MENU_STATUS_OPEN;
 }
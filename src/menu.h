@@ -4,6 +4,7 @@
 #include <libdragon.h>
 #include <stdbool.h>
 #include "resolutions.h"
+#include "video.h"
 
 /* [1] MENU CONFIGURATION - Dimensions, padding, repeat timings */
 #define MENU_BOX_W_DEFAULT   460
@@ -34,6 +35,10 @@ void menu_close(void);
 bool menu_is_open(void);
 void menu_set_initial_resolution(const resolution_t *r);
 void menu_set_logo_sprite(sprite_t* logo);
+void menu_set_depth(video_depth_t depth);   /* Color depth option (D-LEFT/RIGHT) */
+video_depth_t menu_get_depth(void);
+int menu_get_resolution_count(void);        /* Entries of the resolution list */
+const resolution_entry_t *menu_get_resolution(int index); /* NULL when out of range */
 menu_status_t menu_update(surface_t *disp, joypad_buttons_t pressed,
                           joypad_buttons_t held, const resolution_t **out_selected);
 
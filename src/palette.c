@@ -0,0 +1,44 @@
+/* [1] palette.c - UI colors in both framebuffer depths */
+#include "palette.h"
+#include "video.h" /* [2] Current depth */
+
+/* [3] One table per depth, same order as color_id_t */
+#define PALETTE(X) \
+    X(0, 0, 64, 255)      /* COL_BG */ \
+    X(255, 255, 255, 255) /* COL_WHITE */ \
+    X(0, 255, 0, 255)     /* COL_GREEN */ \
+    X(0, 200, 0, 255)     /* COL_FRAME */ \
+    X(0, 200, 0, 255)     /* COL_BOX_BG */ \
+    X(0, 0, 0, 255)       /* COL_BLACK */ \
+    X(255, 255, 0, 255)   /* COL_DEBUG */ \
+    X(255, 0, 0, 255)     /* COL_ERROR */ \
+    X(24, 24, 24, 200)    /* COL_MENU_BG */ \
+    X(255, 255, 255, 255) /* COL_MENU_TEXT */ \
+    X(180, 180, 180, 255) /* COL_MENU_DIM */ \
+    X(200, 200, 0, 255)   /* COL_MENU_HIGHLIGHT */ \
+    X(48, 48, 48, 255)    /* COL_PROF_TRACK */ \
+    X(80, 160, 255, 255)  /* COL_ZONE_0 input */ \
+    X(0, 220, 120, 255)   /* COL_ZONE_1 audio */ \
+    X(0, 140, 60, 255)    /* COL_ZONE_2 stream */ \
+    X(255, 200, 0, 255)   /* COL_ZONE_3 widgets */ \
+    X(255, 120, 0, 255)   /* COL_ZONE_4 hud */ \
+    X(255, 255, 120, 255) /* COL_ZONE_5 debug */ \
+    X(220, 40, 40, 255)   /* COL_ZONE_6 draw */ \
+    X(255, 80, 200, 255)  /* COL_ZONE_7 text */ \
+    X(160, 80, 255, 255)  /* COL_ZONE_8 show */
+
+#define AS_RGBA32(r, g, b, a) PACK_RGBA32(r, g, b, a),
+#define AS_RGBA5551(r, g, b, a) PACK_RGBA5551(r, g, b, a),
+
+static const uint32_t palette32[COL_COUNT] = { PALETTE(AS_RGBA32) };
+static const uint16_t palette16[COL_COUNT] = { PALETTE(AS_RGBA5551) };
+
+uint32_t color_get(color_id_t id) {
+    if (id < 0 || id >= COL_COUNT) return 0;
+    if (video_get_bpp() == 16) return ((uint32_t)palette16[id] << 16) | palette16[id];
+    return palette32[id];
+}
+
+color_t color_get_rgba(color_id_t id) {
+    return color_from_packed32((id >= 0 && id < COL_COUNT) ? palette32[id] : 0);
+}
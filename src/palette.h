@@ -0,0 +1,37 @@
+/* [1] palette.h - The few flat colors of the UI, kept as RGBA8888 and as RGBA5551, so a 16 bpp
+   framebuffer gets exact precomputed values instead of converting at every draw. color_get()
+   returns the packed value for the current framebuffer depth (what graphics_make_color gives). */
+#pragma once
+#include <libdragon.h>
+#include <stdint.h>
+
+/* [2] Color ids */
+typedef enum {
+    COL_BG = 0,       /* Main screen background */
+    COL_WHITE,        /* Text, bar and VU frame */
+    COL_GREEN,        /* Progress and VU fill */
+    COL_FRAME,        /* Message box frame */
+    COL_BOX_BG,       /* Message box */
+    COL_BLACK,        /* Message text */
+    COL_DEBUG,        /* Debug overlay text */
+    COL_ERROR,        /* Startup error text */
+    COL_MENU_BG,
+    COL_MENU_TEXT,
+    COL_MENU_DIM,
+    COL_MENU_HIGHLIGHT,
+    COL_PROF_TRACK,   /* Profiler bar background */
+    COL_ZONE_0,       /* Profiler zones, COL_ZONE_COUNT colors */
+    COL_ZONE_1, COL_ZONE_2, COL_ZONE_3, COL_ZONE_4, COL_ZONE_5, COL_ZONE_6, COL_ZONE_7, COL_ZONE_8,
+    COL_COUNT
+} color_id_t;
+
+#define COL_ZONE_COUNT 9
+
+/* [3] Packing helpers (compile-time constants) */
+#define PACK_RGBA32(r, g, b, a) (((uint32_t)(r) << 24) | ((uint32_t)(g) << 16) | ((uint32_t)(b) << 8) | (uint32_t)(a))
+#define PACK_RGBA5551(r, g, b, a) ((uint16_t)((((r) >> 3) << 11) | (((g) >> 3) << 6) | (((b) >> 3) << 1) | ((a) >> 7)))
+
+/* [4] Packed color for the current framebuffer depth (16 bpp: the 5551 value in both halves) */
+uint32_t color_get(color_id_t id);
+/* [5] The same color as color_t, for rdpq calls that take one */
+color_t color_get_rgba(color_id_t id);
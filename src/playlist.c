@@ -0,0 +1,294 @@
+/* [1] playlist.c - Track list from the build-time catalog (or a rom:/ scan as fallback).
+   Keeps the next track opened ahead of time, so a track switch is only a channel stop + play
+   on an already primed stream. */
+#include "playlist.h"
+#include "audio_engine.h" /* [2] audio_engine_lock/unlock */
+#include "utils.h"        /* [3] strcpy_s, tiny_strcmp, str_ends_with, fast_memcpy */
+#include "track_cache.h"  /* [3.1] RAM copies of recently played tracks */
+#include "mem.h"          /* [3.2] Memory of open tracks and the catalog */
+#include "arena.h"        /* [3.3] Seek index of each slot */
+#include <stdlib.h>
+
+/* [4] Playlist state */
+static playlist_entry_t entries[PLAYLIST_MAX_TRACKS];
+_Static_assert(CATALOG_MAX_ENTRIES == PLAYLIST_MAX_TRACKS, "mkcatalog must enforce the playlist limit");
+static int track_count = 0;
+static int track_index = 0;
+static bool from_catalog = false;
+static uint32_t load_us = 0;
+
+/* [5] Two track slots: the playing one and the prefetched one */
+static playlist_track_t slots[2];
+static playlist_track_t *current = &slots[0];
+static playlist_track_t *prefetched = &slots[1];
+static uint32_t last_switch_us = 0;
+static uint32_t preload_budget = 0;   /* [5.1] 0 = always stream */
+static bool preload_prefix = false;
+
+/* [6] Get the header bytes and enable the track's codec before wav64_open.
+   With a catalog the bytes are already in memory; otherwise the file is opened once more. */
+static bool playlist_probe(playlist_track_t *t, const playlist_entry_t *e) {
+    if (e->has_info) {
+        fast_memcpy(t->header, e->header, sizeof(t->header));
+        t->header_len = PLAYLIST_HEADER_BYTES;
+    } else {
+        FILE *f = asset_fopen(e->path, NULL);
+        if (!f) return false;
+        t->header_len = (int)fread(t->header, 1, sizeof(t->header), f);
+        fclose(f);
+    }
+    if (t->header_len < 6) return false;
+    t->format = t->header[5];
+    if (t->format != 0 && t->format != 1 && t->format != 3) t->format = 0;
+    wav64_init_compression(t->format);
+    return true;
+}
+
+/* [6.1] Give the track its cached RAM copy. With `alloc` a missing copy is created (and then
+   filled by stream_preload_step); without it only an existing copy is used. */
+static void playlist_attach_cache(playlist_track_t *t, bool alloc) {
+    stream_t *s = &t->stream;
+    if (s->preload || preload_budget == 0 || s->format == 3) return; /* Opus is read by libdragon */
+    uint32_t size = stream_data_bytes(s);
+    if (size > preload_budget) {
+        if (!preload_prefix) return; /* Does not fit: stream */
+        size = preload_budget;
+    }
+    uint32_t valid = 0;
+    uint8_t *mem = track_cache_acquire(t->index, size, alloc, &valid);
+    if (mem && !stream_preload_attach(s, mem, size, valid))
+        track_cache_release(t->index, valid);
+}
+
+/* [7] Open a track into a slot and prime its stream at sample 0. With a catalog entry the file
+   is opened twice: libdragon's handle and the stream's own handle (header info comes from the
+   catalog). */
+static bool playlist_track_open_slot(playlist_track_t *t, int index) {
+    const playlist_entry_t *e = &entries[index];
+    const char *path = e->path;
+    arena_id_t arena = (arena_id_t)(ARENA_TRACK_A + (t - slots)); /* Slot 0 or 1 */
+    t->index = -1;
+    t->preload_checked = false;
+    arena_reset(arena);
+    if (!playlist_probe(t, e)) return false;
+    fast_memset(&t->wav, 0, sizeof(t->wav));
+    wav64_open(&t->wav, path);
+    if (!stream_open(&t->stream, &t->wav, path, e->has_info ? &e->info : NULL, arena)) {
+        wav64_close(&t->wav);
+        return false;
+    }
+    t->index = index;
+    playlist_attach_cache(t, false); /* [7.1] Cached tracks play from RAM from the first sample */
+    return true;
+}
+
+/* [7.2] wav64_open, the decoder and file buffers allocate inside: measured (the seek index is
+   in the slot arena, counted there) */
+static bool playlist_track_open(playlist_track_t *t, int index) {
+    mem_scope_t m = mem_scope_begin();
+    bool ok = playlist_track_open_slot(t, index);
+    mem_scope_end(MEM_AUDIO, m);
+    return ok;
+}
+
+/* [8] Close a slot. Its RAM copy stays in the cache. */
+static void playlist_track_close(playlist_track_t *t) {
+    if (t->index < 0) return;
+    if (t->stream.preload) track_cache_release(t->index, t->stream.preload_bytes);
+    mem_scope_t m = mem_scope_begin();
+    stream_close(&t->stream);
+    wav64_close(&t->wav);
+    mem_scope_end(MEM_AUDIO, m);
+    arena_reset((arena_id_t)(ARENA_TRACK_A + (t - slots))); /* [8.1] Drops the seek index */
+    t->index = -1;
+}
+
+/* [9] Sort entries by path (insertion sort, the list is small) */
+static void playlist_sort(void) {
+    playlist_entry_t tmp;
+    for (int i = 1; i < track_count; i++) {
+        tmp = entries[i];
+        int j = i - 1;
+        while (j >= 0 && tiny_strcmp(entries[j].path, tmp.path) > 0) {
+            entries[j + 1] = entries[j];
+            j--;
+        }
+        entries[j + 1] = tmp;
+    }
+}
+
+/* [9.1] Big-endian readers for the catalog */
+static uint32_t rd_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint16_t rd_be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/* [9.2] Load rom:/tracks.cat (written by tools/mkcatalog) with a single read */
+static bool playlist_load_catalog(void) {
+    int size = 0;
+    FILE *f = asset_fopen("rom:/" CATALOG_FILE_NAME, &size);
+    if (!f) return false;
+    uint8_t *buf = (size >= CATALOG_HEADER_SIZE) ? (uint8_t *)malloc((size_t)size) : NULL;
+    if (buf) mem_account(MEM_ASSETS, size);
+    bool ok = buf && (int)fread(buf, 1, (size_t)size, f) == size;
+    fclose(f);
+    if (ok) ok = buf[0] == 'M' && buf[1] == 'C' && buf[2] == 'A' && buf[3] == 'T' && buf[4] == CATALOG_VERSION;
+    int count = ok ? rd_be16(&buf[6]) : 0;
+    int entry_size = ok ? rd_be16(&buf[8]) : 0;
+    if (entry_size < CATALOG_ENTRY_SIZE || CATALOG_HEADER_SIZE + count * entry_size > size) count = 0;
+    if (count > PLAYLIST_MAX_TRACKS) count = PLAYLIST_MAX_TRACKS; /* Only a foreign catalog: mkcatalog refuses more */
+
+    for (int i = 0; i < count; i++) {
+        const uint8_t *e = &buf[CATALOG_HEADER_SIZE + i * entry_size];
+        playlist_entry_t *t = &entries[track_count];
+        char name[CATALOG_NAME_LEN];
+        fast_memcpy(name, &e[CATALOG_OFS_NAME], CATALOG_NAME_LEN);
+        name[CATALOG_NAME_LEN - 1] = '\0';
+        strcpy_s(t->path, PLAYLIST_PATH_LEN, "rom:/");
+        safe_append_str(t->path, PLAYLIST_PATH_LEN, -1, name);
+        t->has_info = true;
+        t->info.format = e[CATALOG_OFS_FORMAT];
+        t->info.channels = e[CATALOG_OFS_CHANNELS];
+        t->info.bits = e[CATALOG_OFS_BITS];
+        t->info.freq = rd_be32(&e[CATALOG_OFS_FREQ]);
+        t->info.len = rd_be32(&e[CATALOG_OFS_LEN]);
+        t->info.loop_start = rd_be32(&e[CATALOG_OFS_LOOP_START]);
+        t->info.loop_end = rd_be32(&e[CATALOG_OFS_LOOP_END]);
+        t->info.bitrate = rd_be32(&e[CATALOG_OFS_BITRATE]);
+        t->info.file_size = rd_be32(&e[CATALOG_OFS_FILE_SIZE]);
+        t->info.data_offset = rd_be32(&e[CATALOG_OFS_DATA_OFFSET]);
+        fast_memcpy(t->header, &e[CATALOG_OFS_HEADER], PLAYLIST_HEADER_BYTES);
+        track_count++;
+    }
+    if (buf) mem_account(MEM_ASSETS, -size);
+    free(buf);
+    return track_count > 0;
+}
+
+/* [9.3] Fallback: scan rom:/ (DFS root) for .wav64 files. Only the paths are known. */
+static void playlist_scan_dir(void) {
+    char name[256];
+    int ret = dfs_dir_findfirst("/", name);
+    while (ret != FLAGS_EOF && track_count < PLAYLIST_MAX_TRACKS) {
+        if (ret == FLAGS_FILE && str_ends_with(name, ".wav64")) {
+            playlist_entry_t *t = &entries[track_count];
+            fast_memset(t, 0, sizeof(*t));
+            strcpy_s(t->path, PLAYLIST_PATH_LEN, "rom:/");
+            safe_append_str(t->path, PLAYLIST_PATH_LEN, -1, name);
+            track_count++;
+        }
+        ret = dfs_dir_findnext(name);
+    }
+    playlist_sort();
+}
+
+/* [10] Build the track list and open the first track */
+int playlist_init(void) {
+    uint32_t t0 = timer_ticks();
+    slots[0].index = slots[1].index = -1;
+    track_count = 0;
+    from_catalog = playlist_load_catalog();
+    if (!from_catalog) {
+        track_count = 0;
+        playlist_scan_dir();
+    }
+    load_us = (uint32_t)TICKS_TO_US(timer_ticks() - t0);
+    track_index = 0;
+    if (track_count > 0) playlist_track_open(current, 0);
+    return track_count;
+}
+
+bool playlist_from_catalog(void) { return from_catalog; }
+uint32_t playlist_load_us(void) { return load_us; }
+
+/* [11] Playlist info */
+int playlist_count(void) { return track_count; }
+int playlist_index(void) { return track_index; }
+
+const char *playlist_path(int index) {
+    if (index < 0 || index >= track_count) return "";
+    return entries[index].path;
+}
+
+const playlist_entry_t *playlist_entry(int index) {
+    if (index < 0 || index >= track_count) return NULL;
+    return &entries[index];
+}
+
+playlist_track_t *playlist_current(void) {
+    return current;
+}
+
+/* [12] Keep the next track open and primed. Opening a stream takes the header from the
+   catalog (VADPCM reads its codebook), allocates the seek index and positions the reader at the
+   first sample. */
+void playlist_prefetch_step(void) {
+    if (track_count < 2) return;
+    int next = (track_index + 1) % track_count;
+    if (prefetched->index == next) return;
+    if (prefetched->index >= 0 && prefetched->stream.running) return; /* Still fading out */
+    playlist_track_close(prefetched);
+    playlist_track_open(prefetched, next);
+}
+
+/* [13] Make the next/previous track current without touching any mixer channel.
+   The old track stays open (and may keep playing) in the other slot. */
+playlist_track_t *playlist_advance(int dir) {
+    if (track_count == 0) return current;
+    uint32_t t0 = timer_ticks();
+    int target = (track_index + (dir < 0 ? track_count - 1 : 1)) % track_count;
+    if (prefetched->index != target) {
+        /* [13.1] Prefetch miss (e.g. going back): open synchronously */
+        playlist_track_close(prefetched);
+        if (!playlist_track_open(prefetched, target)) return current;
+    }
+    playlist_track_t *old = current;
+    current = prefetched;
+    prefetched = old;
+    track_index = target;
+    last_switch_us = (uint32_t)TICKS_TO_US(timer_ticks() - t0);
+    /* [13.2] The old slot is closed lazily by the next playlist_prefetch_step() */
+    return current;
+}
+
+/* [13.3] Switch tracks on one channel. With a prefetch hit this is a pointer swap plus a stop/play. */
+playlist_track_t *playlist_switch(int dir, int ch) {
+    uint32_t t0 = timer_ticks();
+    playlist_track_t *old = current;
+    if (playlist_advance(dir) == old) return current;
+    stream_stop(&old->stream, ch);
+    stream_play(&current->stream, ch);
+    last_switch_us = (uint32_t)TICKS_TO_US(timer_ticks() - t0);
+    return current;
+}
+
+/* [14] Close both slots */
+void playlist_close(void) {
+    playlist_track_close(&slots[0]);
+    playlist_track_close(&slots[1]);
+}
+
+/* [15] RAM preload policy */
+void playlist_set_preload(uint32_t budget_bytes, bool allow_prefix) {
+    preload_budget = budget_bytes;
+    preload_prefix = allow_prefix;
+}
+
+uint32_t playlist_preload_budget(void) { return preload_budget; }
+
+/* [15.1] Only the current track is loaded into RAM; other tracks only reuse cached copies */
+void playlist_preload_step(void) {
+    if (current->index < 0) return;
+    if (!current->preload_checked) {
+        current->preload_checked = true;
+        playlist_attach_cache(current, true);
+    }
+    stream_preload_step(&current->stream);
+}
+
+uint32_t playlist_last_switch_us(void) {
+    return last_switch_us;
+}
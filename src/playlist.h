@@ -0,0 +1,79 @@
+/* [1] playlist.h - Playlist of every .wav64 in the ROM filesystem, with the next track prefetched. */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <libdragon.h>
+#include "stream.h"
+#include "catalog.h"
+
+/* [2] Playlist configuration */
+#define PLAYLIST_MAX_TRACKS 64   /* Maximum number of tracks in rom:/ */
+#define PLAYLIST_PATH_LEN 64     /* Maximum path length, including "rom:/" */
+#define PLAYLIST_HEADER_BYTES CATALOG_HEADER_BYTES /* Header bytes kept for the debug overlay */
+
+/* [2.1] What the playlist knows about a track without opening it.
+   Filled from rom:/tracks.cat; after a directory scan (no catalog) only `path` is valid. */
+typedef struct {
+    char path[PLAYLIST_PATH_LEN];
+    bool has_info;          /* Metadata below came from the catalog */
+    stream_info_t info;     /* Header fields, file size, loop region, bitrate: stream_open uses them */
+    uint8_t header[PLAYLIST_HEADER_BYTES];
+} playlist_entry_t;
+
+/* [3] An open track: libdragon handle, our stream over it and header info.
+   Tracks live in fixed slots because the stream's waveform points back into the struct. */
+typedef struct {
+    int index;                               /* Playlist index, -1 when the slot is empty */
+    uint8_t format;                          /* 0 = PCM, 1 = VADPCM, 3 = Opus */
+    uint8_t header[PLAYLIST_HEADER_BYTES];   /* First bytes of the file */
+    int header_len;                          /* Valid bytes in header */
+    bool preload_checked;                    /* RAM preload was considered for this track */
+    wav64_t wav;
+    stream_t stream;
+} playlist_track_t;
+
+/* [4] Load the track list from rom:/tracks.cat with a single read, or scan rom:/ for .wav64
+   files when the catalog is missing. Opens the first track. Returns the track count. */
+int playlist_init(void);
+
+/* [4.1] True when the track list came from the build-time catalog */
+bool playlist_from_catalog(void);
+
+/* [4.2] Time playlist_init() spent building the list (catalog read or directory scan), in us */
+uint32_t playlist_load_us(void);
+
+/* [5] Playlist info */
+int playlist_count(void);
+int playlist_index(void);
+const char *playlist_path(int index);
+const playlist_entry_t *playlist_entry(int index); /* NULL when out of range */
+
+/* [6] Currently selected track (always open after playlist_init when count > 0) */
+playlist_track_t *playlist_current(void);
+
+/* [7] Open and prime the next track in the background slot. Call once per frame; cheap once done. */
+void playlist_prefetch_step(void);
+
+/* [7.1] Make the next (dir = +1) or previous (dir = -1) track current without starting or
+   stopping anything. The previous track stays open in the other slot until it stops playing. */
+playlist_track_t *playlist_advance(int dir);
+
+/* [8] Switch to the next (dir = +1) or previous (dir = -1) track, stopping the old one on `ch`
+   and starting the new one. Uses the prefetched slot when it matches. Returns the new track. */
+playlist_track_t *playlist_switch(int dir, int ch);
+
+/* [8.1] Close all open tracks */
+void playlist_close(void);
+
+/* [8.2] RAM preload of the current track, through the track cache (track_cache_init sets the
+   total budget). budget_bytes is the limit per track; 0 disables preloading (always stream
+   from the cartridge). A track larger than the limit gets a prefix when allow_prefix is set,
+   and streams otherwise. */
+void playlist_set_preload(uint32_t budget_bytes, bool allow_prefix);
+uint32_t playlist_preload_budget(void);
+
+/* [8.3] Advance the current track's preload. Call once per frame. */
+void playlist_preload_step(void);
+
+/* [9] Duration of the last track switch in microseconds */
+uint32_t playlist_last_switch_us(void);
@@ -0,0 +1,134 @@
+/* [1] prof.c - Frame profiler (see prof.h) */
+#include "prof.h"
+#if PROF_ENABLED
+#include <libdragon.h>
+#include "ui.h"           /* [2] The bar is made of widgets */
+#include "palette.h"      /* [3] Zone colors */
+#include "audio_engine.h" /* [4] Mix time of the frame */
+#include "utils.h"
+#include "clock.h"        /* [4.1] VI period */
+#include "arena.h"        /* [4.2] Label scratch */
+
+#define PROF_LINE_MAX 64
+
+bool prof_on = false;
+
+/* [5] Open zones */
+static struct {
+    prof_zone_t zone;
+    uint32_t t0;
+    uint32_t children;   /* Ticks of the zones closed inside it */
+} stack[PROF_MAX_DEPTH];
+static int depth = 0;
+
+static uint32_t cur[PROF_ZONE_COUNT];                 /* Own ticks of the open frame */
+static uint32_t ring[PROF_HISTORY][PROF_ZONE_COUNT];  /* Own ticks of the last frames */
+static uint32_t ring_mix[PROF_HISTORY];
+static uint32_t ring_frame[PROF_HISTORY];             /* Frame start to frame start */
+static int ring_pos = 0, ring_count = 0;
+static uint32_t frame_start = 0;
+static uint64_t mix_ticks0 = 0;
+
+static const char *const zone_names[PROF_ZONE_COUNT] = {
+    "input", "audio", "stream", "widgets", "hud", "debug", "draw", "text", "show"
+};
+
+const char *prof_zone_name(prof_zone_t z) {
+    return (z >= 0 && z < PROF_ZONE_COUNT) ? zone_names[z] : "?";
+}
+
+void prof_begin(prof_zone_t z) {
+    if (depth >= PROF_MAX_DEPTH) { depth++; return; } /* Too deep: counted, not timed */
+    stack[depth].zone = z;
+    stack[depth].children = 0;
+    stack[depth].t0 = TICKS_READ();
+    depth++;
+}
+
+void prof_end(prof_zone_t z) {
+    uint32_t now = TICKS_READ();
+    if (depth <= 0) return;
+    if (--depth >= PROF_MAX_DEPTH) return;
+    if (stack[depth].zone != z) { depth = 0; return; } /* Unbalanced pair: drop the open zones */
+    uint32_t total = now - stack[depth].t0;
+    cur[z] += total - stack[depth].children;
+    if (depth > 0) stack[depth - 1].children += total;
+}
+
+void prof_frame_end(void) {
+    if (!prof_on) return;
+    uint32_t now = TICKS_READ();
+    uint64_t mix;
+    audio_engine_get_mix_cost(&mix, NULL, NULL);
+    for (int i = 0; i < PROF_ZONE_COUNT; i++) {
+        ring[ring_pos][i] = cur[i];
+        cur[i] = 0;
+    }
+    ring_mix[ring_pos] = (uint32_t)(mix - mix_ticks0);
+    ring_frame[ring_pos] = frame_start ? now - frame_start : 0;
+    mix_ticks0 = mix;
+    frame_start = now;
+    ring_pos = (ring_pos + 1) % PROF_HISTORY;
+    if (ring_count < PROF_HISTORY) ring_count++;
+}
+
+/* [6] Switching on starts a clean history */
+void prof_set_enabled(bool on) {
+    if (on && !prof_on) {
+        for (int i = 0; i < PROF_ZONE_COUNT; i++) cur[i] = 0;
+        ring_pos = ring_count = 0;
+        depth = 0;
+        frame_start = 0;
+        audio_engine_get_mix_cost(&mix_ticks0, NULL, NULL);
+    }
+    prof_on = on;
+    if (!on) ui_hide_range(UI_ID_PROF, UI_ID_PROF_END);
+}
+
+bool prof_get_enabled(void) { return prof_on; }
+
+/* [7] Widgets: track (= budget), one segment per zone, the mix bar and a label with the frame
+   total and the largest zone. Averages of the ring, in microseconds. */
+void prof_draw(int x, int y, int w) {
+    if (!prof_on || ring_count == 0) return;
+    uint32_t zone_us[PROF_ZONE_COUNT], mix_us = 0, frame_us = 0, work_us = 0;
+    for (int i = 0; i < PROF_ZONE_COUNT; i++) {
+        uint64_t sum = 0;
+        for (int k = 0; k < ring_count; k++) sum += ring[k][i];
+        zone_us[i] = (uint32_t)TICKS_TO_US(sum / (uint32_t)ring_count);
+        work_us += zone_us[i];
+    }
+    uint64_t msum = 0, fsum = 0;
+    for (int k = 0; k < ring_count; k++) { msum += ring_mix[k]; fsum += ring_frame[k]; }
+    mix_us = (uint32_t)TICKS_TO_US(msum / (uint32_t)ring_count);
+    frame_us = (uint32_t)TICKS_TO_US(fsum / (uint32_t)ring_count);
+    uint32_t budget_us = clock_vi_us();
+
+    const int h = 8;
+    ui_hbar(UI_ID_PROF, x, y, w, h, 0, 1, color_get(COL_PROF_TRACK), 0);
+    int px = x, top = 0;
+    for (int i = 0; i < PROF_ZONE_COUNT; i++) {
+        int sw = (int)((uint64_t)zone_us[i] * (uint32_t)w / budget_us);
+        if (px + sw > x + w) sw = x + w - px;
+        if (sw > 0) ui_hbar(UI_ID_PROF + 1 + i, px, y + 1, sw, h - 2, 1, 1, 0, color_get((color_id_t)(COL_ZONE_0 + i % COL_ZONE_COUNT)));
+        else ui_hide(UI_ID_PROF + 1 + i);
+        px += (sw > 0) ? sw : 0;
+        if (zone_us[i] > zone_us[top]) top = i;
+    }
+    ui_hbar(UI_ID_PROF + 1 + PROF_ZONE_COUNT, x, y + h + 1, w, 2, mix_us, budget_us, color_get(COL_PROF_TRACK), color_get(COL_WHITE));
+
+    char *line = (char *)arena_alloc(ARENA_FRAME, PROF_LINE_MAX);
+    if (!line) return;
+    int pos = safe_append_str(line, PROF_LINE_MAX, 0, "Prof ");
+    pos += format_float_two_decimals(&line[pos], (float)work_us / 1000.0f);
+    line[pos++] = '/';
+    pos += format_float_two_decimals(&line[pos], (float)frame_us / 1000.0f);
+    pos = safe_append_str(line, PROF_LINE_MAX, pos, " ms, top ");
+    pos = safe_append_str(line, PROF_LINE_MAX, pos, zone_names[top]);
+    line[pos++] = ' ';
+    pos += format_float_two_decimals(&line[pos], (float)zone_us[top] / 1000.0f);
+    pos = safe_append_str(line, PROF_LINE_MAX, pos, ", mix ");
+    pos += format_float_two_decimals(&line[pos], (float)mix_us / 1000.0f);
+    ui_text(UI_ID_PROF + 2 + PROF_ZONE_COUNT, x, y + h + 5, color_get(COL_WHITE), line);
+}
+#endif
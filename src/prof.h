@@ -0,0 +1,52 @@
+/* [1] prof.h - Frame profiler. Zones are begin/end pairs on the CPU tick counter and may nest
+   (a zone's own time excludes the zones inside it). Each frame's own times go into a ring of the
+   last PROF_HISTORY frames, and prof_draw() shows their average as a stacked bar against the
+   VI frame budget (20 ms PAL, 16.7 ms NTSC), the audio mix time in a thin bar below it.
+   PROF_ENABLED = 0 compiles every zone away; when compiled in but switched off a zone costs
+   one flag test. */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef PROF_ENABLED
+#define PROF_ENABLED 1
+#endif
+
+#define PROF_HISTORY 32      /* [2] Frames averaged by the bar */
+#define PROF_MAX_DEPTH 8     /* Nesting depth */
+
+/* [3] Zones, in bar order */
+typedef enum {
+    PROF_INPUT = 0,    /* Joypad */
+    PROF_AUDIO,        /* Audio pump and peak scan */
+    PROF_STREAM,       /* Seek index, prefetch, preload, transitions */
+    PROF_WIDGETS,      /* Main screen and VU widget updates */
+    PROF_HUD,          /* hud_draw_message */
+    PROF_DEBUG,        /* debug_info */
+    PROF_DRAW,         /* ui_frame_begin: restores and widget drawing */
+    PROF_TEXT,         /* Batched text flush (inside DRAW or SHOW) */
+    PROF_SHOW,         /* gfx_end: detach and show */
+    PROF_ZONE_COUNT
+} prof_zone_t;
+
+#if PROF_ENABLED
+extern bool prof_on;
+#define PROF_BEGIN(z) do { if (prof_on) prof_begin(z); } while (0)
+#define PROF_END(z) do { if (prof_on) prof_end(z); } while (0)
+void prof_begin(prof_zone_t zone);
+void prof_end(prof_zone_t zone);
+/* [4] Close the frame: its zone times go into the ring */
+void prof_frame_end(void);
+void prof_set_enabled(bool on);
+bool prof_get_enabled(void);
+/* [5] Bar and label as UI widgets UI_ID_PROF.. (hidden while off), `w` pixels = one VI frame */
+void prof_draw(int x, int y, int w);
+const char *prof_zone_name(prof_zone_t zone);
+#else
+#define PROF_BEGIN(z) ((void)0)
+#define PROF_END(z) ((void)0)
+static inline void prof_frame_end(void) {}
+static inline void prof_set_enabled(bool on) { (void)on; }
+static inline bool prof_get_enabled(void) { return false; }
+static inline void prof_draw(int x, int y, int w) { (void)x; (void)y; (void)w; }
+#endif
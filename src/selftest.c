@@ -0,0 +1,166 @@
+/* [1] selftest.c - Self-test ROM (make selftest): the player's modules without its UI. Every track
+   of the playlist is opened on a scratch stream with its seek index built in full, then:
+   - A-B loop wraps are checked bit-exact for several regions (frame-aligned or not, A = 0, B at the
+     end of the track) in every format;
+   - PCM and VADPCM are decoded by the stream (VADPCM by its own CPU decoder) and compared with
+     libdragon's reader through its public read callback: the whole track sequentially, then
+     windows reached by exact seeks from the index checkpoints. Opus is decoded by libdragon in
+     the stream too, and its restarts pre-roll instead of restoring state, so it only gets the
+     loop check.
+   The first mismatch stops the ROM with an assert naming the track, the check and the sample. */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libdragon.h>
+#include "arena.h"
+#include "audio_engine.h"
+#include "evlog.h"
+#include "playlist.h"
+#include "stream.h"
+
+#ifdef NDEBUG
+#error "selftest.c reports failures through assertf: build it without NDEBUG"
+#endif
+
+#define SELFTEST_CHUNK 1024    /* [2] Samples per compared block (a multiple of the VADPCM frame) */
+#define SELFTEST_WINDOW 512    /* Samples compared after each seek */
+#define SELFTEST_SEEKS 8       /* Seek targets per track */
+#define SELFTEST_ARENA ARENA_TRACK_B /* Seek index of the scratch stream (the playlist only fills slot 0) */
+
+/* [3] Scratch handles: the reference reader and the stream under test each have their own */
+static wav64_t ref_wav, test_wav;
+static stream_t test;
+
+/* [4] First differing sample of two interleaved blocks, -1 when they are equal */
+static int first_diff(const int16_t *a, const int16_t *b, int samples, int channels) {
+    for (int i = 0; i < samples * channels; i++)
+        if (a[i] != b[i]) return i / channels;
+    return -1;
+}
+
+/* [5] Seek target k: spread over the track, inside one chunk with a whole window after it, and
+   off the VADPCM frame grid for odd k */
+static uint32_t seek_target(uint32_t len, int k) {
+    uint32_t chunk = (uint32_t)((uint64_t)len * (uint32_t)k / SELFTEST_SEEKS) / SELFTEST_CHUNK * SELFTEST_CHUNK;
+    uint32_t t = chunk + (uint32_t)(k * 37) % (SELFTEST_CHUNK - SELFTEST_WINDOW);
+    return (t + SELFTEST_WINDOW <= len) ? t : UINT32_MAX;
+}
+
+/* [6] Loop regions of one track; invalid or too short ones are skipped by stream_loop_check */
+static void check_loops(const char *name, uint32_t len, uint32_t rate) {
+    const uint64_t regions[][2] = {
+        { 0, rate },                          /* A = 0: plain restart */
+        { rate, 2 * (uint64_t)rate },         /* Frame-aligned at 16 and at most Opus frame sizes */
+        { rate + 7, 2 * (uint64_t)rate + 13 },/* Neither point on a frame boundary */
+        { len / 2 + 3, len - 1 },             /* Long region, B just before the end */
+        { len / 3, len },                     /* B at the end of the track */
+    };
+    int tested = 0;
+    for (size_t i = 0; i < sizeof(regions) / sizeof(regions[0]); i++) {
+        int r = stream_loop_check(&test, regions[i][0], regions[i][1]);
+        assertf(r != STREAM_CHECK_UNSTAGED, "%s: loop %llu-%llu could not be staged", name,
+                (unsigned long long)regions[i][0], (unsigned long long)regions[i][1]);
+        assertf(r < 0, "%s: loop %llu-%llu differs %d samples after A", name,
+                (unsigned long long)regions[i][0], (unsigned long long)regions[i][1], r);
+        if (r == STREAM_CHECK_OK) tested++;
+    }
+    EVLOG(LOOP_TEST, tested > 0 ? 1u : 0u);
+    debugf("%s: %d loop regions bit-exact\n", name, tested);
+}
+
+/* [7] Stream decode against libdragon's reader: sequential over the whole track (collecting the
+   reference windows of the seek targets on the way), then each target reached by a seek */
+static void check_decode(const char *name, int channels) {
+    uint32_t len = test.len;
+    int bytes = SELFTEST_CHUNK * channels * 2;
+    int16_t *ref = (int16_t *)malloc_uncached((size_t)bytes);
+    int16_t *got = (int16_t *)malloc_uncached((size_t)bytes);
+    int16_t *windows = (int16_t *)malloc((size_t)SELFTEST_SEEKS * SELFTEST_WINDOW * channels * 2);
+    assertf(ref && got && windows, "selftest: no memory for %d-byte blocks", bytes);
+    uint32_t targets[SELFTEST_SEEKS];
+    for (int k = 0; k < SELFTEST_SEEKS; k++) targets[k] = seek_target(len, k);
+
+    samplebuffer_t sb;
+    samplebuffer_init(&sb, (uint8_t *)ref, bytes);
+    samplebuffer_set_bps(&sb, 16 * channels);
+    for (uint32_t pos = 0; pos < len; pos += SELFTEST_CHUNK) {
+        int n = (len - pos < SELFTEST_CHUNK) ? (int)(len - pos) : SELFTEST_CHUNK;
+        samplebuffer_flush(&sb);
+        ref_wav.wave.read(ref_wav.wave.ctx, &sb, (int)pos, n, pos == 0);
+        assertf(sb.widx >= n, "%s: libdragon gave %d of %d samples at %lu", name, sb.widx, n, (unsigned long)pos);
+        int have = stream_read_at(&test, pos, got, n);
+        assertf(have == n, "%s: stream gave %d of %d samples at %lu", name, have, n, (unsigned long)pos);
+        int d = first_diff(ref, got, n, channels);
+        assertf(d < 0, "%s: sequential decode differs at sample %lu", name, (unsigned long)(pos + (uint32_t)d));
+        for (int k = 0; k < SELFTEST_SEEKS; k++)
+            if (targets[k] / SELFTEST_CHUNK == pos / SELFTEST_CHUNK)
+                memcpy(&windows[k * SELFTEST_WINDOW * channels], &ref[(targets[k] - pos) * channels],
+                       (size_t)SELFTEST_WINDOW * channels * 2);
+    }
+    samplebuffer_close(&sb);
+
+    /* [7.1] Backwards, so every seek restarts from a checkpoint instead of decoding on */
+    int seeks = 0;
+    for (int k = SELFTEST_SEEKS - 1; k >= 0; k--) {
+        if (targets[k] == UINT32_MAX) continue;
+        int have = stream_read_at(&test, targets[k], got, SELFTEST_WINDOW);
+        assertf(have == SELFTEST_WINDOW, "%s: short read after seek to %lu", name, (unsigned long)targets[k]);
+        int d = first_diff(&windows[k * SELFTEST_WINDOW * channels], got, SELFTEST_WINDOW, channels);
+        assertf(d < 0, "%s: decode after seek to %lu differs at sample %lu", name,
+                (unsigned long)targets[k], (unsigned long)(targets[k] + (uint32_t)d));
+        seeks++;
+    }
+    free(windows);
+    free_uncached(got);
+    free_uncached(ref);
+    debugf("%s: %lu samples and %d seeks bit-exact against libdragon\n", name, (unsigned long)len, seeks);
+}
+
+/* [8] One track: open the scratch stream, build its whole index, run the checks, close */
+static void check_track(int index) {
+    const playlist_entry_t *e = playlist_entry(index);
+    const char *name = e->path;
+    arena_reset(SELFTEST_ARENA);
+    memset(&test_wav, 0, sizeof(test_wav));
+    wav64_open(&test_wav, e->path);
+    if (!stream_open(&test, &test_wav, e->path, e->has_info ? &e->info : NULL, SELFTEST_ARENA)) {
+        assertf(0, "%s: stream_open failed", name);
+        return;
+    }
+    while (!stream_index_done(&test)) stream_index_step(&test);
+
+    check_loops(name, test.len, test.in_freq);
+    if (test.format == 0 || test.format == 1) {
+        memset(&ref_wav, 0, sizeof(ref_wav));
+        wav64_open(&ref_wav, e->path);
+        check_decode(name, test.channels);
+        wav64_close(&ref_wav);
+    }
+    stream_close(&test);
+    wav64_close(&test_wav);
+}
+
+/* [9] Entry point: results go to the debug log and the console; a failure stops at its assert */
+int main(void) {
+    debug_init(DEBUG_FEATURE_ALL);
+    console_init();
+    console_set_debug(true);
+    evlog_init();
+    if (dfs_init(DFS_DEFAULT_LOCATION) != DFS_ESUCCESS) assertf(0, "selftest: cannot initialize DFS");
+    timer_init();
+    int count = playlist_init();
+    assertf(count > 0, "selftest: no .wav64 files in rom:/");
+    audio_engine_init((int)playlist_current()->wav.wave.frequency, 4, 32);
+
+    for (int i = 0; i < count; i++) {
+        uint32_t t0 = timer_ticks();
+        check_track(i);
+        debugf("%s: passed in %lu ms\n", playlist_path(i), (unsigned long)(TICKS_TO_MS(timer_ticks() - t0)));
+    }
+    debugf("selftest: all %d tracks passed\n", count);
+    while (1) {
+        audio_engine_pump();
+        evlog_flush(TICKS_FROM_MS(1)); /* The loop results reach sd:/ or the ISViewer */
+    }
+}
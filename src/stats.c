@@ -0,0 +1,77 @@
+/* [1] stats.c - Windowed statistics (see stats.h) */
+#include "stats.h"
+#include "utils.h" /* [2] fast_memset */
+
+static int bucket_of(const stats_t *s, uint32_t v) {
+    uint32_t b = v / s->bucket_width;
+    return (b >= STATS_BUCKETS) ? STATS_BUCKETS - 1 : (int)b;
+}
+
+void stats_init(stats_t *s, int window, uint32_t bucket_width) {
+    if (window < 1) window = 1;
+    if (window > STATS_MAX_WINDOW) window = STATS_MAX_WINDOW;
+    s->window = (uint16_t)window;
+    s->bucket_width = bucket_width ? bucket_width : 1;
+    stats_reset(s);
+}
+
+void stats_reset(stats_t *s) {
+    fast_memset(s->hist, 0, sizeof(s->hist));
+    s->sum = 0;
+    s->min = s->max = 0;
+    s->total = 0;
+    s->count = s->pos = 0;
+}
+
+/* [3] Min/max of the window again (only after the old min or max left it) */
+static void rescan(stats_t *s) {
+    uint32_t mn = UINT32_MAX, mx = 0;
+    for (int i = 0; i < s->count; i++) {
+        uint32_t v = s->ring[i];
+        if (v < mn) mn = v;
+        if (v > mx) mx = v;
+    }
+    s->min = s->count ? mn : 0;
+    s->max = mx;
+}
+
+void stats_add(stats_t *s, uint32_t v) {
+    bool full = s->count == s->window;
+    uint32_t old = full ? s->ring[s->pos] : 0;
+    s->ring[s->pos] = v;
+    s->pos = (uint16_t)((s->pos + 1) % s->window);
+    s->sum += v;
+    s->hist[bucket_of(s, v)]++;
+    s->total++;
+    if (full) {
+        s->sum -= old;
+        s->hist[bucket_of(s, old)]--;
+        if (old == s->min || old == s->max) { rescan(s); return; }
+    } else {
+        s->count++;
+    }
+    if (s->count == 1 || v < s->min) s->min = v;
+    if (v > s->max) s->max = v;
+}
+
+uint32_t stats_mean(const stats_t *s) {
+    return s->count ? (uint32_t)(s->sum / s->count) : 0;
+}
+
+uint32_t stats_min(const stats_t *s) { return s->min; }
+uint32_t stats_max(const stats_t *s) { return s->max; }
+
+uint32_t stats_percentile(const stats_t *s, int pct) {
+    if (!s->count) return 0;
+    uint32_t need = ((uint32_t)s->count * (uint32_t)pct + 99) / 100;
+    if (need == 0) need = 1;
+    uint32_t seen = 0;
+    for (int b = 0; b < STATS_BUCKETS; b++) {
+        seen += s->hist[b];
+        if (seen >= need) {
+            uint32_t edge = (uint32_t)(b + 1) * s->bucket_width;
+            return (b == STATS_BUCKETS - 1 || edge > s->max) ? s->max : edge;
+        }
+    }
+    return s->max;
+}
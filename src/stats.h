@@ -0,0 +1,35 @@
+/* [1] stats.h - Windowed statistics of one metric with O(1) updates: the last `window` samples
+   are kept in a ring with their running sum, their histogram in fixed-width buckets (for
+   p50/p95/p99), and their min/max. Values are unsigned integers in the caller's unit (us,
+   tenths of a percent, ...). Percentiles are the upper edge of their bucket, so they are
+   never optimistic by more than one bucket width. */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STATS_MAX_WINDOW 120   /* [2] Samples kept at most */
+#define STATS_BUCKETS 64       /* Histogram buckets, the last one also takes everything above */
+
+typedef struct {
+    uint32_t ring[STATS_MAX_WINDOW];
+    uint16_t hist[STATS_BUCKETS];
+    uint64_t sum;              /* Sum of the window */
+    uint32_t min, max;         /* Of the window */
+    uint32_t bucket_width;
+    uint32_t total;            /* Samples ever added */
+    uint16_t window, count, pos;
+} stats_t;
+
+/* [3] Window of `window` samples (1..STATS_MAX_WINDOW), buckets of `bucket_width` units */
+void stats_init(stats_t *s, int window, uint32_t bucket_width);
+void stats_reset(stats_t *s);
+
+/* [4] Add a sample. The sample leaving the window is taken out of the sum and the histogram;
+   only when it was the min or max is the window scanned again. */
+void stats_add(stats_t *s, uint32_t value);
+
+uint32_t stats_mean(const stats_t *s);
+uint32_t stats_min(const stats_t *s);
+uint32_t stats_max(const stats_t *s);
+/* [5] Value below which `pct` percent of the window lies (bucket upper edge, at most the max) */
+uint32_t stats_percentile(const stats_t *s, int pct);
@@ -0,0 +1,1081 @@
+/* [1] stream.c - Seekable playback stream over a WAV64 file.
+   PCM and VADPCM are read and decoded here so the reader can be restarted anywhere:
+   VADPCM restarts from the nearest seek index checkpoint (frame offset + decoder history).
+   Opus is decoded by libdragon one frame at a time into a one-frame buffer and handed out from
+   there, so the position stays exact; seeking restarts the decoder at the nearest packet of the
+   seek index (packet offsets), drops a short pre-roll and decodes forward.
+   A-B loops wrap from a state the main loop prepared at A, so the mixer never seeks. */
+#include "stream.h"
+#include "audio_engine.h" /* [2] audio_engine_lock/unlock around mixer and file access */
+#include "utils.h"        /* [3] fast_memset, fast_memcpy */
+#include "mem.h"          /* [3.0] Memory of the second Opus handle */
+#include "evlog.h"        /* [3.0.1] Opus layout check result */
+#include <stdlib.h>
+#include <unistd.h>       /* [3.1] lseek on the Opus decoder's file (opus_move_to only) */
+
+#define WAV64_HEADER_SIZE 24        /* [4] Common WAV64 header */
+#define WAV64_VADPCM_CODEBOOK 96    /* [5] Offset of the VADPCM codebook in the file */
+#define VADPCM_FRAME_BYTES 9        /* [6] Bytes per 16-sample frame, per channel */
+
+/* [7] Big-endian readers for header fields */
+static uint32_t rd_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static int16_t rd_be16(const uint8_t *p) {
+    return (int16_t)(((uint16_t)p[0] << 8) | (uint16_t)p[1]);
+}
+
+/* [8] Decode one 16-sample VADPCM frame of one channel.
+   hist holds the last `order` samples and is updated; output is written every `stride` samples. */
+static void vadpcm_decode_frame(const stream_t *s, int ch, int16_t *hist, const uint8_t *in,
+                                int16_t *out, int stride) {
+    int pred = in[0] & 0x0F;
+    int scale = 1 << (in[0] >> 4);
+    if (pred >= s->npredictors) pred = 0;
+    const int16_t (*book)[8] = s->codebook[ch][pred];
+    int32_t res[16];
+    for (int i = 0; i < 8; i++) {
+        res[2 * i] = (int32_t)((int8_t)(in[1 + i] & 0xF0) >> 4) * scale;
+        res[2 * i + 1] = (int32_t)((int8_t)(in[1 + i] << 4) >> 4) * scale;
+    }
+    for (int half = 0; half < 2; half++) {
+        const int32_t *r = &res[half * 8];
+        int16_t v[8];
+        for (int k = 0; k < 8; k++) {
+            int32_t acc = r[k] << 11;
+            if (s->order == 2) acc += book[0][k] * hist[0] + book[1][k] * hist[1];
+            else acc += book[0][k] * hist[1];
+            for (int x = 0; x < k; x++) acc += book[s->order - 1][k - 1 - x] * r[x];
+            acc >>= 11;
+            if (acc > 32767) acc = 32767;
+            if (acc < -32768) acc = -32768;
+            v[k] = (int16_t)acc;
+            out[(half * 8 + k) * stride] = v[k];
+        }
+        hist[0] = v[6];
+        hist[1] = v[7];
+    }
+}
+
+/* [8.1] Read n bytes at a cursor: the part inside the RAM preload is copied, the rest comes
+   from the cartridge (with one fseek after a jump, after reading from RAM or after another
+   cursor used the handle) */
+static int stream_io_read(stream_t *s, stream_io_t *io, void *dst, int n) {
+    int done = 0;
+    uint32_t mem_end = s->data_offset + s->preload_bytes;
+    if (s->preload && io->off >= s->data_offset && io->off < mem_end) {
+        uint32_t m = mem_end - io->off;
+        if (m > (uint32_t)n) m = (uint32_t)n;
+        fast_memcpy(dst, s->preload + (io->off - s->data_offset), m);
+        io->off += m;
+        if (s->fp_at == io) s->fp_at = NULL;
+        done = (int)m;
+    }
+    if (done < n && s->fp) {
+        if (s->fp_at != io) {
+            fseek(s->fp, (long)io->off, SEEK_SET);
+            s->fp_at = io;
+        }
+        int got = (int)fread((uint8_t *)dst + done, 1, (size_t)(n - done), s->fp);
+        if (got > 0) {
+            io->off += (uint32_t)got;
+            done += got;
+        }
+    }
+    return done;
+}
+
+/* [8.2] Move a cursor (the fseek happens lazily on the next cartridge read) */
+static void stream_io_seek(stream_t *s, stream_io_t *io, uint32_t off) {
+    io->off = off;
+    if (s->fp_at == io) s->fp_at = NULL;
+}
+
+/* [9] Decode the next VADPCM frame of all channels into frame_buf */
+static bool vadpcm_decode_next(stream_t *s) {
+    uint8_t in[VADPCM_FRAME_BYTES * STREAM_VADPCM_MAX_CHANNELS];
+    int fb = VADPCM_FRAME_BYTES * s->channels;
+    if (stream_io_read(s, &s->io, in, fb) != fb) return false;
+    for (int c = 0; c < s->channels; c++)
+        vadpcm_decode_frame(s, c, s->hist[c], &in[VADPCM_FRAME_BYTES * c], &s->frame_buf[c], s->channels);
+    s->dec_frame++;
+    s->frame_avail = 16;
+    return true;
+}
+
+/* [10] Produce wlen VADPCM samples (interleaved), padding with silence past the end */
+static void stream_read_vadpcm(stream_t *s, int16_t *out, int wlen) {
+    int ch = s->channels;
+    while (wlen > 0) {
+        if (s->frame_avail == 0 && !vadpcm_decode_next(s)) {
+            fast_memset(out, 0, (size_t)wlen * ch * sizeof(int16_t));
+            return;
+        }
+        int n = (wlen < s->frame_avail) ? wlen : s->frame_avail;
+        int start = 16 - s->frame_avail;
+        fast_memcpy(out, &s->frame_buf[start * ch], (size_t)n * ch * sizeof(int16_t));
+        out += n * ch;
+        wlen -= n;
+        s->frame_avail -= n;
+    }
+}
+
+/* [10.0] Give an Opus decoder its one-frame buffer; it restarts from sample 0 on the first decode */
+static bool opus_init(const stream_t *s, stream_opus_t *d, wav64_t *wav) {
+    int size = STREAM_OPUS_MAX_FRAME * s->channels * (s->bits / 8);
+    d->mem = (uint8_t *)malloc_uncached((size_t)size);
+    if (!d->mem) return false;
+    samplebuffer_init(&d->frame, d->mem, size);
+    samplebuffer_set_bps(&d->frame, s->bits * s->channels);
+    d->wav = wav;
+    d->next = 0;
+    d->avail = 0;
+    d->reset = true;
+    return true;
+}
+
+static void opus_free(stream_opus_t *d) {
+    if (d->mem) {
+        samplebuffer_close(&d->frame);
+        free_uncached(d->mem);
+    }
+    d->mem = NULL;
+}
+
+/* [10.1] Decode the next Opus frame into the decoder's frame buffer. libdragon appends whole frames,
+   so asking for one sample decodes exactly one frame; the write index tells how many samples it produced. */
+static bool opus_decode_next(const stream_t *s, stream_opus_t *d) {
+    uint32_t fs = (uint32_t)s->opus_frame_size;
+    if (d->next * fs >= s->len) return false;
+    samplebuffer_flush(&d->frame);
+    d->wav->wave.read(d->wav->wave.ctx, &d->frame, (int)(d->next * fs), 1, d->reset);
+    d->reset = false;
+    d->next++;
+    d->avail = d->frame.widx;
+    return d->avail > 0;
+}
+
+/* [10.1.1] The one place that reaches into libdragon's wav64. Its Opus reader can only restart at
+   sample 0, so a restart inside the track goes through the public read (seeking to sample 0,
+   which decodes the first frame) and then moves the decoder's file to the wanted packet. That
+   relies on the reader taking packets one after the other from `current_fd` with no read-ahead
+   of its own; opus_layout_ok() checks it on every open, and a stream that fails gets no Opus
+   index (seeks then decode forward from the start, with public calls only). */
+_Static_assert(sizeof(((wav64_t *)0)->current_fd) == sizeof(int), "wav64_t.current_fd changed: recheck opus_move_to()");
+
+static void opus_move_to(stream_opus_t *d, uint32_t offset) {
+    samplebuffer_flush(&d->frame);
+    d->wav->wave.read(d->wav->wave.ctx, &d->frame, 0, 1, true);
+    samplebuffer_flush(&d->frame);
+    lseek(d->wav->current_fd, (off_t)offset, SEEK_SET);
+}
+
+/* [10.1.2] Right after the first frame was decoded from a restart, the decoder's file must sit just
+   past packet 0: its 2-byte length, the packet, and a pad byte after an odd length when the
+   file is padded. Also tells which packet layout the file uses. */
+static bool opus_layout_ok(stream_t *s, const stream_opus_t *d) {
+    uint8_t h[2];
+    stream_io_t io = { s->data_offset };
+    int got = stream_io_read(s, &io, h, 2);
+    if (s->fp_at == &io) s->fp_at = NULL; /* The cursor lives on this stack frame */
+    if (got != 2) return false;
+    uint32_t nb = ((uint32_t)h[0] << 8) | h[1];
+    uint32_t end = s->data_offset + 2 + nb;
+    off_t at = lseek(d->wav->current_fd, 0, SEEK_CUR);
+    if (at == (off_t)end) {
+        s->build_pad = !(nb & 1); /* Even length: either layout, the walk finds out */
+        return true;
+    }
+    if ((nb & 1) && at == (off_t)(end + 1)) {
+        s->build_pad = true;
+        return true;
+    }
+    EVLOG(OPUS_LAYOUT, (uint32_t)at, end);
+    return false;
+}
+
+/* [10.2] Produce n Opus samples (interleaved) from the decoded frames, padding with silence past the end */
+static void stream_read_opus(stream_t *s, samplebuffer_t *sbuf, int n) {
+    stream_opus_t *d = &s->opus;
+    int bps = s->channels * (s->bits / 8);
+    while (n > 0) {
+        if (d->avail == 0 && !opus_decode_next(s, d)) {
+            fast_memset(samplebuffer_append(sbuf, n), 0, (size_t)n * bps);
+            return;
+        }
+        int k = (n < d->avail) ? n : d->avail;
+        int start = d->frame.widx - d->avail;
+        fast_memcpy(samplebuffer_append(sbuf, k), d->mem + start * bps, (size_t)k * bps);
+        d->avail -= k;
+        n -= k;
+    }
+}
+
+/* [10.9] Built checkpoint nearest before `frame` (-1: none yet) */
+static int stream_cp_index(const stream_t *s, uint32_t frame) {
+    if (s->index_count <= 0) return -1;
+    int idx = (int)(frame / s->index_interval);
+    return (idx >= s->index_count) ? s->index_count - 1 : idx;
+}
+
+/* [11] Restart the VADPCM decoder at `target`: nearest checkpoint (or the current decoder
+   position when it is closer), then decode forward. Cost is bounded by one index interval
+   once the index covers the target; before that, more than `max_frames` frames to decode
+   lands on the starting point instead. Returns the position reached. */
+static uint32_t stream_reposition_vadpcm(stream_t *s, uint32_t target, uint32_t max_frames) {
+    uint32_t frame = target / 16;
+    uint32_t cp_frame = 0;
+    const stream_checkpoint_t *cp = NULL;
+    int idx = stream_cp_index(s, frame);
+    if (idx >= 0) {
+        cp = &s->index[idx];
+        cp_frame = (uint32_t)idx * s->index_interval;
+    }
+    bool go_on = s->dec_frame <= frame && s->dec_frame > cp_frame;
+    uint32_t start = go_on ? s->dec_frame : cp_frame;
+    if (frame - start > max_frames) {
+        frame = start;
+        target = start * 16;
+    }
+    if (!go_on) {
+        if (cp) {
+            stream_io_seek(s, &s->io, cp->offset);
+            fast_memcpy(s->hist, cp->hist, sizeof(s->hist));
+        } else {
+            stream_io_seek(s, &s->io, s->data_offset);
+            fast_memset(s->hist, 0, sizeof(s->hist));
+        }
+        s->dec_frame = cp_frame;
+    }
+    s->frame_avail = 0;
+    while (s->dec_frame < frame) {
+        if (!vadpcm_decode_next(s)) break;
+    }
+    s->frame_avail = 0;
+    if (s->dec_frame == frame && vadpcm_decode_next(s)) s->frame_avail = 16 - (int)(target % 16);
+    return target;
+}
+
+/* [11.1] Point an Opus decoder at `target`. Its state is private to libdragon, so a restart
+   resets it and moves its file to the index packet (opus_move_to)
+   at least STREAM_OPUS_PREROLL_FRAMES before the target: the pre-roll frames decoded from there
+   rebuild the decoder state and are dropped. When the decoder is already between that packet and
+   the target it just goes on. Before the index is done a restart begins at sample 0. */
+static void opus_restart(const stream_t *s, stream_opus_t *d, uint32_t target) {
+    uint32_t frame = target / (uint32_t)s->opus_frame_size;
+    uint32_t from = (frame > STREAM_OPUS_PREROLL_FRAMES) ? frame - STREAM_OPUS_PREROLL_FRAMES : 0;
+    uint32_t cp_frame = 0;
+    const stream_checkpoint_t *cp = NULL;
+    int idx = stream_cp_index(s, from);
+    if (idx >= 0) {
+        cp = &s->index[idx];
+        cp_frame = (uint32_t)idx * s->index_interval;
+    }
+    d->avail = 0;
+    if (!d->reset && d->next <= frame && d->next > cp_frame) return;
+    if (cp && cp_frame > 0) {
+        opus_move_to(d, cp->offset);
+        d->reset = false;
+    } else {
+        d->reset = true;
+    }
+    d->next = cp_frame;
+}
+
+/* [11.2] Decode toward `target` after opus_restart(), at most `max_frames` frames (< 0: no limit).
+   Returns true once the frame holding the target is decoded and the target is the next sample out. */
+static bool opus_advance(const stream_t *s, stream_opus_t *d, uint32_t target, int max_frames) {
+    uint32_t frame = target / (uint32_t)s->opus_frame_size;
+    int offset = (int)(target % (uint32_t)s->opus_frame_size);
+    while (d->next <= frame) {
+        if (max_frames == 0) return false;
+        if (max_frames > 0) max_frames--;
+        if (!opus_decode_next(s, d)) { d->avail = 0; return true; } /* Past the end */
+    }
+    d->avail = (d->frame.widx > offset) ? d->frame.widx - offset : 0;
+    return true;
+}
+
+/* [11.2.1] Where opus_restart() + opus_advance() toward `target` would start decoding, and the
+   target itself when that is at most `max_frames` frames away. Otherwise the first clean sample
+   from that start: the decoder's own position, sample 0, or the pre-roll after the checkpoint. */
+static uint32_t opus_landing(const stream_t *s, const stream_opus_t *d, uint32_t target, uint32_t max_frames) {
+    uint32_t fs = (uint32_t)s->opus_frame_size;
+    uint32_t frame = target / fs;
+    uint32_t from = (frame > STREAM_OPUS_PREROLL_FRAMES) ? frame - STREAM_OPUS_PREROLL_FRAMES : 0;
+    int idx = stream_cp_index(s, from);
+    uint32_t cp_frame = (idx > 0) ? (uint32_t)idx * s->index_interval : 0;
+    bool go_on = !d->reset && d->next <= frame && d->next > cp_frame;
+    uint32_t start = go_on ? d->next : cp_frame;
+    if (frame + 1 - start <= max_frames) return target;
+    if (!go_on && start > 0) start += STREAM_OPUS_PREROLL_FRAMES;
+    return start * fs;
+}
+
+/* [11.3] Move the playing Opus decoder to `target`. Bounded by one index interval plus the
+   pre-roll once the index is done; a target inside the decoded frame costs nothing. Returns the
+   position reached (see opus_landing). */
+static uint32_t stream_reposition_opus(stream_t *s, uint32_t target, uint32_t max_frames) {
+    stream_opus_t *d = &s->opus;
+    int offset = (int)(target % (uint32_t)s->opus_frame_size);
+    if (!d->reset && d->next == target / (uint32_t)s->opus_frame_size + 1 && d->frame.widx > offset) {
+        d->avail = d->frame.widx - offset;
+        return target;
+    }
+    target = opus_landing(s, d, target, max_frames);
+    opus_restart(s, d, target);
+    opus_advance(s, d, target, -1);
+    return target;
+}
+
+/* [12] Move the reader to `target` for any format. `capped` limits the decode to
+   seek_max_frames while the index is being built (user seeks, pause); the loop wrap and the
+   self-check need the exact sample. Returns the position reached. */
+static uint32_t stream_reposition(stream_t *s, uint32_t target, bool capped) {
+    if (target > s->len) target = s->len;
+    uint32_t max_frames = (capped && !stream_index_done(s)) ? s->seek_max_frames : UINT32_MAX;
+    if (s->format == 1) {
+        target = stream_reposition_vadpcm(s, target, max_frames);
+    } else if (s->format == 3) {
+        target = stream_reposition_opus(s, target, max_frames);
+    } else {
+        int bps = (s->bits / 8) * s->channels;
+        stream_io_seek(s, &s->io, s->data_offset + target * (uint32_t)bps);
+    }
+    s->pos = target;
+    return target;
+}
+
+/* [13] Produce exactly n samples from the current position, without any loop handling */
+static void stream_produce(stream_t *s, samplebuffer_t *sbuf, int n) {
+    if (s->format == 3) {
+        stream_read_opus(s, sbuf, n);
+    } else {
+        void *out = samplebuffer_append(sbuf, n);
+        if (s->format == 1) {
+            stream_read_vadpcm(s, (int16_t *)out, n);
+        } else {
+            int bps = (s->bits / 8) * s->channels;
+            int got = stream_io_read(s, &s->io, out, n * bps);
+            if (got < n * bps) fast_memset((uint8_t *)out + got, 0, (size_t)(n * bps - got));
+        }
+    }
+    s->pos += (uint32_t)n;
+}
+
+/* [13.0.1] VADPCM decoder state at `frame` (file offset + history), decoded from the nearest
+   checkpoint with a private cursor on the stream's file. Main loop only: the reads run with the
+   mixer blocked, and the playback cursor seeks again after them. */
+static void vadpcm_state_at(stream_t *s, uint32_t frame, stream_checkpoint_t *out) {
+    uint32_t cp_frame = 0;
+    stream_io_t io = { s->data_offset };
+    int16_t hist[STREAM_VADPCM_MAX_CHANNELS][STREAM_VADPCM_MAX_ORDER] = { 0 };
+    if (s->index_count > 0) {
+        int idx = (int)(frame / s->index_interval);
+        if (idx >= s->index_count) idx = s->index_count - 1;
+        cp_frame = (uint32_t)idx * s->index_interval;
+        io.off = s->index[idx].offset;
+        fast_memcpy(hist, s->index[idx].hist, sizeof(hist));
+    }
+    int fb = VADPCM_FRAME_BYTES * s->channels;
+    uint8_t in[VADPCM_FRAME_BYTES * STREAM_VADPCM_MAX_CHANNELS];
+    int16_t out_pcm[16 * STREAM_VADPCM_MAX_CHANNELS];
+    for (; cp_frame < frame; cp_frame++) {
+        audio_engine_lock();
+        int got = stream_io_read(s, &io, in, fb);
+        if (s->fp_at == &io) s->fp_at = NULL; /* The cursor lives on this stack frame */
+        audio_engine_unlock();
+        if (got != fb) break;
+        for (int c = 0; c < s->channels; c++)
+            vadpcm_decode_frame(s, c, hist[c], &in[VADPCM_FRAME_BYTES * c], &out_pcm[c], s->channels);
+    }
+    out->offset = io.off;
+    fast_memcpy(out->hist, hist, sizeof(out->hist));
+}
+
+/* [13.0.2] Open the second Opus handle and its frame buffer (kept until stream_close). Only an
+   A-B loop needs it, so it is opened by the first one; that frame is not a steady one. */
+static bool stream_spare_open(stream_t *s) {
+    if (s->spare_open) return true;
+    if (!s->path) return false;
+    mem_frame_unsteady();
+    mem_scope_t m = mem_scope_begin();
+    fast_memset(&s->spare_wav, 0, sizeof(s->spare_wav));
+    wav64_open(&s->spare_wav, s->path);
+    s->spare_open = true;
+    bool ok = opus_init(s, &s->opus_spare, &s->spare_wav);
+    mem_scope_end(MEM_AUDIO, m);
+    return ok;
+}
+
+/* [13.0.3] Move the staged state toward `a` (main loop). VADPCM saves the decoder state at A's
+   frame in one go; Opus decodes at most `max_frames` frames of the spare decoder (< 0: all), each
+   with the mixer blocked. Returns true when the wrap is staged. */
+static bool stream_stage(stream_t *s, uint32_t a, int max_frames) {
+    if (s->stage_ready && s->stage_pos == a) return true;
+    if (s->format == 1) {
+        stream_checkpoint_t cp;
+        vadpcm_state_at(s, a / 16, &cp);
+        audio_engine_lock();
+        s->stage_cp = cp;
+        s->stage_pos = a;
+        s->stage_ready = true;
+        audio_engine_unlock();
+        return true;
+    }
+    if (s->format != 3 || !stream_spare_open(s) || !s->opus_spare.mem) return false;
+    if (!s->stage_busy || s->stage_pos != a) {
+        audio_engine_lock();
+        s->stage_ready = false; /* The mixer leaves the spare decoder alone from now on */
+        opus_restart(s, &s->opus_spare, a);
+        s->stage_pos = a;
+        s->stage_busy = true;
+        audio_engine_unlock();
+    }
+    bool done = false;
+    while (!done && max_frames != 0) {
+        audio_engine_lock();
+        done = opus_advance(s, &s->opus_spare, a, 1);
+        if (done) {
+            s->stage_busy = false;
+            s->stage_ready = true;
+        }
+        audio_engine_unlock();
+        if (max_frames > 0) max_frames--;
+    }
+    return done;
+}
+
+/* [13.0.4] B -> A in the mixer. A staged state makes it a switch: VADPCM seeks to the
+   saved frame and decodes it, Opus swaps decoders (the old one is staged again by the main loop).
+   PCM, A = 0 and a wrap that came before the staging was done fall back to a reposition. */
+static void stream_wrap(stream_t *s) {
+    uint32_t a = s->loop_start;
+    if (s->stage_ready && s->stage_pos == a && a > 0) {
+        if (s->format == 1) {
+            stream_io_seek(s, &s->io, s->stage_cp.offset);
+            fast_memcpy(s->hist, s->stage_cp.hist, sizeof(s->hist));
+            s->dec_frame = a / 16;
+            s->frame_avail = 0;
+            if (vadpcm_decode_next(s)) s->frame_avail = 16 - (int)(a % 16);
+            s->pos = a;
+            return;
+        }
+        if (s->format == 3) {
+            stream_opus_t t = s->opus;
+            s->opus = s->opus_spare;
+            s->opus_spare = t;
+            s->stage_ready = false;
+            s->pos = a;
+            return;
+        }
+    }
+    stream_reposition(s, a, false);
+}
+
+/* [13.1] Where the current pass ends: the B point, or the end of the file when we are already past B */
+static uint32_t stream_pass_end(const stream_t *s, uint64_t pos) {
+    return (pos < s->loop_end) ? s->loop_end : s->len;
+}
+
+/* [13.2] Waveform read callback used by the mixer (runs inside mixer_poll).
+   The mixer sees an endless waveform; loops are done here, inside a single read,
+   so the sample after B is exactly the sample at A with no gap or resync. */
+static void stream_read(void *ctx, samplebuffer_t *sbuf, int wpos, int wlen, bool seeking) {
+    stream_t *s = (stream_t *)ctx;
+    if (s->lead_silence > 0) {
+        /* [13.5] Delayed start: silence first, the mixer's position includes these samples */
+        int n = (s->lead_silence < (uint32_t)wlen) ? (int)s->lead_silence : wlen;
+        void *out = samplebuffer_append(sbuf, n);
+        fast_memset(out, 0, (size_t)n * s->channels * (s->bits / 8));
+        s->lead_silence -= (uint32_t)n;
+        wlen -= n;
+        if (wlen == 0) return;
+        seeking = false;
+    }
+    if (seeking) {
+        /* [13.3] Our own seeks carry the exact target (mixer_ch_set_pos goes through a float) */
+        uint32_t target = s->seek_pending ? s->seek_target : (uint32_t)wpos;
+        s->seek_pending = false;
+        if (target != s->pos) stream_reposition(s, target, true);
+    }
+    while (wlen > 0) {
+        uint32_t end = s->loop ? stream_pass_end(s, s->pos) : s->len;
+        if (s->pos >= end) {
+            if (s->loop && s->loop_end > s->loop_start) {
+                stream_wrap(s);
+                s->loop_count++;
+                continue;
+            }
+            /* [13.4] End of a non-looping stream: pad with silence and let the main loop stop it */
+            void *out = samplebuffer_append(sbuf, wlen);
+            fast_memset(out, 0, (size_t)wlen * s->channels * (s->bits / 8));
+            s->ended = true;
+            return;
+        }
+        int n = (int)(end - s->pos);
+        if (n > wlen) n = wlen;
+        stream_produce(s, sbuf, n);
+        wlen -= n;
+    }
+}
+
+/* [13.9] Checkpoint spacing: at least STREAM_INDEX_MIN_INTERVAL_MS, and never more than
+   STREAM_INDEX_MAX_ENTRIES entries, so index memory is bounded for any track length. The index
+   comes from `arena`; without it the stream still plays and seeks decode forward from the start.
+   The builder reads through its own cursor on the stream's handle. */
+static void stream_index_alloc(stream_t *s, uint32_t nframes, uint32_t frame_samples, arena_id_t arena) {
+    uint32_t min_interval = (uint32_t)(s->wav->wave.frequency * STREAM_INDEX_MIN_INTERVAL_MS / 1000.0f) / frame_samples;
+    if (min_interval < 1) min_interval = 1;
+    uint32_t interval = (nframes + STREAM_INDEX_MAX_ENTRIES - 1) / STREAM_INDEX_MAX_ENTRIES;
+    if (interval < min_interval) interval = min_interval;
+    s->index_interval = interval;
+    /* [13.9.1] Seek decode cap: STREAM_SEEK_MAX_DECODE_MS of audio, and always enough to reach
+       any sample from a checkpoint once the index is complete */
+    s->seek_max_frames = (uint32_t)(s->wav->wave.frequency * STREAM_SEEK_MAX_DECODE_MS / 1000.0f) / frame_samples;
+    if (s->seek_max_frames < interval + STREAM_OPUS_PREROLL_FRAMES + 1)
+        s->seek_max_frames = interval + STREAM_OPUS_PREROLL_FRAMES + 1;
+    s->index_total = (int)((nframes + interval - 1) / interval);
+    if (s->index_total > 0) {
+        s->index = (stream_checkpoint_t *)arena_alloc(arena, sizeof(stream_checkpoint_t) * s->index_total);
+        if (!s->index) {
+            s->index_total = 0;
+            return;
+        }
+        stream_io_seek(s, &s->build_io, s->data_offset);
+    }
+}
+
+/* [14] Read the VADPCM codebook and allocate the seek index from `arena` */
+static bool stream_open_vadpcm(stream_t *s, arena_id_t arena) {
+    FILE *fp = s->fp;
+    uint8_t ext[8];
+    fseek(fp, WAV64_HEADER_SIZE, SEEK_SET);
+    if (fread(ext, 1, sizeof(ext), fp) != sizeof(ext)) return false;
+    s->npredictors = ext[0];
+    s->order = ext[1];
+    if (s->npredictors < 1 || s->npredictors > STREAM_VADPCM_MAX_PREDICTORS) return false;
+    if (s->order < 1 || s->order > STREAM_VADPCM_MAX_ORDER) return false;
+    fseek(fp, WAV64_VADPCM_CODEBOOK, SEEK_SET);
+    uint8_t vec[16];
+    for (int c = 0; c < s->channels; c++)
+        for (int p = 0; p < s->npredictors; p++)
+            for (int o = 0; o < s->order; o++) {
+                if (fread(vec, 1, sizeof(vec), fp) != sizeof(vec)) return false;
+                for (int k = 0; k < 8; k++) s->codebook[c][p][o][k] = rd_be16(&vec[k * 2]);
+            }
+    s->bits = 16;
+    stream_index_alloc(s, (s->len + 15) / 16, 16, arena); /* [14.1] 16 samples per frame */
+    return true;
+}
+
+/* [15.0] Header fields and file size from the file itself (no catalog entry) */
+static bool stream_read_info(FILE *fp, stream_info_t *info) {
+    uint8_t hdr[WAV64_HEADER_SIZE];
+    if (fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) return false;
+    if (hdr[0] != 'W' || hdr[1] != 'V' || hdr[2] != '6' || hdr[3] != '4') return false;
+    fseek(fp, 0, SEEK_END);
+    fast_memset(info, 0, sizeof(*info));
+    info->file_size = (uint32_t)ftell(fp);
+    info->format = hdr[5];
+    info->channels = hdr[6];
+    info->bits = hdr[7];
+    info->freq = rd_be32(&hdr[8]);
+    info->len = rd_be32(&hdr[12]);
+    uint32_t loop_len = rd_be32(&hdr[16]);
+    info->data_offset = rd_be32(&hdr[20]);
+    if (loop_len > 0 && loop_len <= info->len) {
+        info->loop_start = info->len - loop_len;
+        info->loop_end = info->len;
+    }
+    if (info->format == 0) info->bitrate = info->freq * info->channels * info->bits;
+    else if (info->len > 0 && info->file_size > info->data_offset)
+        info->bitrate = (uint32_t)((uint64_t)(info->file_size - info->data_offset) * 8u * info->freq / info->len);
+    return true;
+}
+
+/* [15] Open a stream over an already opened wav64. The stream keeps one handle of its own for
+   playback reads, the index builder and the preload; with `info` nothing else is read to open
+   PCM and Opus, VADPCM reads its codebook. */
+bool stream_open(stream_t *s, wav64_t *wav, const char *filename, const stream_info_t *info, arena_id_t arena) {
+    fast_memset(s, 0, sizeof(*s));
+    s->wav = wav;
+    s->path = filename;
+    s->fp = asset_fopen(filename, NULL);
+    if (!s->fp) return false;
+    stream_info_t file_info;
+    if (!info) {
+        if (!stream_read_info(s->fp, &file_info)) { stream_close(s); return false; }
+        info = &file_info;
+    }
+    s->format = info->format;
+    s->channels = info->channels;
+    s->bits = info->bits;
+    s->len = info->len;
+    s->data_offset = info->data_offset;
+    s->file_size = info->file_size;
+    s->bitrate = info->bitrate;
+    if (s->channels < 1 || s->channels > STREAM_VADPCM_MAX_CHANNELS) { stream_close(s); return false; }
+
+    if (s->format == 1) {
+        if (!stream_open_vadpcm(s, arena)) { stream_close(s); return false; }
+    } else if (s->format == 3) {
+        /* [15.1] Opus is decoded by libdragon one frame at a time. Decoding the first frame gives
+           the frame size; playback restarts the decoder anyway. */
+        s->bits = (uint8_t)wav->wave.bits;
+        if (!opus_init(s, &s->opus, wav)) { stream_close(s); return false; }
+        s->opus_frame_size = STREAM_OPUS_MAX_FRAME;
+        if (!opus_decode_next(s, &s->opus)) { stream_close(s); return false; }
+        s->opus_frame_size = s->opus.frame.widx;
+        s->opus.reset = true;
+        s->opus.next = 0;
+        s->opus.avail = 0;
+        /* [15.1.1] Index of packet offsets, one per index interval (frames), found by
+           stream_index_step(); only when restarting at a packet is known to work */
+        uint32_t fs = (uint32_t)s->opus_frame_size;
+        s->build_pad = true;
+        if (opus_layout_ok(s, &s->opus)) stream_index_alloc(s, (s->len + fs - 1) / fs, fs, arena);
+    }
+    stream_io_seek(s, &s->io, s->data_offset);
+
+    /* [15.2] Proxy waveform: same format as the file, but every read goes through stream_read */
+    s->wave.name = wav->wave.name;
+    s->wave.bits = s->bits;
+    s->wave.channels = s->channels;
+    s->wave.frequency = wav->wave.frequency;
+    s->wave.len = WAVEFORM_UNKNOWN_LEN; /* Endless: end and loops are handled in stream_read */
+    s->wave.loop_len = 0;
+    s->wave.read = stream_read;
+    s->wave.ctx = s;
+    s->in_freq = (uint32_t)(wav->wave.frequency + 0.5f);
+    s->out_freq = (uint32_t)audio_get_frequency();
+    /* [15.3] The file's loop region (e.g. a game track with an intro) is the default loop;
+       A-B points replace it until they are cleared */
+    s->file_loop_start = 0;
+    s->file_loop_end = s->len;
+    if (info->loop_end > info->loop_start && info->loop_end <= s->len &&
+        info->loop_end - info->loop_start >= STREAM_LOOP_MIN_SAMPLES) {
+        s->file_loop_start = info->loop_start;
+        s->file_loop_end = info->loop_end;
+    }
+    s->loop_start = s->file_loop_start;
+    s->loop_end = s->file_loop_end;
+    return true;
+}
+
+/* [16] Close the stream. The index stays in its arena until the caller resets it. */
+void stream_close(stream_t *s) {
+    if (s->fp) fclose(s->fp);
+    opus_free(&s->opus);
+    opus_free(&s->opus_spare);
+    if (s->spare_open) wav64_close(&s->spare_wav); /* The caller closes its own handle */
+    s->spare_open = false;
+    s->stage_ready = s->stage_busy = false;
+    s->fp = NULL;
+    s->fp_at = NULL;
+    s->preload = NULL; /* The preload buffer belongs to the caller */
+    s->preload_size = s->preload_bytes = 0;
+    s->index = NULL;
+    s->index_count = s->index_total = 0;
+}
+
+/* [16.1] Move the position anchor to "now". During a delayed start the anchor already
+   points into the future and must be kept. */
+static void stream_reanchor(stream_t *s) {
+    uint64_t now = audio_engine_get_samples_mixed();
+    if (s->running && now < s->anchor_mixed) return;
+    s->anchor_pos = stream_get_position(s);
+    s->anchor_mixed = now;
+}
+
+/* [17] Start playback on a mixer channel from sample 0 */
+void stream_play(stream_t *s, int ch) {
+    stream_play_at(s, ch, 0);
+}
+
+/* [17.0] Start playback with sample 0 mixed at output sample `start_mixed` */
+void stream_play_at(stream_t *s, int ch, uint64_t start_mixed) {
+    audio_engine_lock();
+    s->pos = 0;
+    s->dec_frame = 0;
+    s->frame_avail = 0;
+    s->opus.next = 0;
+    s->opus.avail = 0;
+    s->opus.reset = true;
+    stream_io_seek(s, &s->io, s->data_offset);
+    fast_memset(s->hist, 0, sizeof(s->hist));
+    s->seek_pending = false;
+    s->ended = false;
+    s->paused = false;
+    s->out_freq = (uint32_t)audio_get_frequency(); /* Audio may not have been initialized at open */
+    uint64_t now = audio_engine_get_samples_mixed();
+    uint64_t delay = (start_mixed > now) ? start_mixed - now : 0;
+    s->lead_silence = (s->out_freq && s->in_freq != s->out_freq)
+                    ? (uint32_t)(delay * s->in_freq / s->out_freq) : (uint32_t)delay;
+    mixer_ch_play(ch, &s->wave);
+    s->anchor_pos = 0;
+    s->anchor_mixed = now + delay;
+    s->running = true;
+    audio_engine_unlock();
+}
+
+/* [17.1] Stop playback, keeping the current position */
+void stream_stop(stream_t *s, int ch) {
+    audio_engine_lock();
+    s->anchor_pos = stream_get_position(s);
+    s->running = false;
+    s->paused = false;
+    if (mixer_ch_playing(ch)) mixer_ch_stop(ch);
+    audio_engine_unlock();
+}
+
+/* [18] Enable or disable looping. The position tracker is re-anchored so it follows the new rule. */
+void stream_set_loop(stream_t *s, bool loop) {
+    audio_engine_lock();
+    stream_reanchor(s);
+    s->loop = loop;
+    audio_engine_unlock();
+}
+
+/* [18.1] Set the A-B loop region (A inclusive, B exclusive). Returns false if the region is invalid. */
+bool stream_set_loop_points(stream_t *s, uint64_t a, uint64_t b) {
+    if (b > s->len) b = s->len;
+    if (a >= b || b - a < STREAM_LOOP_MIN_SAMPLES) return false;
+    if (a > 0 && s->format != 0) stream_stage(s, (uint32_t)a, -1); /* [18.1.1] Staged before the first wrap */
+    audio_engine_lock();
+    stream_reanchor(s);
+    s->loop_start = (uint32_t)a;
+    s->loop_end = (uint32_t)b;
+    audio_engine_unlock();
+    return true;
+}
+
+/* [18.2] Back to the file's loop region (the whole stream when it has none) */
+void stream_clear_loop_points(stream_t *s) {
+    stream_set_loop_points(s, s->file_loop_start, s->file_loop_end);
+}
+
+/* [18.3] Keep the next wrap staged: after an Opus wrap the decoder that played up to B moves to A,
+   STREAM_LOOP_STAGE_FRAMES frames per call */
+void stream_loop_step(stream_t *s) {
+    if (!s->loop || s->loop_start == 0 || s->format == 0) return;
+    stream_stage(s, s->loop_start, STREAM_LOOP_STAGE_FRAMES);
+}
+
+/* [19.0.1] Seek with the channel stopped while the reader moves */
+static uint64_t stream_seek_playing(stream_t *s, int ch, uint64_t sample) {
+    audio_engine_lock();
+    bool playing = mixer_ch_playing(ch);
+    if (playing) mixer_ch_stop(ch);
+    audio_engine_unlock();
+    sample = stream_reposition(s, (uint32_t)sample, true);
+    audio_engine_lock();
+    if (playing) {
+        mixer_ch_play(ch, &s->wave);
+        mixer_ch_set_pos(ch, (float)sample);
+        s->seek_target = (uint32_t)sample;
+        s->seek_pending = true;
+    }
+    s->ended = false;
+    s->lead_silence = 0;
+    s->anchor_pos = sample;
+    s->anchor_mixed = audio_engine_get_samples_mixed();
+    s->running = playing;
+    audio_engine_unlock();
+    return sample;
+}
+
+/* [19] Jump to a sample position. The channel is stopped while the reader is moved,
+   so the (possibly long) Opus skip never runs inside the mix. */
+uint64_t stream_seek(stream_t *s, int ch, uint64_t sample) {
+    if (sample > s->len) sample = s->len;
+    uint32_t t0 = timer_ticks();
+    if (s->paused) {
+        /* [19.0] Paused: the channel is stopped, so the reader moves in place and the
+           position waits there for the resume */
+        sample = stream_reposition(s, (uint32_t)sample, true);
+        audio_engine_lock();
+        s->ended = false;
+        s->lead_silence = 0;
+        s->anchor_pos = sample;
+        audio_engine_unlock();
+    } else {
+        sample = stream_seek_playing(s, ch, sample);
+    }
+    s->last_seek_us = (uint32_t)TICKS_TO_US(timer_ticks() - t0);
+    if (s->last_seek_us > s->max_seek_us) s->max_seek_us = s->last_seek_us;
+    s->seek_count++;
+    return sample;
+}
+
+/* [19.0.2] Pause/resume in place. Pausing stops the channel, which also drops the samples the
+   mixer had buffered ahead; the reader is moved back to the sample that will be heard next. */
+void stream_set_paused(stream_t *s, int ch, bool paused) {
+    if (!s->running || s->paused == paused) return;
+    audio_engine_lock();
+    uint64_t now = audio_engine_get_samples_mixed();
+    if (!paused) {
+        /* [19.0.3] Restart from the anchor; a delayed start keeps the rest of its delay */
+        mixer_ch_play(ch, &s->wave);
+        if (s->lead_silence == 0 && s->anchor_pos > 0) {
+            mixer_ch_set_pos(ch, (float)s->anchor_pos);
+            s->seek_target = (uint32_t)s->anchor_pos;
+            s->seek_pending = true;
+        }
+        uint64_t delay = s->lead_silence;
+        if (s->out_freq && s->in_freq != s->out_freq) delay = delay * s->out_freq / s->in_freq;
+        s->anchor_mixed = now + delay;
+        s->paused = false;
+        audio_engine_unlock();
+        return;
+    }
+    uint32_t target = 0;
+    if (now < s->anchor_mixed) {
+        uint64_t delay = s->anchor_mixed - now; /* Delayed start not reached yet */
+        if (s->out_freq && s->in_freq != s->out_freq) delay = delay * s->in_freq / s->out_freq;
+        s->lead_silence = (uint32_t)delay;
+        s->anchor_pos = 0;
+    } else {
+        s->anchor_pos = stream_get_position(s);
+        s->lead_silence = 0;
+        target = (uint32_t)s->anchor_pos;
+    }
+    if (mixer_ch_playing(ch)) mixer_ch_stop(ch);
+    s->paused = true;
+    audio_engine_unlock();
+    /* [19.0.4] The channel is stopped, so the reader moves outside the mix */
+    if (target != s->pos) {
+        uint32_t at = stream_reposition(s, target, true);
+        audio_engine_lock();
+        if (s->lead_silence == 0) s->anchor_pos = at; /* Index not there yet: resume from the checkpoint */
+        audio_engine_unlock();
+    }
+    s->ended = false;
+}
+
+/* [19.1] Position = anchor + output samples mixed since the anchor, converted to the
+   waveform rate with integer math. Wraps into the loop region, or stops at the end. */
+uint64_t stream_get_position(const stream_t *s) {
+    if (!s->running || s->paused) return s->anchor_pos;
+    uint64_t now = audio_engine_get_samples_mixed();
+    if (now < s->anchor_mixed) return s->anchor_pos; /* Delayed start not reached yet */
+    uint64_t mixed = now - s->anchor_mixed;
+    if (s->out_freq && s->in_freq != s->out_freq) mixed = mixed * s->in_freq / s->out_freq;
+    uint64_t pos = s->anchor_pos + mixed;
+    uint64_t end = s->loop ? stream_pass_end(s, s->anchor_pos) : s->len;
+    if (pos >= end) {
+        if (s->loop && s->loop_end > s->loop_start)
+            pos = s->loop_start + (pos - end) % (s->loop_end - s->loop_start);
+        else pos = s->len;
+    }
+    return pos;
+}
+
+/* [19.2] Loop boundary check: the samples produced across B -> A must be bit-identical to the
+   samples produced by a fresh start at A. The buffers take exactly pre + post samples:
+   stream_produce() never hands out more. */
+int stream_loop_check(stream_t *s, uint64_t a, uint64_t b) {
+    const int pre = STREAM_CHECK_PRE, post = STREAM_CHECK_POST;
+    int bps = s->channels * (s->bits / 8);
+    int size = (pre + post) * bps;
+    if (b > s->len) b = s->len;
+    if (a >= b || b - a < (uint64_t)post || b < (uint64_t)pre) return STREAM_CHECK_SKIPPED;
+    uint8_t *mem = (uint8_t *)malloc_uncached((size_t)size * 2);
+    if (!mem) return STREAM_CHECK_SKIPPED;
+    uint32_t old_start = s->loop_start, old_end = s->loop_end;
+    bool old_loop = s->loop;
+    samplebuffer_t sb;
+    s->loop = true;
+    s->loop_start = (uint32_t)a;
+    s->loop_end = (uint32_t)b;
+    /* [19.2.1] Reference: post samples starting at A */
+    samplebuffer_init(&sb, mem, size);
+    samplebuffer_set_bps(&sb, s->bits * s->channels);
+    s->opus.reset = true;
+    s->pos = UINT32_MAX;
+    stream_reposition(s, (uint32_t)a, false);
+    stream_produce(s, &sb, post);
+    samplebuffer_close(&sb);
+    /* [19.2.2] Through the loop: pre samples before B, then the wrap, which must use the
+       state staged at A like a real A-B loop (PCM and A = 0 need none) */
+    int result = STREAM_CHECK_OK;
+    if (a == 0 || s->format == 0 || stream_stage(s, (uint32_t)a, -1)) {
+        samplebuffer_init(&sb, mem + size, size);
+        samplebuffer_set_bps(&sb, s->bits * s->channels);
+        stream_reposition(s, (uint32_t)(b - pre), false);
+        stream_read(s, &sb, 0, pre + post, false);
+        samplebuffer_close(&sb);
+        const uint8_t *ref = mem, *got = mem + size + pre * bps;
+        for (int i = 0; i < post * bps; i++) {
+            if (ref[i] != got[i]) { result = i / bps; break; }
+        }
+    } else {
+        result = STREAM_CHECK_UNSTAGED;
+    }
+    s->loop = old_loop;
+    s->loop_start = old_start;
+    s->loop_end = old_end;
+    s->loop_count = 0;
+    free_uncached(mem);
+    return result;
+}
+
+/* [19.3] Test read: exact reposition unless the reader is already there, then produce */
+int stream_read_at(stream_t *s, uint32_t pos, void *out, int n) {
+    if (pos >= s->len) return 0;
+    if ((uint32_t)n > s->len - pos) n = (int)(s->len - pos);
+    if (pos != s->pos) stream_reposition(s, pos, false);
+    samplebuffer_t sb;
+    samplebuffer_init(&sb, (uint8_t *)out, n * s->channels * (s->bits / 8));
+    samplebuffer_set_bps(&sb, s->bits * s->channels);
+    stream_produce(s, &sb, n);
+    samplebuffer_close(&sb);
+    return n;
+}
+
+/* [19.9] The Opus walk ended: publish the index, or try the other packet layout, or give up */
+static void stream_index_opus_end(stream_t *s, bool ok) {
+    if (!ok && ++s->build_tries < 2) {
+        s->build_pad = !s->build_pad;
+        s->build_frame = 0;
+        stream_io_seek(s, &s->build_io, s->data_offset);
+        return;
+    }
+    int count = 0;
+    if (ok) {
+        count = (int)((s->build_frame + s->index_interval - 1) / s->index_interval);
+        if (count > s->index_total) count = s->index_total;
+    }
+    s->index_total = s->index_count = count; /* Entries are used from now on */
+}
+
+/* [19.10] Walk Opus packets until `deadline` (timer ticks): a 2-byte big-endian length, the
+   packet, and with padding one more byte after an odd length. The header does not say which
+   layout the file uses, so the walk starts with the one packet 0 pointed to at open (padded when
+   it could not tell) and must end exactly at the end of the file;
+   a bad length or a wrong end restarts it with the other layout, a second failure leaves the
+   stream without an index. Only the headers are read. */
+static void stream_index_step_opus(stream_t *s, uint32_t deadline) {
+    while (TICKS_DISTANCE(timer_ticks(), deadline) > 0) {
+        uint32_t off = s->build_io.off;
+        uint32_t left = (s->file_size > off) ? s->file_size - off : 0;
+        if (left < 2) { stream_index_opus_end(s, true); return; }
+        uint8_t h[2];
+        audio_engine_lock();
+        int got = stream_io_read(s, &s->build_io, h, 2);
+        audio_engine_unlock();
+        uint32_t nb = ((uint32_t)h[0] << 8) | h[1];
+        if (got != 2 || nb == 0 || nb > STREAM_OPUS_MAX_PACKET || nb > left - 2) {
+            stream_index_opus_end(s, false);
+            return;
+        }
+        if (s->build_frame % s->index_interval == 0) {
+            int k = (int)(s->build_frame / s->index_interval);
+            if (k < s->index_total) s->index[k].offset = off;
+        }
+        s->build_frame++;
+        stream_io_seek(s, &s->build_io, off + 2 + nb + ((s->build_pad && (nb & 1)) ? 1 : 0));
+    }
+}
+
+/* [20] Index VADPCM frames for at most STREAM_INDEX_BUILD_US, STREAM_INDEX_BUILD_BATCH frames per
+   read. Checkpoints are recorded before decoding the frame they point to, so their history is the
+   state needed to restart there. The builder's handle stays open until stream_close: closing it
+   here would free memory in the middle of steady playback. */
+void stream_index_step(stream_t *s) {
+    if (stream_index_done(s)) return;
+    uint32_t deadline = timer_ticks() + TICKS_FROM_US(STREAM_INDEX_BUILD_US);
+    if (s->format == 3) {
+        stream_index_step_opus(s, deadline);
+        return;
+    }
+    uint32_t nframes = (s->len + 15) / 16;
+    int fb = VADPCM_FRAME_BYTES * s->channels;
+    uint8_t in[VADPCM_FRAME_BYTES * STREAM_VADPCM_MAX_CHANNELS * STREAM_INDEX_BUILD_BATCH];
+    int16_t out[16 * STREAM_VADPCM_MAX_CHANNELS];
+    while (s->build_frame < nframes && TICKS_DISTANCE(timer_ticks(), deadline) > 0) {
+        uint32_t n = nframes - s->build_frame;
+        if (n > STREAM_INDEX_BUILD_BATCH) n = STREAM_INDEX_BUILD_BATCH;
+        audio_engine_lock();
+        int got = stream_io_read(s, &s->build_io, in, (int)n * fb) / fb;
+        audio_engine_unlock();
+        for (int i = 0; i < got; i++) {
+            if (s->build_frame % s->index_interval == 0 && s->index_count < s->index_total) {
+                stream_checkpoint_t *cp = &s->index[s->index_count++];
+                cp->offset = s->data_offset + s->build_frame * (uint32_t)fb;
+                fast_memcpy(cp->hist, s->build_hist, sizeof(cp->hist));
+            }
+            const uint8_t *f = &in[i * fb];
+            for (int c = 0; c < s->channels; c++)
+                vadpcm_decode_frame(s, c, s->build_hist[c], &f[VADPCM_FRAME_BYTES * c], &out[c], s->channels);
+            s->build_frame++;
+        }
+        if (got < (int)n) { s->build_frame = nframes; break; }
+    }
+}
+
+/* [21] Index progress */
+bool stream_index_done(const stream_t *s) {
+    return (s->format != 1 && s->format != 3) || !s->index || s->index_count >= s->index_total;
+}
+
+int stream_index_percent(const stream_t *s) {
+    if (stream_index_done(s) || s->index_total == 0) return 100;
+    if (s->format == 3) { /* Packets walked (entries are published at the end) */
+        uint32_t nframes = (s->len + (uint32_t)s->opus_frame_size - 1) / (uint32_t)s->opus_frame_size;
+        int pct = nframes ? (int)((uint64_t)s->build_frame * 100 / nframes) : 100;
+        return (pct > 99) ? 99 : pct;
+    }
+    return (s->index_count * 100) / s->index_total;
+}
+
+/* [22] Memory used by the seek index in bytes */
+int stream_index_bytes(const stream_t *s) {
+    return s->index ? (int)(sizeof(stream_checkpoint_t) * s->index_total) : 0;
+}
+
+/* [23] Sample data size in bytes */
+uint32_t stream_data_bytes(const stream_t *s) {
+    return (s->file_size > s->data_offset) ? s->file_size - s->data_offset : 0;
+}
+
+/* [24] The load reads through its own cursor on the stream's handle, which is only closed by
+   stream_close (track close), never when the load ends during playback. Once the whole data is
+   in RAM the handle is just not used by playback any more. */
+/* [24.1] Attach a preload buffer. Bytes [0, loaded) are already valid (e.g. kept in a cache);
+   the rest is loaded by stream_preload_step(). Nothing is read here. */
+bool stream_preload_attach(stream_t *s, uint8_t *mem, uint32_t size, uint32_t loaded) {
+    if (s->format == 3 || s->preload || !mem || size == 0) return false;
+    if (size > stream_data_bytes(s)) size = stream_data_bytes(s);
+    if (loaded > size) loaded = size;
+    stream_io_seek(s, &s->preload_io, s->data_offset + loaded);
+    s->preload_size = size;
+    audio_engine_lock();
+    s->preload = mem; /* Published together with the valid length */
+    s->preload_bytes = loaded;
+    audio_engine_unlock();
+    return true;
+}
+
+/* [25] Copy the next chunks. Each cartridge read runs with the mixer blocked, like the
+   index builder, because the mixer may be reading the same file. */
+void stream_preload_step(stream_t *s) {
+    if (!s->preload || stream_preload_done(s)) return;
+    for (int i = 0; i < STREAM_PRELOAD_CHUNKS_PER_STEP && s->preload_bytes < s->preload_size; i++) {
+        uint32_t n = s->preload_size - s->preload_bytes;
+        if (n > STREAM_PRELOAD_CHUNK) n = STREAM_PRELOAD_CHUNK;
+        audio_engine_lock();
+        int got = stream_io_read(s, &s->preload_io, s->preload + s->preload_bytes, (int)n);
+        if (got > 0) s->preload_bytes += (uint32_t)got;
+        audio_engine_unlock();
+        if (got != (int)n) {
+            s->preload_size = s->preload_bytes; /* Short file: keep what we have */
+            break;
+        }
+    }
+}
+
+bool stream_preload_done(const stream_t *s) {
+    return s->preload && s->preload_bytes >= s->preload_size;
+}
@@ -0,0 +1,234 @@
+/* [1] stream.h - Seekable playback stream over a WAV64 file (PCM, VADPCM, Opus) with a seek index. */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <libdragon.h>
+#include "arena.h"
+
+/* [2] Stream configuration */
+#define STREAM_INDEX_MAX_ENTRIES 512   /* Upper bound on seek index entries (memory cap) */
+#define STREAM_INDEX_MIN_INTERVAL_MS 250 /* Checkpoints are never closer than this */
+#define STREAM_INDEX_BUILD_US 1500     /* Time budget of one stream_index_step() call */
+#define STREAM_INDEX_BUILD_BATCH 32    /* VADPCM frames read per locked read while indexing */
+#define STREAM_SEEK_MAX_DECODE_MS 1000 /* Audio a seek may decode forward before it lands on a checkpoint */
+#define STREAM_VADPCM_MAX_CHANNELS 2
+#define STREAM_VADPCM_MAX_PREDICTORS 16
+#define STREAM_VADPCM_MAX_ORDER 2
+#define STREAM_OPUS_MAX_FRAME 2880     /* Largest Opus frame in samples (60 ms at 48 kHz): decode buffer */
+#define STREAM_OPUS_MAX_PACKET 1275    /* Largest valid Opus packet in bytes (checks the packet walk) */
+#define STREAM_OPUS_PREROLL_FRAMES 4   /* Frames decoded and dropped after restarting inside the track */
+#define STREAM_LOOP_MIN_SAMPLES 256    /* Shortest allowed A-B loop */
+#define STREAM_LOOP_STAGE_FRAMES 4     /* Opus frames the spare decoder advances per stream_loop_step() */
+#define STREAM_PRELOAD_CHUNK 16384     /* Bytes copied to RAM per locked read */
+#define STREAM_PRELOAD_CHUNKS_PER_STEP 4 /* Chunks per stream_preload_step() call */
+
+/* [3] Seek index entry: where a VADPCM frame starts and the decoder history needed to restart there.
+   Opus entries only use the offset (start of a packet). */
+typedef struct {
+    uint32_t offset;                                            /* Byte offset of the frame in the file */
+    int16_t hist[STREAM_VADPCM_MAX_CHANNELS][STREAM_VADPCM_MAX_ORDER]; /* Last decoded samples per channel */
+} stream_checkpoint_t;
+
+/* [3.0] What is known about a file before it is opened: the WAV64 header fields, the file size
+   and the loop region. Filled from the catalog, or by stream_open from the file itself. */
+typedef struct {
+    uint8_t format;        /* 0 = PCM, 1 = VADPCM, 3 = Opus */
+    uint8_t channels;
+    uint8_t bits;
+    uint32_t freq;         /* Sample rate */
+    uint32_t len;          /* Length in samples */
+    uint32_t data_offset;  /* Byte offset of the first sample */
+    uint32_t file_size;
+    uint32_t loop_start;   /* Loop region in samples (both 0 when the file does not loop) */
+    uint32_t loop_end;
+    uint32_t bitrate;      /* Average bits per second */
+} stream_info_t;
+
+/* [3.1] Cursor on the stream's file. Playback, the index builder and the preload each have one,
+   all over the same handle: the handle remembers which cursor it is positioned for, so changing
+   cursors costs one fseek. Bytes inside the RAM preload are copied from memory, the rest is read
+   from the cartridge, so a partial (prefix) preload works transparently. */
+typedef struct {
+    uint32_t off;  /* File offset of the next read */
+} stream_io_t;
+
+/* [3.2] One Opus decoder: a libdragon wav64 handle (decoder state and file position) and the last
+   frame it decoded. libdragon decodes whole frames; they are handed out from `frame` sample by sample. */
+typedef struct {
+    wav64_t *wav;
+    samplebuffer_t frame;  /* One decoded frame */
+    uint8_t *mem;          /* Its (uncached) memory */
+    uint32_t next;         /* Next frame the decoder will decode */
+    int avail;             /* Samples of `frame` not handed out yet */
+    bool reset;            /* Next decode restarts the decoder from sample 0 */
+} stream_opus_t;
+
+/* [4] Stream state. The mixer plays `wave`, which reads through this struct. */
+typedef struct {
+    wav64_t *wav;          /* libdragon handle (header info and Opus decoder) */
+    waveform_t wave;       /* Proxy waveform handed to the mixer */
+    uint8_t format;        /* 0 = PCM, 1 = VADPCM, 3 = Opus */
+    uint8_t channels;      /* Interleaved channels */
+    uint8_t bits;          /* Bits per output sample */
+    FILE *fp;              /* The stream's one cartridge handle (open until stream_close) */
+    const stream_io_t *fp_at; /* Cursor fp is positioned for, NULL when none */
+    stream_io_t io;        /* Playback reader (PCM/VADPCM) */
+    uint32_t data_offset;  /* Byte offset of the first sample */
+    uint32_t file_size;    /* Size of the file in bytes */
+    uint32_t bitrate;      /* Average bits per second */
+    uint32_t len;          /* Length in samples */
+    uint32_t pos;          /* Next sample the reader will produce */
+
+    /* [4.1] VADPCM decoder */
+    int order;
+    int npredictors;
+    int16_t codebook[STREAM_VADPCM_MAX_CHANNELS][STREAM_VADPCM_MAX_PREDICTORS][STREAM_VADPCM_MAX_ORDER][8];
+    int16_t hist[STREAM_VADPCM_MAX_CHANNELS][STREAM_VADPCM_MAX_ORDER];
+    int16_t frame_buf[16 * STREAM_VADPCM_MAX_CHANNELS]; /* Current decoded frame (interleaved) */
+    int frame_avail;       /* Samples left in frame_buf */
+    uint32_t dec_frame;    /* Next frame the decoder will read from fp */
+
+    /* [4.2] Seek index (VADPCM and Opus), built incrementally by stream_index_step() */
+    stream_checkpoint_t *index;
+    int index_count;       /* Entries built so far */
+    int index_total;       /* Entries needed for the whole file */
+    uint32_t index_interval; /* Frames between checkpoints */
+    uint32_t seek_max_frames; /* Frames a seek may decode (never less than one interval plus pre-roll) */
+    stream_io_t build_io;  /* Own cursor so indexing never moves the playback reader */
+    int16_t build_hist[STREAM_VADPCM_MAX_CHANNELS][STREAM_VADPCM_MAX_ORDER];
+    uint32_t build_frame;  /* Next frame (Opus: packet) the builder will read */
+    bool build_pad;        /* Opus: the walk assumes packets padded to an even length */
+    uint8_t build_tries;   /* Opus: packet layouts tried so far */
+
+    /* [4.3] Opus decoder */
+    stream_opus_t opus;
+    int opus_frame_size;   /* Samples per frame, measured at open */
+
+    /* [4.4] Playback position tracker: anchor + output samples mixed since the anchor */
+    uint64_t anchor_pos;   /* Track position at the anchor */
+    uint64_t anchor_mixed; /* audio_engine_get_samples_mixed() at the anchor */
+    uint32_t in_freq;      /* Waveform sample rate */
+    uint32_t out_freq;     /* Audio output sample rate */
+    bool running;          /* Position advances with mixed samples */
+    bool paused;           /* Channel stopped by stream_set_paused(); position frozen at anchor_pos */
+    bool seek_pending;     /* Next seeking read must restart at seek_target (not the float wpos) */
+    uint32_t seek_target;
+    uint32_t lead_silence; /* Silent samples to output before sample 0 (delayed start) */
+
+    /* [4.5] Looping, done inside stream_read so the wrap is sample-exact */
+    bool loop;             /* Loop between loop_start and loop_end */
+    uint32_t loop_start;   /* A point (inclusive), file_loop_start by default */
+    uint32_t loop_end;     /* B point (exclusive), file_loop_end by default */
+    uint32_t file_loop_start; /* Loop region of the file (whole file when it has none) */
+    uint32_t file_loop_end;
+    uint32_t loop_count;   /* Wraps done so far */
+    bool ended;            /* Non-looping stream reached the end (set from the mixer) */
+
+    /* [4.6] Seek statistics */
+    uint32_t last_seek_us; /* Duration of the last stream_seek() */
+    uint32_t max_seek_us;  /* Longest seek so far */
+    uint32_t seek_count;
+
+    /* [4.7] RAM preload of the sample data (all of it, or a prefix). PCM/VADPCM only:
+       Opus data is read by libdragon's own decoder. */
+    uint8_t *preload;                /* Copy of file bytes [data_offset, data_offset + preload_size) */
+    uint32_t preload_size;           /* Bytes to load */
+    volatile uint32_t preload_bytes; /* Bytes loaded so far; reads below this come from RAM */
+    stream_io_t preload_io;          /* Cursor of the load (next byte to copy) */
+
+    /* [4.8] Staged B -> A wrap. Moving a decoder to A can take a whole index interval, too long for
+       the mixer, so it is done beforehand by the main loop and the wrap only switches:
+       VADPCM restores the decoder state saved at A's frame, Opus swaps in a second decoder that
+       waits at A (the other one then moves to A for the next wrap). PCM wraps with a file seek. */
+    const char *path;                /* File name, for the second Opus handle */
+    volatile bool stage_ready;       /* The staged state is at stage_pos; the mixer may use it */
+    bool stage_busy;                 /* Opus: the spare decoder is on its way to stage_pos */
+    uint32_t stage_pos;              /* A point it was staged for */
+    stream_checkpoint_t stage_cp;    /* VADPCM: decoder state at the frame holding A */
+    stream_opus_t opus_spare;        /* Opus: decoder parked at A */
+    wav64_t spare_wav;               /* Opus: the second handle (either decoder may be using it) */
+    bool spare_open;
+} stream_t;
+
+/* [5] Open a stream over an already opened wav64. With `info` (catalog) the header is not read
+   again; without it the header and file size come from the file. The seek index is taken from
+   `arena`, which the caller resets when the stream is closed. Returns false on error. */
+bool stream_open(stream_t *s, wav64_t *wav, const char *filename, const stream_info_t *info, arena_id_t arena);
+
+/* [6] Close the stream (the index goes with its arena) */
+void stream_close(stream_t *s);
+
+/* [7] Start playback on a mixer channel from sample 0 */
+void stream_play(stream_t *s, int ch);
+
+/* [7.1] Start playback so that sample 0 is mixed exactly when audio_engine_get_samples_mixed()
+   reaches `start_mixed`; the channel plays silence until then. Sample-exact when the stream
+   rate equals the output rate. Used to splice tracks gaplessly on a second channel. */
+void stream_play_at(stream_t *s, int ch, uint64_t start_mixed);
+
+/* [8] Enable or disable looping (the file's loop region, or the A-B region when set) */
+void stream_set_loop(stream_t *s, bool loop);
+
+/* [8.1] A-B repeat: set (A inclusive, B exclusive) or clear the loop region (back to the file's) */
+bool stream_set_loop_points(stream_t *s, uint64_t a, uint64_t b);
+void stream_clear_loop_points(stream_t *s);
+
+/* [8.1.1] Prepare the next B -> A wrap outside the mix (Opus: a few frames of the
+   spare decoder per call). Call once per frame. */
+void stream_loop_step(stream_t *s);
+
+/* [8.2] Self-test hooks (src/selftest.c). Both move the reader: use them on a stream that is not
+   playing. stream_loop_check() compares the samples produced across B -> A with a fresh start at
+   A and returns STREAM_CHECK_OK, the first sample after A that differs, or a negative reason. */
+#define STREAM_CHECK_OK (-1)
+#define STREAM_CHECK_SKIPPED (-2)  /* Region too short for the check window, or no memory */
+#define STREAM_CHECK_UNSTAGED (-3) /* The wrap could not be staged at A */
+#define STREAM_CHECK_PRE 64        /* Samples checked before B */
+#define STREAM_CHECK_POST 256      /* Samples checked after the wrap */
+int stream_loop_check(stream_t *s, uint64_t a, uint64_t b);
+
+/* [8.3] Decode n samples from `pos` into `out` (interleaved, uncached memory, room for n samples):
+   sequential when the reader is already at `pos`, otherwise an exact reposition. Returns the
+   samples produced (fewer at the end of the track). */
+int stream_read_at(stream_t *s, uint32_t pos, void *out, int n);
+
+/* [9] Jump to a sample position. Works while playing or stopped; updates the seek statistics.
+   Returns the position it landed on: `sample`, or the nearest checkpoint before it when the
+   index does not reach that far yet. */
+uint64_t stream_seek(stream_t *s, int ch, uint64_t sample);
+
+/* [9.1] Stop playback, keeping the current position */
+void stream_stop(stream_t *s, int ch);
+
+/* [9.1.1] Pause/resume in place on channel ch. Pausing stops the channel and freezes the position
+   at the output clock; the reader is moved back to that sample, so samples dropped by
+   audio_engine_flush() or buffered by the mixer are played again on resume. A delayed start
+   (gapless splice) keeps the rest of its delay. */
+void stream_set_paused(stream_t *s, int ch, bool paused);
+
+/* [9.2] Sample-accurate playback position (64-bit, exact for any track length) */
+uint64_t stream_get_position(const stream_t *s);
+
+/* [10] Build part of the seek index, for at most STREAM_INDEX_BUILD_US. Call once per frame until
+   stream_index_done() returns true. The Opus index is only used once the whole file has been
+   walked and its layout checked. Until the index reaches a seek target, a seek that would decode
+   more than seek_max_frames lands on the nearest checkpoint before it instead (stream_seek). */
+void stream_index_step(stream_t *s);
+bool stream_index_done(const stream_t *s);
+int stream_index_percent(const stream_t *s);
+
+/* [11] Memory used by the seek index in bytes */
+int stream_index_bytes(const stream_t *s);
+
+/* [12] Bytes of sample data in the file (what a full preload needs) */
+uint32_t stream_data_bytes(const stream_t *s);
+
+/* [13] Play from a RAM copy of the first `size` bytes of sample data, owned by the caller (kept
+   until stream_close). Bytes [0, loaded) must already be valid. Returns false for Opus. */
+bool stream_preload_attach(stream_t *s, uint8_t *mem, uint32_t size, uint32_t loaded);
+
+/* [13.1] Copy the next chunks. Call once per frame; reads use RAM as soon as bytes arrive.
+   The cartridge handle stays open until stream_close, so finishing does not free memory. */
+void stream_preload_step(stream_t *s);
+bool stream_preload_done(const stream_t *s);
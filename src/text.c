@@ -0,0 +1,136 @@
+/* [1] text.c - Batched bitmap-font text on the RDP (see text.h) */
+#include "text.h"
+#include "utils.h" /* [2] fast_memset */
+#include "mem.h"   /* [2.1] Atlas memory */
+
+#define TEXT_ATLAS_ROWS ((128 - TEXT_FIRST_CHAR + TEXT_ATLAS_COLS - 1) / TEXT_ATLAS_COLS)
+
+/* [3] One glyph rectangle: screen position and atlas position */
+typedef struct {
+    int16_t x0, y0;
+    int16_t s, t;
+} text_glyph_t;
+
+/* [4] One string. Slot k of this frame is compared with slot k of the last frame, so an
+   immediate-mode UI that draws the same lines in the same order hits the cache every frame. */
+typedef struct {
+    char str[TEXT_RUN_MAX_CHARS + 1];
+    int16_t x, y;
+    color_t color;
+    uint16_t count; /* Glyphs laid out (spaces take none) */
+    bool valid;
+} text_run_t;
+
+static surface_t atlas;
+static bool atlas_ready = false;
+static text_run_t runs[TEXT_MAX_RUNS];
+static text_glyph_t glyphs[TEXT_MAX_RUNS][TEXT_RUN_MAX_CHARS];
+static int run_count = 0; /* Slots used this frame */
+static int flushed = 0;   /* Slots already drawn */
+static text_stats_t cur, last;
+
+/* [5] Draw the CPU font once into a 16 bpp scratch surface and pack it as I4 (0 or 15) */
+bool text_init(void) {
+    if (atlas_ready) return true;
+    const int w = TEXT_ATLAS_COLS * TEXT_GLYPH_W;
+    const int h = TEXT_ATLAS_ROWS * TEXT_GLYPH_H;
+    surface_t tmp = surface_alloc(FMT_RGBA16, w, h);
+    if (!tmp.buffer) return false;
+    atlas = surface_alloc(FMT_I4, w, h);
+    if (!atlas.buffer) { surface_free(&tmp); return false; }
+
+    fast_memset(tmp.buffer, 0, (size_t)tmp.stride * h);
+    graphics_set_color(0xFFFFFFFF, 0);
+    for (int c = TEXT_FIRST_CHAR; c < 128; c++) {
+        int i = c - TEXT_FIRST_CHAR;
+        graphics_draw_character(&tmp, (i % TEXT_ATLAS_COLS) * TEXT_GLYPH_W, (i / TEXT_ATLAS_COLS) * TEXT_GLYPH_H, (char)c);
+    }
+    for (int y = 0; y < h; y++) {
+        const uint16_t *src = (const uint16_t *)((const uint8_t *)tmp.buffer + y * tmp.stride);
+        uint8_t *dst = (uint8_t *)atlas.buffer + y * atlas.stride;
+        for (int x = 0; x < w; x += 2)
+            dst[x / 2] = (uint8_t)((src[x] ? 0xF0 : 0x00) | (src[x + 1] ? 0x0F : 0x00));
+    }
+    surface_free(&tmp);
+    mem_account(MEM_UI, (int32_t)(atlas.stride * h));
+    atlas_ready = true;
+    return true;
+}
+
+bool text_ready(void) { return atlas_ready; }
+
+/* [6] New frame: publish the counters, restart the slot order */
+void text_frame_begin(void) {
+    last = cur;
+    cur = (text_stats_t){ 0 };
+    run_count = 0;
+    flushed = 0;
+}
+
+/* [7] Queue a string. Copying and comparing with last frame's string is one loop. */
+void text_queue(int x, int y, const char *s, color_t color) {
+    if (!atlas_ready || !s || run_count >= TEXT_MAX_RUNS) return;
+    text_run_t *r = &runs[run_count];
+    text_glyph_t *g = glyphs[run_count];
+    run_count++;
+    cur.runs++;
+    r->color = color;
+
+    bool same = r->valid && r->x == x && r->y == y;
+    int n;
+    for (n = 0; n < TEXT_RUN_MAX_CHARS && s[n]; n++) {
+        if (r->str[n] != s[n]) { same = false; r->str[n] = s[n]; }
+    }
+    if (r->str[n] != '\0') { same = false; r->str[n] = '\0'; }
+    if (same) { cur.reused++; return; }
+
+    /* [7.1] Layout: one rectangle per visible glyph */
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == ' ') continue;
+        if (c < TEXT_FIRST_CHAR || c > 127) c = '?';
+        int idx = c - TEXT_FIRST_CHAR;
+        g[count].x0 = (int16_t)(x + i * TEXT_GLYPH_W);
+        g[count].y0 = (int16_t)y;
+        g[count].s = (int16_t)((idx % TEXT_ATLAS_COLS) * TEXT_GLYPH_W);
+        g[count].t = (int16_t)((idx / TEXT_ATLAS_COLS) * TEXT_GLYPH_H);
+        count++;
+    }
+    r->x = (int16_t)x;
+    r->y = (int16_t)y;
+    r->count = (uint16_t)count;
+    r->valid = true;
+}
+
+/* [8] Draw everything queued since the last flush: color = PRIM, alpha = atlas texel,
+   alpha compare drops the background texels */
+void text_flush(void) {
+    if (flushed >= run_count) return;
+    rdpq_set_mode_standard();
+    rdpq_mode_combiner(RDPQ_COMBINER1((0,0,0,PRIM), (0,0,0,TEX0)));
+    rdpq_mode_alphacompare(1);
+    rdpq_tex_upload(TILE0, &atlas, NULL);
+    uint32_t prim = 0;
+    bool prim_set = false;
+    for (int k = flushed; k < run_count; k++) {
+        const text_run_t *r = &runs[k];
+        uint32_t c = color_to_packed32(r->color);
+        if (!prim_set || c != prim) {
+            rdpq_set_prim_color(r->color);
+            prim = c;
+            prim_set = true;
+        }
+        const text_glyph_t *g = glyphs[k];
+        for (int i = 0; i < r->count; i++) {
+            rdpq_texture_rectangle(TILE0, g[i].x0, g[i].y0, g[i].x0 + TEXT_GLYPH_W, g[i].y0 + TEXT_GLYPH_H, g[i].s, g[i].t);
+        }
+        cur.glyphs += r->count;
+    }
+    cur.flushes++;
+    flushed = run_count;
+}
+
+void text_get_stats(text_stats_t *out) {
+    if (out) *out = last;
+}
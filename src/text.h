@@ -0,0 +1,35 @@
+/* [1] text.h - Batched bitmap-font text for the RDP. The 8x8 font is turned into one small I4
+   atlas at init (96 glyphs, 3 KB, fits TMEM whole). Strings are queued during the frame and
+   drawn together: one mode setup and one atlas upload per flush, then one textured rectangle
+   per glyph. Strings that did not change since the last frame reuse their laid-out glyphs. */
+#pragma once
+#include <libdragon.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TEXT_MAX_RUNS 64        /* [2] Strings per frame */
+#define TEXT_RUN_MAX_CHARS 80   /* Longer strings are cut (80 columns fill a 640 pixel screen) */
+#define TEXT_GLYPH_W 8
+#define TEXT_GLYPH_H 8
+#define TEXT_FIRST_CHAR 32      /* Atlas covers ' ' .. 127, anything else is drawn as '?' */
+#define TEXT_ATLAS_COLS 16
+
+/* [3] Counters of the last finished frame */
+typedef struct {
+    uint32_t runs;    /* Strings queued */
+    uint32_t reused;  /* Strings whose layout came from the cache */
+    uint32_t glyphs;  /* Rectangles sent to the RDP */
+    uint32_t flushes; /* Batches (mode setup + atlas upload) */
+} text_stats_t;
+
+/* [4] Build the atlas. Returns false when there is no memory (callers keep direct text). */
+bool text_init(void);
+bool text_ready(void);
+
+/* [5] Frame: text_frame_begin() once per frame, text_queue() for every string,
+   text_flush() draws everything queued so far (needs an rdpq-attached surface) */
+void text_frame_begin(void);
+void text_queue(int x, int y, const char *s, color_t color);
+void text_flush(void);
+
+void text_get_stats(text_stats_t *out);
@@ -0,0 +1,125 @@
+/* [1] track_cache.c - LRU cache of raw track bytes. Entries pinned by an open stream are never
+   evicted; everything else goes oldest-first when a new track needs room. */
+#include "track_cache.h"
+#include <stdlib.h>
+#include "mem.h" /* [1.1] Cached tracks are assets */
+
+/* [2] One cached track */
+typedef struct {
+    int key;           /* Playlist index, -1 when the slot is free */
+    uint8_t *mem;
+    uint32_t size;     /* Bytes allocated */
+    uint32_t valid;    /* Bytes loaded so far (a partial load resumes where it stopped) */
+    int pins;          /* Open streams using the buffer */
+    uint32_t last_use; /* LRU clock value of the last acquire */
+} track_cache_entry_t;
+
+static track_cache_entry_t entries[TRACK_CACHE_MAX_ENTRIES];
+static uint32_t lru_clock = 0;
+static track_cache_stats_t stats;
+static bool initialized = false;
+
+/* [3] Drop one entry */
+static void track_cache_evict(track_cache_entry_t *e) {
+    free(e->mem);
+    mem_account(MEM_ASSETS, -(int32_t)e->size);
+    stats.used -= e->size;
+    stats.entries--;
+    stats.evictions++;
+    e->mem = NULL;
+    e->key = -1;
+    e->size = e->valid = 0;
+}
+
+/* [4] Least recently used entry that no stream is using, or NULL */
+static track_cache_entry_t *track_cache_victim(void) {
+    track_cache_entry_t *v = NULL;
+    for (int i = 0; i < TRACK_CACHE_MAX_ENTRIES; i++) {
+        track_cache_entry_t *e = &entries[i];
+        if (e->key < 0 || e->pins > 0) continue;
+        if (!v || e->last_use < v->last_use) v = e;
+    }
+    return v;
+}
+
+static track_cache_entry_t *track_cache_find(int key) {
+    for (int i = 0; i < TRACK_CACHE_MAX_ENTRIES; i++)
+        if (entries[i].key == key) return &entries[i];
+    return NULL;
+}
+
+/* [5] Set the budget */
+void track_cache_init(uint32_t budget_bytes) {
+    if (!initialized) {
+        for (int i = 0; i < TRACK_CACHE_MAX_ENTRIES; i++) entries[i].key = -1;
+        initialized = true;
+    }
+    stats.budget = budget_bytes;
+    track_cache_entry_t *v;
+    while (stats.used > stats.budget && (v = track_cache_victim()) != NULL) track_cache_evict(v);
+}
+
+/* [6] Look up or allocate */
+uint8_t *track_cache_acquire(int key, uint32_t size, bool alloc, uint32_t *valid) {
+    if (!initialized || stats.budget == 0) return NULL;
+    track_cache_entry_t *e = track_cache_find(key);
+    if (e && e->size != size) {
+        /* [6.1] Same track asked with another size (budget changed): start over */
+        if (e->pins > 0) return NULL;
+        track_cache_evict(e);
+        e = NULL;
+    }
+    if (e) {
+        e->pins++;
+        e->last_use = ++lru_clock;
+        stats.hits++;
+        if (valid) *valid = e->valid;
+        return e->mem;
+    }
+    if (!alloc || size > stats.budget) return NULL;
+
+    /* [6.2] Make room in the budget, then in the entry table, then in the heap */
+    stats.misses++;
+    track_cache_entry_t *v;
+    while (stats.used + size > stats.budget) {
+        if ((v = track_cache_victim()) == NULL) return NULL;
+        track_cache_evict(v);
+    }
+    e = track_cache_find(-1);
+    if (!e) {
+        if ((v = track_cache_victim()) == NULL) return NULL;
+        track_cache_evict(v);
+        e = v;
+    }
+    uint8_t *mem = (uint8_t *)malloc(size);
+    while (!mem && (v = track_cache_victim()) != NULL) {
+        track_cache_evict(v);
+        mem = (uint8_t *)malloc(size);
+    }
+    if (!mem) return NULL;
+    mem_account(MEM_ASSETS, (int32_t)size);
+
+    e->key = key;
+    e->mem = mem;
+    e->size = size;
+    e->valid = 0;
+    e->pins = 1;
+    e->last_use = ++lru_clock;
+    stats.used += size;
+    stats.entries++;
+    if (valid) *valid = 0;
+    return mem;
+}
+
+/* [7] Unpin */
+void track_cache_release(int key, uint32_t valid) {
+    track_cache_entry_t *e = track_cache_find(key);
+    if (!e || e->pins == 0) return;
+    e->pins--;
+    if (valid > e->valid) e->valid = (valid > e->size) ? e->size : valid;
+}
+
+/* [8] Statistics */
+void track_cache_get_stats(track_cache_stats_t *out) {
+    if (out) *out = stats;
+}
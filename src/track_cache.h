@@ -0,0 +1,31 @@
+/* [1] track_cache.h - Memory-budgeted LRU cache of track sample data kept in RAM,
+   so going back to a recently played track does not read the cartridge again. */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACK_CACHE_MAX_ENTRIES 16 /* [2] Upper bound on cached tracks */
+
+/* [3] Counters for tuning the budget */
+typedef struct {
+    uint32_t hits;      /* Lookups that found data for the track */
+    uint32_t misses;    /* Lookups that had to allocate (data comes from the cartridge) */
+    uint32_t evictions; /* Entries dropped to make room */
+    uint32_t entries;   /* Tracks currently cached */
+    uint32_t used;      /* Bytes in use */
+    uint32_t budget;    /* Byte budget */
+} track_cache_stats_t;
+
+/* [4] Set the byte budget (0 disables the cache). Frees everything that is not in use. */
+void track_cache_init(uint32_t budget_bytes);
+
+/* [5] Get the buffer for `key` (a playlist index) and pin it. `*valid` receives the bytes that
+   are already loaded. When the key is not cached and `alloc` is set, a new buffer of `size`
+   bytes is made, evicting least recently used unpinned entries; otherwise returns NULL. */
+uint8_t *track_cache_acquire(int key, uint32_t size, bool alloc, uint32_t *valid);
+
+/* [6] Unpin the buffer and record how many bytes were loaded into it */
+void track_cache_release(int key, uint32_t valid);
+
+/* [7] Statistics */
+void track_cache_get_stats(track_cache_stats_t *out);
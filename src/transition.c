@@ -0,0 +1,283 @@
+/* [1] transition.c - Hands playback from one track to the next on two mixer channels.
+   Crossfade volumes are set from the mixer once per buffer (pre-mix hook), so the
+   fade follows the audio clock and not the UI frame rate. A gapless splice starts the next
+   track on the second channel with a delayed start that lands on the sample after the old
+   track's last one. */
+#include "transition.h"
+#include "audio_engine.h" /* [2] lock, mix hook, mix cost counters */
+#include <math.h>
+#include <libdragon.h>
+
+/* [3] Settings */
+static int channels[2] = { 0, 1 };
+static int cur = 0; /* Index into channels[] of the current track */
+static transition_mode_t mode = TRANSITION_CROSSFADE;
+static transition_curve_t curve = TRANSITION_CURVE_EQUAL_POWER;
+static uint32_t length_ms = TRANSITION_DEFAULT_MS;
+static volatile float volume = TRANSITION_DEFAULT_VOLUME;
+
+/* [4] Fade-in gain tables, filled once at init (no sinf/sqrtf inside the mix) */
+static float curve_tab[TRANSITION_CURVE_COUNT][TRANSITION_CURVE_STEPS + 1];
+
+/* [5] Overlap state. The fade fields are read by the mixer; change them under the lock. */
+static volatile bool fading = false;
+static uint64_t fade_start = 0;     /* Output sample where the fade starts */
+static uint64_t fade_len = 1;       /* Fade length in output samples */
+static int fade_in_ch = 0, fade_out_ch = 0;
+static bool overlap = false;        /* Two tracks are playing */
+static uint64_t overlap_end = 0;    /* Output sample after which the old track is silent */
+static playlist_track_t *outgoing = NULL;
+static int outgoing_ch = 0;
+static bool paused = false;
+static uint64_t pause_mixed = 0;    /* Output clock when the pause started (after the flush) */
+
+/* [6] Mixer cost snapshots */
+static uint64_t base_ticks = 0, ov_ticks = 0;
+static uint32_t base_bufs = 0, ov_bufs = 0;
+static transition_stats_t stats;
+
+/* [7] Interpolated gain of the selected curve, t in [0, 1] */
+static float curve_gain(float t) {
+    if (t <= 0.0f) return 0.0f;
+    if (t >= 1.0f) return 1.0f;
+    float x = t * (float)TRANSITION_CURVE_STEPS;
+    int i = (int)x;
+    float frac = x - (float)i;
+    const float *tab = curve_tab[curve];
+    return tab[i] + (tab[i + 1] - tab[i]) * frac;
+}
+
+/* [8] Pre-mix hook (runs inside mixer_poll): gains for the buffer about to be mixed, taken at its middle */
+static void transition_mix_hook(uint64_t samples_mixed, int numsamples) {
+    if (!fading) return;
+    uint64_t mid = samples_mixed + (uint64_t)(numsamples / 2);
+    float t = 0.0f;
+    if (mid > fade_start) t = (mid - fade_start >= fade_len) ? 1.0f : (float)(mid - fade_start) / (float)fade_len;
+    float g_in = curve_gain(t);
+    float g_out = curve_gain(1.0f - t);
+    mixer_ch_set_vol(fade_in_ch, volume * g_in, volume * g_in);
+    mixer_ch_set_vol(fade_out_ch, volume * g_out, volume * g_out);
+}
+
+/* [9] Average ticks per buffer between two snapshots, in microseconds */
+static uint32_t mix_avg_us(uint64_t ticks, uint32_t bufs) {
+    if (bufs == 0) return 0;
+    return (uint32_t)TICKS_TO_US(ticks / bufs);
+}
+
+/* [10] Output samples until a non-looping stream plays its last sample (UINT64_MAX when looping) */
+static uint64_t transition_remaining(const stream_t *s) {
+    if (s->loop) return UINT64_MAX;
+    uint64_t pos = stream_get_position(s);
+    if (pos >= s->len) return 0;
+    uint64_t r = s->len - pos;
+    if (s->in_freq && s->out_freq && s->in_freq != s->out_freq) r = r * s->out_freq / s->in_freq;
+    return r;
+}
+
+static uint64_t ms_to_samples(uint32_t ms) {
+    return (uint64_t)ms * (uint64_t)audio_get_frequency() / 1000ULL;
+}
+
+/* [11] Use channels first_ch and first_ch + 1 */
+void transition_init(int first_ch) {
+    channels[0] = first_ch;
+    channels[1] = first_ch + 1;
+    cur = 0;
+    for (int i = 0; i <= TRANSITION_CURVE_STEPS; i++) {
+        float t = (float)i / (float)TRANSITION_CURVE_STEPS;
+        curve_tab[TRANSITION_CURVE_EQUAL_POWER][i] = sinf(t * (float)M_PI * 0.5f);
+        curve_tab[TRANSITION_CURVE_SQRT][i] = sqrtf(t);
+        curve_tab[TRANSITION_CURVE_LINEAR][i] = t;
+    }
+    stats.buffer_us = audio_engine_get_buffer_us();
+    audio_engine_get_mix_cost(&base_ticks, &base_bufs, NULL);
+    audio_engine_set_mix_hook(transition_mix_hook);
+}
+
+/* [12] Settings */
+void transition_set_mode(transition_mode_t m) { if (m >= 0 && m < TRANSITION_MODE_COUNT) mode = m; }
+transition_mode_t transition_get_mode(void) { return mode; }
+void transition_set_curve(transition_curve_t c) { if (c >= 0 && c < TRANSITION_CURVE_COUNT) curve = c; }
+transition_curve_t transition_get_curve(void) { return curve; }
+
+const char *transition_mode_name(transition_mode_t m) {
+    switch (m) {
+        case TRANSITION_CUT: return "Cut";
+        case TRANSITION_CROSSFADE: return "Crossfade";
+        case TRANSITION_GAPLESS: return "Gapless";
+        default: return "?";
+    }
+}
+
+const char *transition_curve_name(transition_curve_t c) {
+    switch (c) {
+        case TRANSITION_CURVE_EQUAL_POWER: return "Equal power";
+        case TRANSITION_CURVE_SQRT: return "Sqrt";
+        case TRANSITION_CURVE_LINEAR: return "Linear";
+        default: return "?";
+    }
+}
+
+void transition_set_length_ms(uint32_t ms) {
+    if (ms < TRANSITION_MIN_MS) ms = TRANSITION_MIN_MS;
+    if (ms > TRANSITION_MAX_MS) ms = TRANSITION_MAX_MS;
+    length_ms = ms;
+}
+
+uint32_t transition_get_length_ms(void) { return length_ms; }
+
+/* [13] Master volume. During a fade the hook applies it on the next buffer. */
+void transition_set_volume(float v) {
+    audio_engine_lock();
+    volume = v;
+    if (!fading) mixer_ch_set_vol(channels[cur], v, v);
+    audio_engine_unlock();
+}
+
+int transition_channel(void) { return channels[cur]; }
+bool transition_active(void) { return overlap; }
+
+/* [14] Start an overlap: `old` keeps playing on its channel, the (already current) new track
+   starts on the other one, either fading in now or spliced at the old track's end. */
+static void transition_begin(playlist_track_t *old, bool gapless) {
+    playlist_track_t *next = playlist_current();
+    int out_ch = channels[cur];
+    int in_ch = channels[cur ^ 1];
+
+    /* [14.1] Close the single-track measurement window and open the overlap one */
+    uint64_t t; uint32_t b;
+    audio_engine_get_mix_cost(&t, &b, NULL);
+    stats.base_mix_us = mix_avg_us(t - base_ticks, b - base_bufs);
+    ov_ticks = t; ov_bufs = b;
+    audio_engine_reset_mix_max();
+
+    /* [14.2] Everything below must see one consistent audio clock */
+    audio_engine_lock();
+    uint64_t now = audio_engine_get_samples_mixed();
+    uint64_t remaining = transition_remaining(&old->stream);
+    if (gapless) {
+        mixer_ch_set_vol(in_ch, volume, volume);
+        stream_play_at(&next->stream, in_ch, now + remaining);
+        overlap_end = now + remaining;
+    } else {
+        uint64_t len = ms_to_samples(length_ms);
+        if (len > remaining) len = remaining;
+        if (len == 0) len = 1;
+        mixer_ch_set_vol(in_ch, 0.0f, 0.0f);
+        stream_play(&next->stream, in_ch);
+        fade_start = now;
+        fade_len = len;
+        fade_in_ch = in_ch;
+        fade_out_ch = out_ch;
+        fading = true;
+        overlap_end = now + len;
+    }
+    audio_engine_unlock();
+
+    outgoing = old;
+    outgoing_ch = out_ch;
+    cur ^= 1;
+    overlap = true;
+}
+
+/* [15] End the overlap: old track stopped, new track at full volume, cost recorded */
+void transition_finish(void) {
+    if (!overlap) return;
+    audio_engine_lock();
+    fading = false;
+    mixer_ch_set_vol(channels[cur], volume, volume);
+    audio_engine_unlock();
+    stream_stop(&outgoing->stream, outgoing_ch);
+
+    uint64_t t; uint32_t b, max_ticks;
+    audio_engine_get_mix_cost(&t, &b, &max_ticks);
+    stats.overlap_mix_us = mix_avg_us(t - ov_ticks, b - ov_bufs);
+    stats.overlap_peak_us = (uint32_t)TICKS_TO_US(max_ticks);
+    stats.transitions++;
+    base_ticks = t; base_bufs = b;
+    overlap = false;
+    outgoing = NULL;
+}
+
+/* [15.1] Pause/resume both tracks on one audio clock. The polled mixer runs on this thread,
+   so nothing is mixed between the two streams freezing. */
+void transition_set_paused(bool p) {
+    if (p == paused) return;
+    playlist_track_t *t = playlist_current();
+    if (p) {
+        audio_engine_flush();
+        audio_engine_lock();
+        pause_mixed = audio_engine_get_samples_mixed();
+        stream_set_paused(&t->stream, channels[cur], true);
+        if (overlap) stream_set_paused(&outgoing->stream, outgoing_ch, true);
+        audio_engine_unlock();
+    } else {
+        audio_engine_lock();
+        uint64_t shift = audio_engine_get_samples_mixed() - pause_mixed;
+        fade_start += shift;
+        overlap_end += shift;
+        if (overlap) stream_set_paused(&outgoing->stream, outgoing_ch, false);
+        stream_set_paused(&t->stream, channels[cur], false);
+        audio_engine_unlock();
+    }
+    paused = p;
+}
+
+bool transition_is_paused(void) { return paused; }
+
+/* [16] Manual switch */
+playlist_track_t *transition_switch(int dir) {
+    transition_set_paused(false);
+    transition_finish();
+    uint32_t t0 = timer_ticks();
+    playlist_track_t *old = playlist_current();
+    if (mode == TRANSITION_CROSSFADE && old->stream.running) {
+        if (playlist_advance(dir) != old) transition_begin(old, false);
+    } else {
+        playlist_switch(dir, channels[cur]);
+        transition_set_volume(volume);
+    }
+    stats.last_start_us = (uint32_t)TICKS_TO_US(timer_ticks() - t0);
+    return playlist_current();
+}
+
+/* [17] Per-frame update */
+bool transition_update(void) {
+    if (paused) return false; /* The output clock runs on while paused, the tracks do not */
+    if (overlap) {
+        if (audio_engine_get_samples_mixed() >= overlap_end) transition_finish();
+        return false;
+    }
+    playlist_track_t *old = playlist_current();
+    stream_t *s = &old->stream;
+    if (!s->running || s->loop) return false;
+    if (playlist_index() + 1 >= playlist_count()) return false; /* Last track: main loop shows "End" */
+
+    uint64_t remaining = transition_remaining(s);
+    uint64_t lead = 0;
+    if (mode == TRANSITION_CROSSFADE) lead = ms_to_samples(length_ms);
+    else if (mode == TRANSITION_GAPLESS) lead = ms_to_samples(TRANSITION_GAPLESS_ARM_MS);
+    if (remaining > lead) return false;
+
+    uint32_t t0 = timer_ticks();
+    if (mode == TRANSITION_CUT) {
+        playlist_switch(+1, channels[cur]);
+        transition_set_volume(volume);
+    } else if (playlist_advance(+1) != old) {
+        transition_begin(old, mode == TRANSITION_GAPLESS);
+    }
+    stats.last_start_us = (uint32_t)TICKS_TO_US(timer_ticks() - t0);
+    return true;
+}
+
+/* [18] Statistics. Outside an overlap the base cost is the live average since the last one. */
+void transition_get_stats(transition_stats_t *out) {
+    if (!out) return;
+    if (!overlap) {
+        uint64_t t; uint32_t b;
+        audio_engine_get_mix_cost(&t, &b, NULL);
+        if (b - base_bufs >= 16) stats.base_mix_us = mix_avg_us(t - base_ticks, b - base_bufs);
+    }
+    *out = stats;
+}
@@ -0,0 +1,84 @@
+/* [1] transition.h - Track transitions on two mixer channels: cut, crossfade or gapless splice. */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "playlist.h"
+
+/* [2] Transition configuration */
+#define TRANSITION_DEFAULT_MS 3000    /* Default crossfade length */
+#define TRANSITION_MIN_MS 500
+#define TRANSITION_MAX_MS 10000
+#define TRANSITION_GAPLESS_ARM_MS 500 /* Gapless: start the next track this long before the end */
+#define TRANSITION_CURVE_STEPS 64     /* Gain table resolution */
+#define TRANSITION_DEFAULT_VOLUME 1.0f /* Master volume at boot (the player starts from the same value) */
+
+/* [3] How one track hands over to the next */
+typedef enum {
+    TRANSITION_CUT = 0,   /* Stop the old track, start the new one */
+    TRANSITION_CROSSFADE, /* Both tracks play while the volumes cross */
+    TRANSITION_GAPLESS,   /* Next track starts on the sample after the last one of the old track */
+    TRANSITION_MODE_COUNT
+} transition_mode_t;
+
+/* [4] Crossfade gain curves. Fade-out gain is always the fade-in gain mirrored in time. */
+typedef enum {
+    TRANSITION_CURVE_EQUAL_POWER = 0, /* sin/cos: constant power, the usual choice for music */
+    TRANSITION_CURVE_SQRT,            /* sqrt(t): constant power, faster start */
+    TRANSITION_CURVE_LINEAR,          /* Constant amplitude: dips in the middle for unrelated tracks */
+    TRANSITION_CURVE_COUNT
+} transition_curve_t;
+
+/* [5] Mixer cost measured around the overlap (all values in microseconds per audio buffer) */
+typedef struct {
+    uint32_t transitions;     /* Overlapping transitions completed */
+    uint32_t base_mix_us;     /* Average mixer_poll time with one track, before the last overlap */
+    uint32_t overlap_mix_us;  /* Average mixer_poll time during the last overlap */
+    uint32_t overlap_peak_us; /* Worst single buffer during the last overlap */
+    uint32_t buffer_us;       /* Duration of one audio buffer: a mix must always finish inside it */
+    uint32_t last_start_us;   /* Main-loop time spent starting the last transition */
+} transition_stats_t;
+
+/* [6] Use channels first_ch and first_ch + 1. Call after audio_engine_init. */
+void transition_init(int first_ch);
+
+/* [7] Settings */
+void transition_set_mode(transition_mode_t mode);
+transition_mode_t transition_get_mode(void);
+const char *transition_mode_name(transition_mode_t mode);
+void transition_set_curve(transition_curve_t curve);
+transition_curve_t transition_get_curve(void);
+const char *transition_curve_name(transition_curve_t curve);
+void transition_set_length_ms(uint32_t ms);
+uint32_t transition_get_length_ms(void);
+
+/* [8] Master volume for the current track (fades are applied on top of it) */
+void transition_set_volume(float volume);
+
+/* [9] Channel of the current track. Changes after each overlapping transition. */
+int transition_channel(void);
+
+/* [10] True while two tracks are playing */
+bool transition_active(void);
+
+/* [11] Manual switch to the next/previous track: crossfades in CROSSFADE mode, cuts otherwise.
+   Returns the new current track. */
+playlist_track_t *transition_switch(int dir);
+
+/* [12] Call once per frame. Starts automatic transitions near the end of a non-looping track
+   (never after the last track) and stops the old track when an overlap is over.
+   Returns true when the current track changed. */
+bool transition_update(void);
+
+/* [13] End any overlap now: stop the old track, full volume on the new one */
+void transition_finish(void);
+
+/* [13.1] Pause/resume the current track, and the outgoing one during an overlap. The buffers
+   still queued for output are dropped, so the pause is heard after the buffer being played and
+   at most one more. Both tracks of a crossfade or gapless splice freeze at the same output
+   sample: on resume the fade (or the splice point) goes on from where it stopped, shifted by
+   the time spent paused. No transition starts or finishes while paused; a track switch resumes. */
+void transition_set_paused(bool paused);
+bool transition_is_paused(void);
+
+/* [14] Overlap cost statistics */
+void transition_get_stats(transition_stats_t *out);
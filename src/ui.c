@@ -0,0 +1,296 @@
+/* [1] ui.c - Retained-mode screen on top of the gfx drawing layer (see ui.h) */
+#include "ui.h"
+#include "gfx.h"   /* [2] Drawing (RDP or CPU) */
+#include "video.h" /* [2.1] Pool memory for the background surface, frame acquisition */
+
+/* [3] Screen rectangle (w == 0: empty) */
+typedef struct {
+    int16_t x, y, w, h;
+} ui_rect_t;
+
+typedef enum { UI_NONE = 0, UI_TEXT, UI_HBAR, UI_VBAR, UI_BOX } ui_kind_t;
+
+/* [5] One widget: what it shows now, and what every framebuffer shows */
+typedef struct {
+    ui_kind_t kind;
+    bool visible;
+    ui_rect_t rect;
+    uint32_t color[3];
+    uint32_t fill;                     /* Bars: filled pixels */
+    char text[UI_TEXT_MAX + 1];
+    uint8_t len;
+    uint32_t key;                      /* ui_changed() input key */
+    bool has_key;
+    uint8_t dirty;                     /* Bit b: buffer b shows an older state */
+    ui_rect_t drawn[UI_MAX_BUFFERS];   /* Area the widget covers in buffer b */
+} ui_widget_t;
+
+static ui_widget_t widgets[UI_MAX_WIDGETS];
+static void (*static_fn)(void) = NULL;
+static bool retained = true;
+
+/* [6] Background surface with the static content, on the video pool memory */
+static surface_t bg;
+static bool bg_ready = false;
+static bool bg_failed = false;          /* No pool memory: every frame is a full redraw */
+
+/* [7] Framebuffers seen so far, identified by their pixel memory */
+static void *buffers[UI_MAX_BUFFERS];
+static int buffer_count = 0;
+static uint8_t full_mask = 0xFF;        /* Bit b: buffer b needs a full redraw */
+
+static ui_stats_t stats;
+static bool busy = false;               /* Last ui_frame_begin() found no free framebuffer */
+static uint32_t win_frames = 0, win_skipped = 0;
+
+/* [8] Rectangle helpers */
+static bool rect_empty(const ui_rect_t *r) { return r->w <= 0 || r->h <= 0; }
+
+static bool rect_overlap(const ui_rect_t *a, const ui_rect_t *b) {
+    return a->x < b->x + b->w && b->x < a->x + a->w && a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+static ui_rect_t rect_union(const ui_rect_t *a, const ui_rect_t *b) {
+    if (rect_empty(a)) return *b;
+    if (rect_empty(b)) return *a;
+    int x0 = a->x < b->x ? a->x : b->x;
+    int y0 = a->y < b->y ? a->y : b->y;
+    int x1 = (a->x + a->w > b->x + b->w) ? a->x + a->w : b->x + b->w;
+    int y1 = (a->y + a->h > b->y + b->h) ? a->y + a->h : b->y + b->h;
+    return (ui_rect_t){ (int16_t)x0, (int16_t)y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0) };
+}
+
+/* [9] Store a widget; any difference marks it dirty in every buffer */
+static void ui_set(int id, ui_kind_t kind, int x, int y, int w, int h,
+                   uint32_t c0, uint32_t c1, uint32_t c2, uint32_t fill, const char *s) {
+    if (id < 0 || id >= UI_MAX_WIDGETS) return;
+    ui_widget_t *wd = &widgets[id];
+    bool same = wd->visible && wd->kind == kind;
+    if (s) {
+        int n;
+        for (n = 0; n < UI_TEXT_MAX && s[n]; n++) {
+            if (wd->text[n] != s[n]) { same = false; wd->text[n] = s[n]; }
+        }
+        if (wd->text[n] != '\0') { same = false; wd->text[n] = '\0'; }
+        wd->len = (uint8_t)n;
+        if (kind == UI_TEXT) { w = n * 8; h = 8; }
+    }
+    ui_rect_t r = { (int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h };
+    if (same && wd->rect.x == r.x && wd->rect.y == r.y && wd->rect.w == r.w && wd->rect.h == r.h &&
+        wd->color[0] == c0 && wd->color[1] == c1 && wd->color[2] == c2 && wd->fill == fill) return;
+    wd->kind = kind;
+    wd->visible = true;
+    wd->rect = r;
+    wd->color[0] = c0; wd->color[1] = c1; wd->color[2] = c2;
+    wd->fill = fill;
+    wd->dirty = 0xFF;
+}
+
+void ui_text(int id, int x, int y, uint32_t color, const char *s) {
+    ui_set(id, UI_TEXT, x, y, 0, 0, color, 0, 0, 0, s ? s : "");
+}
+
+void ui_hbar(int id, int x, int y, int w, int h, uint32_t value, uint32_t max, uint32_t bg_color, uint32_t fg) {
+    uint32_t fill = max ? (uint32_t)((uint64_t)value * (uint32_t)w / max) : 0;
+    if (fill > (uint32_t)w) fill = (uint32_t)w;
+    ui_set(id, UI_HBAR, x, y, w, h, bg_color, fg, 0, fill, NULL);
+}
+
+void ui_vbar(int id, int x, int y, int w, int h, uint32_t value, uint32_t max, uint32_t bg_color, uint32_t fg) {
+    uint32_t inner = (h > 2) ? (uint32_t)(h - 2) : 0;
+    uint32_t fill = max ? (uint32_t)((uint64_t)value * inner / max) : 0;
+    if (fill > inner) fill = inner;
+    ui_set(id, UI_VBAR, x, y, w, h, bg_color, fg, 0, fill, NULL);
+}
+
+void ui_box_text(int id, int x, int y, int w, int h, uint32_t frame, uint32_t bg_color, uint32_t text_color, const char *s) {
+    ui_set(id, UI_BOX, x, y, w, h, frame, bg_color, text_color, 0, s ? s : "");
+}
+
+void ui_hide(int id) {
+    if (id < 0 || id >= UI_MAX_WIDGETS || !widgets[id].visible) return;
+    widgets[id].visible = false;
+    widgets[id].dirty = 0xFF;
+}
+
+void ui_hide_range(int first_id, int end_id) {
+    for (int id = first_id; id < end_id; id++) ui_hide(id);
+}
+
+bool ui_changed(int id, uint32_t key) {
+    if (id < 0 || id >= UI_MAX_WIDGETS) return true;
+    ui_widget_t *wd = &widgets[id];
+    if (wd->has_key && wd->key == key) return false;
+    wd->key = key;
+    wd->has_key = true;
+    return true;
+}
+
+/* [10] Draw one widget with gfx_* calls */
+static void ui_draw(const ui_widget_t *wd) {
+    const ui_rect_t *r = &wd->rect;
+    switch (wd->kind) {
+        case UI_TEXT:
+            gfx_set_text_color(wd->color[0]);
+            gfx_text(r->x, r->y, wd->text);
+            break;
+        case UI_HBAR:
+            gfx_fill_rect(r->x, r->y, r->w, r->h, wd->color[0]);
+            gfx_fill_rect(r->x, r->y, (int)wd->fill, r->h, wd->color[1]);
+            break;
+        case UI_VBAR:
+            gfx_fill_rect(r->x, r->y, r->w, r->h, wd->color[0]);
+            gfx_fill_rect(r->x + 1, r->y + r->h - 1 - (int)wd->fill, r->w - 2, (int)wd->fill, wd->color[1]);
+            break;
+        case UI_BOX: {
+            /* Frame, a 1 pixel gap, then the box; the text is centered in the box */
+            gfx_flush(); /* The box covers the text of the widgets below it */
+            gfx_frame_rect(r->x, r->y, r->w, r->h, wd->color[0]);
+            int bx = r->x + 2, by = r->y + 2, bw = r->w - 4, bh = r->h - 4;
+            gfx_fill_rect(bx, by, bw, bh, wd->color[1]);
+            gfx_set_text_color(wd->color[2]);
+            gfx_text(bx + (bw - wd->len * 8) / 2, by + (bh / 2) - 6, wd->text);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/* [11] Static content into the background surface, once per display mode */
+static void ui_build_background(surface_t *disp) {
+    bg = video_pool_surface(VIDEO_POOL_UI_BG, surface_get_format(disp), disp->width, disp->height);
+    if (!bg.buffer) { bg_failed = true; return; }
+    gfx_begin(&bg);
+    if (static_fn) static_fn(); else gfx_clear(0);
+    gfx_finish();
+    bg_ready = true;
+}
+
+static int ui_buffer_index(surface_t *disp) {
+    for (int i = 0; i < buffer_count; i++)
+        if (buffers[i] == disp->buffer) return i;
+    if (buffer_count == UI_MAX_BUFFERS) {
+        buffer_count = 0; /* More buffers than expected: start over with full redraws */
+        full_mask = 0xFF;
+    }
+    buffers[buffer_count] = disp->buffer;
+    full_mask |= (uint8_t)(1u << buffer_count);
+    return buffer_count++;
+}
+
+/* [12] Is there anything a framebuffer does not show yet? */
+static bool ui_pending(void) {
+    if (buffer_count < (int)display_get_num_buffers()) return true;
+    uint8_t known = (uint8_t)((1u << buffer_count) - 1);
+    if (full_mask & known) return true;
+    for (int i = 0; i < UI_MAX_WIDGETS; i++)
+        if (widgets[i].dirty & known) return true;
+    return false;
+}
+
+static void ui_count_frame(bool skipped) {
+    stats.frames++;
+    win_frames++;
+    if (skipped) { stats.skipped++; win_skipped++; }
+    if (win_frames >= UI_SKIP_WINDOW) {
+        stats.skip_pct = win_skipped * 100u / win_frames;
+        win_frames = win_skipped = 0;
+    }
+}
+
+/* [13] Frame */
+surface_t *ui_frame_begin(bool full) {
+    busy = false;
+    if (!full && retained && !ui_pending()) {
+        ui_count_frame(true);
+        return NULL;
+    }
+    surface_t *disp = full ? video_get() : video_try_get();
+    if (!disp) {
+        busy = true;
+        return NULL;
+    }
+    ui_count_frame(false);
+    if (retained && !bg_ready && !bg_failed) ui_build_background(disp);
+    int b = ui_buffer_index(disp);
+    uint8_t bit = (uint8_t)(1u << b);
+    gfx_begin(disp);
+
+    stats.drawn = stats.restored = stats.widgets = 0;
+    stats.full = full || !retained || !bg_ready || (full_mask & bit);
+    if (stats.full) {
+        /* [13.1] Whole screen: background, then every widget */
+        if (retained && bg_ready) gfx_blit(&bg, 0, 0, bg.width, bg.height);
+        else if (static_fn) static_fn();
+        else gfx_clear(0);
+        for (int i = 0; i < UI_MAX_WIDGETS; i++) {
+            if (!widgets[i].visible) continue;
+            ui_draw(&widgets[i]);
+            stats.drawn++;
+        }
+        full_mask &= (uint8_t)~bit;
+    } else {
+        /* [13.2] Restore what changed widgets cover (old and new area) from the background,
+           then draw the changed widgets and every widget that overlaps a restored area */
+        ui_rect_t restore[UI_MAX_WIDGETS];
+        int nr = 0;
+        for (int i = 0; i < UI_MAX_WIDGETS; i++) {
+            ui_widget_t *wd = &widgets[i];
+            if (!(wd->dirty & bit)) continue;
+            ui_rect_t r = wd->visible ? rect_union(&wd->drawn[b], &wd->rect) : wd->drawn[b];
+            if (rect_empty(&r)) continue;
+            gfx_blit(&bg, r.x, r.y, r.w, r.h);
+            restore[nr++] = r;
+        }
+        stats.restored = (uint32_t)nr;
+        for (int i = 0; i < UI_MAX_WIDGETS; i++) {
+            ui_widget_t *wd = &widgets[i];
+            if (!wd->visible) continue;
+            bool draw = (wd->dirty & bit) != 0;
+            for (int k = 0; !draw && k < nr; k++) draw = rect_overlap(&wd->rect, &restore[k]);
+            if (!draw) continue;
+            ui_draw(wd);
+            stats.drawn++;
+        }
+    }
+
+    /* [13.3] This buffer now shows the current state */
+    for (int i = 0; i < UI_MAX_WIDGETS; i++) {
+        ui_widget_t *wd = &widgets[i];
+        wd->dirty &= (uint8_t)~bit;
+        wd->drawn[b] = wd->visible ? wd->rect : (ui_rect_t){ 0, 0, 0, 0 };
+        if (wd->visible) stats.widgets++;
+    }
+    return disp;
+}
+
+bool ui_frame_busy(void) { return busy; }
+
+void ui_set_static(void (*fn)(void)) {
+    static_fn = fn;
+    ui_reset();
+}
+
+void ui_set_retained(bool on) {
+    retained = on;
+    ui_invalidate();
+}
+
+bool ui_get_retained(void) { return retained; }
+
+void ui_invalidate(void) {
+    full_mask = 0xFF;
+}
+
+/* [14] New display mode: the RDP must be idle (the caller waited before display_close).
+   The background memory stays, it is only drawn again at the new size. */
+void ui_reset(void) {
+    bg_ready = bg_failed = false;
+    buffer_count = 0;
+    full_mask = 0xFF;
+}
+
+void ui_get_stats(ui_stats_t *out) {
+    if (out) *out = stats;
+}
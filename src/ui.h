@@ -0,0 +1,68 @@
+/* [1] ui.h - Retained-mode screen: widgets keep their last value and rectangle, the static part
+   of the screen (background color, logo, title) is drawn once into a background surface, and
+   each frame only the widgets that changed are redrawn, after their rectangle is restored from
+   the background. Every framebuffer keeps its own dirty bits (a change must reach both buffers
+   of a double buffered display). A frame with nothing to redraw is not rendered at all. */
+#pragma once
+#include <libdragon.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define UI_MAX_WIDGETS 64   /* [2] Widget ids 0..63, drawn in id order (higher ids on top) */
+#define UI_MAX_BUFFERS 3    /* Framebuffers tracked (triple buffering at most) */
+#define UI_TEXT_MAX 80      /* Characters per text widget */
+#define UI_SKIP_WINDOW 60   /* Frames per skip percentage window */
+
+/* [3] Id ranges of the modules that own widgets */
+#define UI_ID_MAIN 0        /* main.c: 0..15 */
+#define UI_ID_DEBUG 16      /* debug.c: one id per overlay line, 16..50 */
+#define UI_ID_DEBUG_END 51
+#define UI_ID_PROF 51       /* prof.c: profiler bar, 51..62 */
+#define UI_ID_PROF_END 63
+#define UI_ID_HUD 63        /* hud.c message box, on top of everything */
+
+/* [4] Counters */
+typedef struct {
+    uint32_t frames;        /* Loop iterations that asked for a frame */
+    uint32_t skipped;       /* ... of which nothing had changed */
+    uint32_t skip_pct;      /* Skipped share of the last UI_SKIP_WINDOW frames */
+    uint32_t drawn;         /* Widgets drawn in the last rendered frame */
+    uint32_t restored;      /* Rectangles restored from the background in that frame */
+    uint32_t widgets;       /* Visible widgets */
+    bool full;              /* Last rendered frame was a full redraw */
+} ui_stats_t;
+
+/* [5] Static content: `fn` draws it with gfx_* calls, once into the background surface
+   (or into every frame when there is no memory for it or retained mode is off) */
+void ui_set_static(void (*fn)(void));
+
+/* [6] Retained mode on (default) / off (full redraw every frame, like an immediate UI) */
+void ui_set_retained(bool on);
+bool ui_get_retained(void);
+
+/* [7] Widgets. Setting a widget to what it already shows costs a compare and nothing else. */
+void ui_text(int id, int x, int y, uint32_t color, const char *s);
+void ui_hbar(int id, int x, int y, int w, int h, uint32_t value, uint32_t max, uint32_t bg, uint32_t fg);
+void ui_vbar(int id, int x, int y, int w, int h, uint32_t value, uint32_t max, uint32_t bg, uint32_t fg);
+void ui_box_text(int id, int x, int y, int w, int h, uint32_t frame, uint32_t bg, uint32_t text_color, const char *s);
+void ui_hide(int id);
+void ui_hide_range(int first_id, int end_id);
+
+/* [8] Input key of a widget: true when `key` differs from the stored one (then store it), so a
+   caller formats a string only when the numbers behind it changed */
+bool ui_changed(int id, uint32_t key);
+
+/* [9] Frame. Returns the framebuffer, attached with gfx_begin() and brought up to date, or NULL
+   when nothing changed and `full` is false (the frame is skipped). Finish with gfx_end().
+   Without `full` the framebuffer is only tried: when none is free it returns NULL too, nothing
+   is lost (the changes wait for the next call) and ui_frame_busy() tells the two cases apart.
+   With `full` it waits for a buffer, feeding the audio meanwhile. */
+surface_t *ui_frame_begin(bool full);
+bool ui_frame_busy(void);
+
+/* [10] Redraw everything in every buffer (after an overlay such as the menu went away) */
+void ui_invalidate(void);
+/* [11] The display was re-initialized: forget the buffers and rebuild the background */
+void ui_reset(void);
+
+void ui_get_stats(ui_stats_t *out);
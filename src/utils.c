@@ -34,6 +34,26 @@ void strcpy_s(char *dst, size_t dst_size, const char *src) {
     dst[i] = '\0';
 }
 
+/** [2.3] tiny_strcmp: Compares two null-terminated strings. Returns <0, 0 or >0 like strcmp. */
+int tiny_strcmp(const char *a, const char *b) {
+    while (*a && *a == *b) { a++; b++; }
+    return (int)(unsigned char)*a - (int)(unsigned char)*b;
+}
+
+/** [2.4] str_ends_with: Returns true if the string ends with the given suffix (case-insensitive ASCII). */
+bool str_ends_with(const char *s, const char *suffix) {
+    size_t n = tiny_strlen(s), m = tiny_strlen(suffix);
+    if (m > n) return false;
+    s += n - m;
+    for (size_t i = 0; i < m; i++) {
+        char c = s[i], d = suffix[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (d >= 'A' && d <= 'Z') d = (char)(d - 'A' + 'a');
+        if (c != d) return false;
+    }
+    return true;
+}
+
 /* [3] Number formatting */
 /** [3.1] int_to_dec: Converts an integer to a decimal string. Handles negative values and INT32_MIN edge case. */
 int int_to_dec(char *out, int value) {
@@ -141,4 +161,15 @@ int int_to_hex(char *out, uint32_t value, int width) {
     }
     out[pos] = '\0';
     return pos;
+}
+
+/** [5.3] bytes_to_hex_sp: Formats a byte array as "AA BB CC ..." (no trailing space). Always null-terminates. */
+void bytes_to_hex_sp(char *out, int out_size, const uint8_t *buf, int len) {
+    if (!out || out_size <= 0) return;
+    int ptr = 0;
+    for (int i = 0; i < len && (ptr + 3) < out_size; i++) {
+        u8_to_hex_sp(&out[ptr], buf[i]);
+        ptr += 3;
+    }
+    out[ptr] = '\0';
 }
\ No newline at end of file
@@ -12,6 +12,8 @@ void fast_memcpy(void *dest, const void *src, size_t n);   /* Copy memory (non-o
 /* [2] String helpers */
 size_t tiny_strlen(const char *s);                         /* Get length of null-terminated string */
 void strcpy_s(char *dst, size_t dst_size, const char *src);/* Safe string copy with null-termination */
+int tiny_strcmp(const char *a, const char *b);             /* Compare two strings (like strcmp) */
+bool str_ends_with(const char *s, const char *suffix);     /* Case-insensitive suffix check */
 
 /* [3] Number formatting */
 int int_to_dec(char *out, int value);                      /* Convert int to decimal string */
@@ -25,6 +27,7 @@ int safe_append_str(char *dst, int dst_size, int pos, const char *src); /* Appen
 
 /* [5] Byte to hex helper */
 void u8_to_hex_sp(char *out, uint8_t v);                   /* Byte to hex string with trailing space */
+void bytes_to_hex_sp(char *out, int out_size, const uint8_t *buf, int len); /* Byte array to "AA BB ..." */
 
 #ifndef INT32_MIN
 #define INT32_MIN (-2147483647 - 1)                        /* Minimum value for a 32-bit signed integer */
@@ -0,0 +1,214 @@
+/* [1] video.c - Display mode with a selectable color depth and render size (see video.h) */
+#include "video.h"
+#include "audio_engine.h" /* [1.1] Audio is fed between the steps of a mode switch */
+#include "evlog.h"        /* [1.2] Mode switch events */
+#include "mem.h"          /* [1.3] Framebuffer and pool memory */
+
+static const resolution_t *cur_res = NULL;
+static resolution_t render_res = { 0 };   /* Framebuffer size of the current mode */
+static video_scale_t scale = VIDEO_SCALE_FULL;
+static int cur_bpp = 32;
+static bool display_open = false;
+static uint32_t fill_rdp_us[2], fill_cpu_us[2]; /* [0] = 16 bpp, [1] = 32 bpp */
+static void *pool[VIDEO_POOL_SLOTS];
+static uint32_t pool_bytes = 0;
+static video_switch_stats_t switch_stats;
+static int num_buffers = VIDEO_BUFFERS;
+static video_acquire_stats_t acq;
+static bool acq_waiting = false;           /* A try failed, the frame is not acquired yet */
+static uint32_t win_frames = 0, win_blocked = 0;
+
+static uint32_t fb_bytes(int width, int height, int bpp) {
+    return (uint32_t)width * (uint32_t)height * (uint32_t)(bpp / 8) * (uint32_t)(num_buffers + 1);
+}
+
+void video_set_buffers(int count) {
+    if (count >= 2 && count <= VIDEO_MAX_BUFFERS) num_buffers = count;
+}
+
+int video_get_buffers(void) { return num_buffers; }
+
+void video_set_scale(video_scale_t s) {
+    if (s >= 0 && s < VIDEO_SCALE_COUNT) scale = s;
+}
+
+video_scale_t video_get_scale(void) { return scale; }
+
+const char *video_scale_name(video_scale_t s) {
+    switch (s) {
+        case VIDEO_SCALE_FULL: return "Full";
+        case VIDEO_SCALE_FIELD: return "Field";
+        case VIDEO_SCALE_LOW: return "Low";
+        default: return "?";
+    }
+}
+
+/* [2] Halved widths are rounded down to 8 pixels (whole glyphs, aligned rows) */
+resolution_t video_render_res(const resolution_t *res) {
+    resolution_t r = *res;
+    if (scale >= VIDEO_SCALE_FIELD && r.interlaced) {
+        r.height /= 2;
+        r.interlaced = false;
+    }
+    if (scale == VIDEO_SCALE_LOW && r.width > VIDEO_LOW_MAX_WIDTH) r.width = (r.width / 2) & ~7;
+    return r;
+}
+
+uint32_t video_fb_bytes(const resolution_t *res, int bpp) {
+    if (!res) return 0;
+    resolution_t r = video_render_res(res);
+    return fb_bytes(r.width, r.height, bpp);
+}
+
+int video_pick_bpp(const resolution_t *res, video_depth_t choice) {
+    if (choice == VIDEO_DEPTH_16) return 16;
+    if (choice == VIDEO_DEPTH_32) return 32;
+    return (video_fb_bytes(res, 32) <= (uint32_t)get_memory_size() / VIDEO_RAM_SHARE) ? 32 : 16;
+}
+
+/* [2.0] display_init/close allocate and free the framebuffers inside libdragon: measured */
+static void display_close_counted(void) {
+    mem_scope_t m = mem_scope_begin();
+    display_close();
+    mem_scope_end(MEM_FRAMEBUFFER, m);
+}
+
+int video_init(const resolution_t *res, video_depth_t choice) {
+    if (display_open) display_close_counted();
+    cur_res = res;
+    render_res = video_render_res(res);
+    cur_bpp = video_pick_bpp(res, choice);
+    mem_scope_t m = mem_scope_begin();
+    display_init(render_res, cur_bpp == 16 ? DEPTH_16_BPP : DEPTH_32_BPP, (uint32_t)num_buffers, GAMMA_NONE, ANTIALIAS_OFF);
+    mem_scope_end(MEM_FRAMEBUFFER, m);
+    display_open = true;
+    return cur_bpp;
+}
+
+int video_get_bpp(void) { return cur_bpp; }
+
+const char *video_depth_name(video_depth_t choice) {
+    switch (choice) {
+        case VIDEO_DEPTH_AUTO: return "Auto";
+        case VIDEO_DEPTH_16: return "16 bpp";
+        case VIDEO_DEPTH_32: return "32 bpp";
+        default: return "?";
+    }
+}
+
+/* [2.1] The RDP time includes waiting for it to finish, which is what a frame would wait for */
+void video_measure_fill(color_t color) {
+    surface_t *disp = video_get();
+    int d = (cur_bpp == 16) ? 0 : 1;
+    uint32_t t0 = TICKS_READ();
+    rdpq_attach(disp, NULL);
+    rdpq_set_mode_fill(color);
+    rdpq_fill_rectangle(0, 0, disp->width, disp->height);
+    rdpq_detach_wait();
+    fill_rdp_us[d] = (uint32_t)TICKS_TO_US(TICKS_READ() - t0);
+    t0 = TICKS_READ();
+    graphics_fill_screen(disp, graphics_convert_color(color));
+    fill_cpu_us[d] = (uint32_t)TICKS_TO_US(TICKS_READ() - t0);
+    display_show(disp);
+    audio_engine_pump();
+}
+
+void video_get_depth_stats(int bpp, video_depth_stats_t *out) {
+    if (!out) return;
+    int d = (bpp == 16) ? 0 : 1;
+    out->fb_bytes = cur_res ? fb_bytes(render_res.width, render_res.height, bpp) : 0;
+    out->fill_rdp_us = fill_rdp_us[d];
+    out->fill_cpu_us = fill_cpu_us[d];
+}
+
+/* [3] Pool. The memory is never freed, so its place in the heap does not change. */
+bool video_pool_init(uint32_t bytes) {
+    if (pool_bytes) return true;
+    if (bytes > VIDEO_POOL_MAX_BYTES) bytes = VIDEO_POOL_MAX_BYTES;
+    for (int i = 0; i < VIDEO_POOL_SLOTS; i++) {
+        pool[i] = malloc_uncached_aligned(64, bytes);
+        if (!pool[i]) {
+            while (--i >= 0) { free_uncached(pool[i]); pool[i] = NULL; }
+            return false;
+        }
+    }
+    pool_bytes = bytes;
+    mem_account(MEM_UI, (int32_t)(bytes * VIDEO_POOL_SLOTS));
+    return true;
+}
+
+surface_t video_pool_surface(video_pool_slot_t slot, tex_format_t fmt, int width, int height) {
+    uint32_t bpp = (fmt == FMT_RGBA32) ? 4 : 2;
+    if (slot < 0 || slot >= VIDEO_POOL_SLOTS || !pool[slot] || (uint32_t)width * (uint32_t)height * bpp > pool_bytes)
+        return (surface_t){ 0 };
+    return surface_make_linear(pool[slot], fmt, (uint16_t)width, (uint16_t)height);
+}
+
+uint32_t video_pool_bytes(void) { return pool_bytes; }
+
+/* [4] Mode switch. The pumps between the slow steps keep the audio fed (no-ops in the
+   AUDIO_ENGINE_IRQ_MIX build, where the callback mixes by itself). */
+int video_switch(const resolution_t *res, video_depth_t choice) {
+    uint32_t underruns0 = audio_engine_get_underruns();
+    uint32_t t0 = TICKS_READ();
+    rspq_wait(); /* The RDP may still be drawing into a buffer that is about to be freed */
+    uint32_t t1 = TICKS_READ();
+    audio_engine_pump();
+    display_close_counted();
+    display_open = false;
+    acq_waiting = false;
+    uint32_t t2 = TICKS_READ();
+    audio_engine_pump();
+    int bpp = video_init(res, choice);
+    uint32_t t3 = TICKS_READ();
+    audio_engine_pump();
+
+    switch_stats.count++;
+    switch_stats.wait_us = (uint32_t)TICKS_TO_US(t1 - t0);
+    switch_stats.close_us = (uint32_t)TICKS_TO_US(t2 - t1);
+    switch_stats.init_us = (uint32_t)TICKS_TO_US(t3 - t2);
+    switch_stats.last_us = (uint32_t)TICKS_TO_US(TICKS_READ() - t0);
+    if (switch_stats.last_us > switch_stats.max_us) switch_stats.max_us = switch_stats.last_us;
+    uint32_t underruns = audio_engine_get_underruns() - underruns0;
+    switch_stats.underruns += underruns;
+    EVLOG(MODE, res->width, res->height, render_res.width, render_res.height);
+    EVLOG(MODE_SWITCH, (uint32_t)bpp, switch_stats.last_us, underruns);
+    return bpp;
+}
+
+void video_get_switch_stats(video_switch_stats_t *out) {
+    if (out) *out = switch_stats;
+}
+
+/* [5] Acquisition */
+static void acq_count(bool blocked) {
+    acq.frames++;
+    win_frames++;
+    if (blocked) { acq.blocked++; win_blocked++; }
+    if (win_frames >= VIDEO_ACQ_WINDOW) {
+        acq.blocked_pct = win_blocked * 100u / win_frames;
+        win_frames = win_blocked = 0;
+    }
+}
+
+surface_t *video_try_get(void) {
+    surface_t *disp = display_try_get();
+    if (!disp) {
+        acq.retries++;
+        acq_waiting = true;
+        return NULL;
+    }
+    acq_count(acq_waiting);
+    acq_waiting = false;
+    return disp;
+}
+
+surface_t *video_get(void) {
+    surface_t *disp;
+    while (!(disp = video_try_get())) audio_engine_pump();
+    return disp;
+}
+
+void video_get_acquire_stats(video_acquire_stats_t *out) {
+    if (out) *out = acq;
+}
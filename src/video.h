@@ -0,0 +1,113 @@
+/* [1] video.h - Display mode: resolution plus color depth. 16 bpp halves framebuffer memory and
+   fill bandwidth; "Auto" picks it when the 32 bpp buffers would take too much of the RAM. */
+#pragma once
+#include <libdragon.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define VIDEO_BUFFERS 2          /* [2] Default: double buffering (video_set_buffers: 2 or 3) */
+#define VIDEO_MAX_BUFFERS 3
+#define VIDEO_ACQ_WINDOW 60      /* Frames per "would have blocked" percentage window */
+#define VIDEO_RAM_SHARE 3        /* Auto: 32 bpp only if the buffers fit in a third of the RAM */
+#define VIDEO_POOL_MAX_BYTES (640 * 576 * 4) /* [2.1] Configured maximum of one pool surface */
+
+/* [3] Depth choice (menu option) */
+typedef enum {
+    VIDEO_DEPTH_AUTO = 0,
+    VIDEO_DEPTH_16,
+    VIDEO_DEPTH_32,
+    VIDEO_DEPTH_COUNT
+} video_depth_t;
+
+/* [4] Per-depth numbers for the debug overlay. Fill times are measured at each mode switch:
+   one full-screen fill by the RDP (until it is done) and one by the CPU. */
+typedef struct {
+    uint32_t fb_bytes;     /* Framebuffers + UI background at the current resolution */
+    uint32_t fill_rdp_us;  /* 0 = this depth was not used yet */
+    uint32_t fill_cpu_us;
+} video_depth_stats_t;
+
+/* [4.1] Internal render size. The VI scales the framebuffer to the output mode, so a smaller
+   framebuffer fills the same screen with bigger pixels: fewer pixels to fill, less memory. */
+typedef enum {
+    VIDEO_SCALE_FULL = 0,    /* Framebuffer = selected mode */
+    VIDEO_SCALE_FIELD,       /* Interlaced modes: one field (half height), shown progressive */
+    VIDEO_SCALE_LOW,         /* FIELD, and widths above VIDEO_LOW_MAX_WIDTH halved */
+    VIDEO_SCALE_COUNT
+} video_scale_t;
+
+#define VIDEO_LOW_MAX_WIDTH 400
+
+/* [4.2] Scale for the next video_init() / video_switch(); video_fb_bytes() and video_pick_bpp()
+   already use it, so the menu shows what a mode will cost */
+void video_set_scale(video_scale_t scale);
+video_scale_t video_get_scale(void);
+const char *video_scale_name(video_scale_t scale);
+/* [4.3] Framebuffer size of an output mode at the set scale */
+resolution_t video_render_res(const resolution_t *res);
+
+/* [4.4] Framebuffers (2 = double, 3 = triple buffering) for the next video_init() / switch.
+   With three, the CPU can start a frame while one is shown and another waits for the RDP. */
+void video_set_buffers(int count);
+int video_get_buffers(void);
+
+/* [5] Bytes of the framebuffers plus the UI background surface (at the set scale and count) */
+uint32_t video_fb_bytes(const resolution_t *res, int bpp);
+
+/* [6] 16 or 32 for a choice; Auto looks at get_memory_size() (at the set scale) */
+int video_pick_bpp(const resolution_t *res, video_depth_t choice);
+
+/* [7] Set the display mode (closes the previous one). Returns the depth used. */
+int video_init(const resolution_t *res, video_depth_t choice);
+int video_get_bpp(void);
+const char *video_depth_name(video_depth_t choice);
+
+/* [8] Time one full-screen fill with `color` on the RDP and on the CPU (shows one frame) */
+void video_measure_fill(color_t color);
+void video_get_depth_stats(int bpp, video_depth_stats_t *out);
+
+/* [9] Surface pool: memory for the full-screen surfaces the player owns besides the display
+   buffers (the UI background), allocated once at boot for the largest mode and reused by every
+   mode switch, so a switch does not free and allocate them again. */
+typedef enum {
+    VIDEO_POOL_UI_BG = 0,    /* ui.c background with the static content */
+    VIDEO_POOL_SLOTS
+} video_pool_slot_t;
+
+/* [9.1] Allocate every slot with `bytes` (capped at VIDEO_POOL_MAX_BYTES). Call right after the
+   first video_init(), before other large allocations. Returns false when there was no memory. */
+bool video_pool_init(uint32_t bytes);
+/* [9.2] Surface of the given size and format on the slot memory. Empty (buffer NULL) when the
+   slot was not allocated or is too small for it. */
+surface_t video_pool_surface(video_pool_slot_t slot, tex_format_t fmt, int width, int height);
+uint32_t video_pool_bytes(void); /* Bytes of one slot (0 = no pool) */
+
+/* [10] Mode switch: waits for the RDP, closes the old mode and opens the new one, feeding the
+   audio between the steps. Each switch is timed, with the audio underruns counted during it. */
+typedef struct {
+    uint32_t count;          /* Switches since boot */
+    uint32_t last_us;        /* Duration of the last switch */
+    uint32_t max_us;         /* Longest switch */
+    uint32_t wait_us;        /* Last switch: waiting for the RDP */
+    uint32_t close_us;       /* ... display_close() */
+    uint32_t init_us;        /* ... display_init() */
+    uint32_t underruns;      /* Underruns during all switches (should stay 0) */
+} video_switch_stats_t;
+
+int video_switch(const resolution_t *res, video_depth_t choice);
+void video_get_switch_stats(video_switch_stats_t *out);
+
+/* [11] Frame acquisition. video_try_get() returns NULL at once when every framebuffer is still
+   queued, so the loop can go on with audio and input; video_get() waits, feeding the audio.
+   Both count the frames whose first try found no free buffer (a plain display_get() would
+   have blocked there). */
+typedef struct {
+    uint32_t frames;         /* Framebuffers acquired */
+    uint32_t blocked;        /* ... of which the first try found none free */
+    uint32_t retries;        /* Tries that returned no buffer */
+    uint32_t blocked_pct;    /* Blocked share of the last VIDEO_ACQ_WINDOW frames */
+} video_acquire_stats_t;
+
+surface_t *video_try_get(void);
+surface_t *video_get(void);
+void video_get_acquire_stats(video_acquire_stats_t *out);
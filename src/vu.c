@@ -1,5 +1,6 @@
 #include "vu.h"
 #include "utils.h"
+#include "ui.h"
 #include <math.h>
 #include <stdint.h>
 
@@ -20,10 +21,10 @@ void vu_config(float half_life_ms, float min_delta) {
 }
 
 /* Update smoothed VU values based on new peaks. */
-void vu_update(float frame_interval_ms, int max_amp_l, int max_amp_r) {
-    if (frame_interval_ms <= 0.0f) frame_interval_ms = 16.0f; /* fallback for invalid interval */
+void vu_update(uint32_t interval_us, int max_amp_l, int max_amp_r) {
+    if (interval_us == 0) interval_us = 16000; /* fallback for invalid interval */
 
-    float decay_factor = powf(0.5f, frame_interval_ms / VU_HALF_LIFE_MS);
+    float decay_factor = powf(0.5f, (float)interval_us / (VU_HALF_LIFE_MS * 1000.0f));
 
     /* left channel */
     float peak_l = (float)max_amp_l;
@@ -43,17 +44,15 @@ int vu_get_left(void) { return (int)smoothed_vu_l; }
 /* Get the current smoothed right VU value. */
 int vu_get_right(void) { return (int)smoothed_vu_r; }
 
-/* Draw a single VU meter on the screen. */
-void draw_vu_meter(display_context_t disp, int base_x, int base_y, int width, int height,
+/* Set a single VU meter: widget `ui_id` is the meter, `ui_id + 1` its label. The meter is
+   only redrawn when its height changes by a whole pixel. */
+void draw_vu_meter(int ui_id, int base_x, int base_y, int width, int height,
                    int value, int max_val, uint32_t box_color, uint32_t fill_color, const char *label) {
-    if (!disp) return;
     if (max_val <= 0) max_val = 1;
-    graphics_draw_box(disp, base_x - 1, base_y - height - 1, width + 2, height + 2, box_color);
-    int h = (value * height) / max_val;
-    if (h > height) h = height;
-    graphics_draw_box(disp, base_x, base_y - h, width, h, fill_color);
+    if (value < 0) value = 0;
+    ui_vbar(ui_id, base_x - 1, base_y - height - 1, width + 2, height + 2, (uint32_t)value, (uint32_t)max_val, box_color, fill_color);
     int tx = base_x + (width / 2) - ((int)tiny_strlen(label) * 4);
-    graphics_draw_text(disp, tx, base_y + 4, label);
+    ui_text(ui_id + 1, tx, base_y + 4, box_color, label);
 }
 
 
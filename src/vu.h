@@ -2,16 +2,16 @@
 #include <libdragon.h>
 
 /* [1] Update internal, smoothed VU meter values.
-   frame_interval_ms: time since last frame in ms
+   interval_us: time since the last update in us (an exact tick duration, see clock.h)
    max_amp_l / max_amp_r: peak values for this frame (short->abs) */
-void vu_update(float frame_interval_ms, int max_amp_l, int max_amp_r);
+void vu_update(uint32_t interval_us, int max_amp_l, int max_amp_r);
 
 /* [2] Get the current smoothed values as int (for drawing) */
 int vu_get_left(void);
 int vu_get_right(void);
 
-/* [3] Draw a single VU meter (call from main, interface identical to original) */
-void draw_vu_meter(display_context_t disp, int base_x, int base_y, int width, int height,
+/* [3] Set a single VU meter as two retained widgets: ui_id (meter) and ui_id + 1 (label) */
+void draw_vu_meter(int ui_id, int base_x, int base_y, int width, int height,
                    int value, int max_val, uint32_t box_color, uint32_t fill_color, const char *label);
 
 /* [4] (Optional) Configure smoothing parameters: half-life in ms and minimum delta */
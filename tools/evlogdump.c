@@ -0,0 +1,108 @@
+/* [1] evlogdump.c - Host tool: decodes the player's binary event log (layout and event table
+   in src/evlog_format.h) into text or CSV. Takes either the file the player writes to the SD
+   card or a captured ISViewer/emulator log, where only the EVL lines are read.
+
+   Usage: evlogdump [-csv] <sd:/mca64.evl or debug log> */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../src/evlog_format.h"
+
+/* [2] Event table */
+#define EVLOG_NAME_(name, level, text) #name,
+#define EVLOG_LEVEL_(name, level, text) level,
+#define EVLOG_TEXT_(name, level, text) text,
+static const char *const event_name[EV_COUNT] = { EVLOG_EVENTS(EVLOG_NAME_) };
+static const int event_level[EV_COUNT] = { EVLOG_EVENTS(EVLOG_LEVEL_) };
+static const char *const event_text[EV_COUNT] = { EVLOG_EVENTS(EVLOG_TEXT_) };
+static const char *const level_name[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+static int csv = 0;
+static long records = 0;
+
+static uint32_t rd_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/* [4] Print one record */
+static void print_record(const uint8_t *r) {
+    uint64_t us = ((uint64_t)rd_be32(&r[EVLOG_OFS_TIME]) << 32) | rd_be32(&r[EVLOG_OFS_TIME + 4]);
+    unsigned id = ((unsigned)r[EVLOG_OFS_ID] << 8) | r[EVLOG_OFS_ID + 1];
+    unsigned argc = r[EVLOG_OFS_ARGC], skipped = r[EVLOG_OFS_SKIPPED];
+    uint32_t a[EVLOG_MAX_ARGS];
+    for (int i = 0; i < EVLOG_MAX_ARGS; i++) a[i] = rd_be32(&r[EVLOG_OFS_ARGS + 4 * i]);
+    records++;
+
+    const char *name = id < EV_COUNT ? event_name[id] : "UNKNOWN";
+    const char *level = id < EV_COUNT ? level_name[event_level[id]] : "?";
+    if (csv) {
+        printf("%llu,%s,%s,%u,%u,%u,%u,%u,%u\n", (unsigned long long)us, level, name, argc,
+               a[0], a[1], a[2], a[3], skipped);
+        return;
+    }
+    printf("[%6llu.%06llu] %-5s ", (unsigned long long)(us / 1000000u), (unsigned long long)(us % 1000000u), level);
+    if (id < EV_COUNT) printf(event_text[id], a[0], a[1], a[2], a[3]);
+    else printf("event %u: %u %u %u %u", id, a[0], a[1], a[2], a[3]);
+    if (skipped) printf(" (%s%u skipped before)", skipped == 255 ? ">= " : "", skipped);
+    printf("\n");
+}
+
+/* [5] Text log: records are the EVL lines (64 hex digits each) */
+static int hex_digit(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void decode_text(FILE *f) {
+    char line[1024];
+    const size_t tag = strlen(EVLOG_LINE_TAG);
+    while (fgets(line, sizeof(line), f)) {
+        const char *p = strstr(line, EVLOG_LINE_TAG);
+        if (!p) continue;
+        p += tag;
+        uint8_t r[EVLOG_RECORD_SIZE];
+        int i;
+        for (i = 0; i < EVLOG_RECORD_SIZE; i++) {
+            int hi = hex_digit(p[2 * i]), lo = hi < 0 ? -1 : hex_digit(p[2 * i + 1]);
+            if (lo < 0) break;
+            r[i] = (uint8_t)(hi << 4 | lo);
+        }
+        if (i == EVLOG_RECORD_SIZE) print_record(r);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-csv") == 0) csv = 1;
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: evlogdump [-csv] <event log file or debug log>\n");
+        return 1;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) { fprintf(stderr, "evlogdump: cannot open %s\n", path); return 1; }
+    if (csv) printf("time_us,level,event,argc,arg0,arg1,arg2,arg3,skipped\n");
+
+    /* [6] Binary file from the SD card, or a text log */
+    uint8_t hdr[EVLOG_HEADER_SIZE];
+    if (fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr) && memcmp(hdr, EVLOG_MAGIC, 4) == 0) {
+        if (hdr[4] != EVLOG_VERSION || hdr[5] != EVLOG_RECORD_SIZE) {
+            fprintf(stderr, "evlogdump: %s: version %u, record size %u not supported\n", path, hdr[4], hdr[5]);
+            fclose(f);
+            return 1;
+        }
+        uint8_t r[EVLOG_RECORD_SIZE];
+        while (fread(r, 1, sizeof(r), f) == sizeof(r)) print_record(r);
+    } else {
+        rewind(f);
+        decode_text(f);
+    }
+    fclose(f);
+    fprintf(stderr, "evlogdump: %ld record(s)\n", records);
+    return 0;
+}
@@ -0,0 +1,134 @@
+/* [1] mkcatalog.c - Host tool run by the Makefile: writes a binary track catalog (layout in
+   src/catalog.h) for the given .wav64 files, so the player gets every track's metadata with one
+   read at boot and never has to open a file just to list it. The Makefile picks the files (its
+   TRACKS list is the one place that decides what a track is); each is stored under its name
+   without the directory, which is its name in rom:/.
+
+   Usage: mkcatalog <output file> [track.wav64 ...] */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../src/catalog.h"
+
+#define WAV64_HEADER_SIZE 24 /* [2] id[4], version, format, channels, bits, freq, len, loop_len, start_offset */
+
+/* [3] Big-endian helpers */
+static uint32_t rd_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void wr_be16(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v;
+}
+
+static void wr_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v;
+}
+
+/* [4] Sort by name (byte order, the same order the player uses) */
+typedef struct {
+    const char *path;
+    const char *name; /* Part after the last '/' */
+} track_t;
+
+static int cmp_names(const void *a, const void *b) {
+    return strcmp(((const track_t *)a)->name, ((const track_t *)b)->name);
+}
+
+/* [5] Fill one catalog entry from a WAV64 file. Returns 0 on success. */
+static int make_entry(const char *path, const char *name, uint8_t *e) {
+    FILE *f = fopen(path, "rb");
+    if (!f) { fprintf(stderr, "mkcatalog: cannot open %s\n", path); return -1; }
+    uint8_t hdr[WAV64_HEADER_SIZE];
+    size_t got = fread(hdr, 1, sizeof(hdr), f);
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fclose(f);
+    if (got < sizeof(hdr) || memcmp(hdr, "WV64", 4) != 0) {
+        fprintf(stderr, "mkcatalog: %s is not a WAV64 file\n", path);
+        return -1;
+    }
+
+    uint8_t format = hdr[5], channels = hdr[6], bits = hdr[7];
+    uint32_t freq = rd_be32(&hdr[8]);
+    uint32_t len = rd_be32(&hdr[12]);
+    uint32_t loop_len = rd_be32(&hdr[16]);
+    uint32_t start_offset = rd_be32(&hdr[20]);
+
+    /* [5.1] Bitrate: exact for PCM, average over the sample data for compressed formats */
+    uint32_t bitrate = 0;
+    if (format == 0) bitrate = freq * channels * bits;
+    else if (len > 0 && (uint32_t)file_size > start_offset)
+        bitrate = (uint32_t)((uint64_t)((uint32_t)file_size - start_offset) * 8u * freq / len);
+
+    memset(e, 0, CATALOG_ENTRY_SIZE);
+    strncpy((char *)&e[CATALOG_OFS_NAME], name, CATALOG_NAME_LEN - 1);
+    e[CATALOG_OFS_FORMAT] = format;
+    e[CATALOG_OFS_CHANNELS] = channels;
+    e[CATALOG_OFS_BITS] = bits;
+    wr_be32(&e[CATALOG_OFS_FREQ], freq);
+    wr_be32(&e[CATALOG_OFS_LEN], len);
+    if (loop_len > 0 && loop_len <= len) {
+        wr_be32(&e[CATALOG_OFS_LOOP_START], len - loop_len);
+        wr_be32(&e[CATALOG_OFS_LOOP_END], len);
+    }
+    wr_be32(&e[CATALOG_OFS_BITRATE], bitrate);
+    wr_be32(&e[CATALOG_OFS_FILE_SIZE], (uint32_t)file_size);
+    memcpy(&e[CATALOG_OFS_HEADER], hdr, CATALOG_HEADER_BYTES);
+    wr_be32(&e[CATALOG_OFS_DATA_OFFSET], start_offset);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: mkcatalog <output file> [track.wav64 ...]\n");
+        return 1;
+    }
+
+    /* [6] Collect and sort the names */
+    track_t tracks[CATALOG_MAX_ENTRIES];
+    int count = 0;
+    for (int i = 2; i < argc; i++) {
+        const char *slash = strrchr(argv[i], '/');
+        const char *name = slash ? slash + 1 : argv[i];
+        if (strlen(name) >= CATALOG_NAME_LEN) {
+            fprintf(stderr, "mkcatalog: skipping %s (name longer than %d)\n", name, CATALOG_NAME_LEN - 1);
+            continue;
+        }
+        if (count == CATALOG_MAX_ENTRIES) {
+            /* [6.1] The player would drop the rest without a word, so stop the build instead */
+            fprintf(stderr, "mkcatalog: more than %d tracks (the player's limit)\n", CATALOG_MAX_ENTRIES);
+            return 1;
+        }
+        tracks[count].path = argv[i];
+        tracks[count].name = name;
+        count++;
+    }
+    qsort(tracks, (size_t)count, sizeof(tracks[0]), cmp_names);
+
+    /* [7] Build the whole file in memory, then write it once */
+    size_t size = CATALOG_HEADER_SIZE + (size_t)count * CATALOG_ENTRY_SIZE;
+    uint8_t *buf = calloc(1, size);
+    if (!buf) return 1;
+    int n = 0;
+    for (int i = 0; i < count; i++)
+        if (make_entry(tracks[i].path, tracks[i].name, &buf[CATALOG_HEADER_SIZE + (size_t)n * CATALOG_ENTRY_SIZE]) == 0) n++;
+    memcpy(buf, CATALOG_MAGIC, 4);
+    buf[4] = CATALOG_VERSION;
+    wr_be16(&buf[6], (uint32_t)n);
+    wr_be16(&buf[8], CATALOG_ENTRY_SIZE);
+    size = CATALOG_HEADER_SIZE + (size_t)n * CATALOG_ENTRY_SIZE;
+
+    FILE *out = fopen(argv[1], "wb");
+    if (!out || fwrite(buf, 1, size, out) != size) {
+        fprintf(stderr, "mkcatalog: cannot write %s\n", argv[1]);
+        if (out) fclose(out);
+        free(buf);
+        return 1;
+    }
+    fclose(out);
+    free(buf);
+    printf("mkcatalog: %d track(s), %zu bytes -> %s\n", n, size, argv[1]);
+    return 0;
+}
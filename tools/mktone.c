@@ -0,0 +1,86 @@
+/* [1] mktone.c - Host tool run by the Makefile: writes a synthetic test track as a 16-bit WAV, which
+   audioconv64 then turns into the PCM and VADPCM tracks of the ROM. The shipped sound.wav64 is
+   Opus, and the RAM preload, the track cache and the CPU VADPCM decoder only handle PCM and
+   VADPCM, so these two tracks are what exercises them.
+
+   The signal makes position errors audible: a four-note arpeggio (250 ms per note) over a 1 kHz
+   tick at the start of every second. Stereo files pan the notes left and right, so a channel mix-up
+   shows too.
+
+   Usage: mktone <output.wav> <channels 1|2> <sample rate> <seconds> */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#define TONE_NOTE_MS 250    /* [2] Arpeggio step */
+#define TONE_TICK_MS 10     /* Length of the tick on each second */
+#define TONE_AMPLITUDE 0.4  /* Peak level of a note (the tick adds at most 0.2) */
+
+/* [3] Little-endian helpers (RIFF is little-endian) */
+static void wr_le16(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8);
+}
+
+static void wr_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 5) {
+        fprintf(stderr, "usage: mktone <output.wav> <channels 1|2> <sample rate> <seconds>\n");
+        return 1;
+    }
+    int channels = atoi(argv[2]);
+    uint32_t rate = (uint32_t)atoi(argv[3]);
+    uint32_t seconds = (uint32_t)atoi(argv[4]);
+    if (channels < 1 || channels > 2 || rate < 8000 || rate > 48000 || seconds < 1 || seconds > 600) {
+        fprintf(stderr, "mktone: bad parameters\n");
+        return 1;
+    }
+
+    /* [4] Header: RIFF, fmt (PCM, 16 bits), data */
+    uint32_t frames = rate * seconds;
+    uint32_t data_bytes = frames * (uint32_t)channels * 2;
+    uint8_t hdr[44] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' };
+    wr_le32(&hdr[4], 36 + data_bytes);
+    wr_le32(&hdr[16], 16);
+    wr_le16(&hdr[20], 1);
+    wr_le16(&hdr[22], (uint32_t)channels);
+    wr_le32(&hdr[24], rate);
+    wr_le32(&hdr[28], rate * (uint32_t)channels * 2);
+    wr_le16(&hdr[32], (uint32_t)channels * 2);
+    wr_le16(&hdr[34], 16);
+    hdr[36] = 'd'; hdr[37] = 'a'; hdr[38] = 't'; hdr[39] = 'a';
+    wr_le32(&hdr[40], data_bytes);
+
+    FILE *out = fopen(argv[1], "wb");
+    if (!out) { fprintf(stderr, "mktone: cannot write %s\n", argv[1]); return 1; }
+    fwrite(hdr, 1, sizeof(hdr), out);
+
+    /* [5] Samples. Each note fades in and out over 5 ms, so note changes do not click. */
+    static const double notes[4] = { 261.63, 329.63, 392.00, 523.25 }; /* C4 E4 G4 C5 */
+    uint32_t note_len = rate * TONE_NOTE_MS / 1000;
+    uint32_t tick_len = rate * TONE_TICK_MS / 1000;
+    uint32_t ramp = rate / 200;
+    for (uint32_t i = 0; i < frames; i++) {
+        uint32_t step = i / note_len, in_note = i % note_len;
+        double env = 1.0;
+        if (in_note < ramp) env = (double)in_note / ramp;
+        else if (note_len - in_note < ramp) env = (double)(note_len - in_note) / ramp;
+        double note = TONE_AMPLITUDE * env * sin(2.0 * M_PI * notes[step % 4] * i / rate);
+        double tick = (i % rate < tick_len) ? 0.2 * sin(2.0 * M_PI * 1000.0 * i / rate) : 0.0;
+        double pan = (step & 1) ? 0.25 : 0.75; /* Left gain; right gets the rest */
+        uint8_t frame[4];
+        for (int c = 0; c < channels; c++) {
+            double g = (channels == 1) ? 1.0 : (c == 0 ? pan : 1.0 - pan) * 2.0;
+            int v = (int)lrint((note * g + tick) * 32767.0);
+            if (v > 32767) v = 32767;
+            if (v < -32768) v = -32768;
+            wr_le16(&frame[c * 2], (uint32_t)(uint16_t)(int16_t)v);
+        }
+        fwrite(frame, 1, (size_t)channels * 2, out);
+    }
+    if (fclose(out) != 0) { fprintf(stderr, "mktone: write failed\n"); return 1; }
+    return 0;
+}